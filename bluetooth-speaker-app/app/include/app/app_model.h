@@ -3,6 +3,7 @@
 #define _APP_MODEL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 // a model for the bluetooth speaker, contains getters for state and functions for sending commands to phone
 // implement these so that they can be called at arbitrary times after init
@@ -10,6 +11,10 @@
 int app_model_init();
 void app_model_cleanup();
 
+// listener is called whenever something the getters return changes (track, playback status, position, volume, shuffle,
+// repeat). It runs on the bluetooth thread, so keep it short, e.g. just wake the thread that reads the model
+void app_model_set_changed_listener(void (*listener)(void));
+
 typedef struct {
     int seconds_passed;
     int seconds_total;
@@ -30,6 +35,20 @@ int app_model_get_volume();
 
 app_state_playback app_model_get_playback();
 
+// milliseconds until seconds_passed of the playback goes up by one, -1 while paused since it won't change on its own
+long app_model_ms_until_next_second();
+
+typedef struct {
+    const char* title;
+    const char* album;
+    const char* artist;
+    app_state_playback playback;
+} app_state_track;
+
+// everything about the current track in one read, for callers that poll every frame. Nothing is allocated on the heap,
+// the strings are copied into buf (size bytes, see bt_player_get_track_into) and are only valid as long as buf is
+app_state_track app_model_get_track(char* buf, size_t size);
+
 int app_model_get_shuffle();
 
 int app_model_get_repeat();
@@ -0,0 +1,41 @@
+// Picks the frame rate, backlight level and panel power state from how much the screen is changing and how long
+// it has been since the last input. The UI thread calls display_governor_update once per frame
+#ifndef _DISPLAY_GOVERNOR_H
+#define _DISPLAY_GOVERNOR_H
+
+#include <stdbool.h>
+
+enum display_governor_state {
+    // recent input or animation, full frame rate
+    DISPLAY_GOVERNOR_ACTIVE,
+    // nothing animating, low frame rate that still picks up track and time changes quickly
+    DISPLAY_GOVERNOR_IDLE,
+    // paused with no input or model change for a while, 1 Hz and a dimmed backlight
+    DISPLAY_GOVERNOR_PAUSED,
+    // panel and backlight off, input, a model change or the music starting wakes it
+    DISPLAY_GOVERNOR_ASLEEP,
+};
+
+// needs draw_stuff and frame_pacer to be initialized
+void display_governor_init(void);
+
+// apply the policy for the next frame. playing is whether music is playing.
+// Returns false if the panel is asleep and nothing should be drawn
+bool display_governor_update(bool playing);
+
+// milliseconds until the state or backlight would change with no input, -1 if never. A UI that sleeps between changes
+// needs to run display_governor_update again by then
+long display_governor_ms_until_change(bool playing);
+
+// call on every encoder or joystick input, wakes the display straight away. Safe to call from any thread
+void display_governor_input(void);
+
+// call when the track, playback or volume changes from the phone. Wakes a sleeping panel and keeps a paused one awake,
+// but doesn't raise the frame rate the way input does. Safe to call from any thread
+void display_governor_model_changed(void);
+
+enum display_governor_state display_governor_get_state(void);
+
+void display_governor_cleanup(void);
+
+#endif
@@ -15,6 +15,24 @@ static bool is_playing = false;
 static bt_player_shuffle_e shuffle = BT_PLAYER_SHUFFLE_OFF;
 static bt_player_repeat_e repeat = BT_PLAYER_REPEAT_OFF;
 
+static void (*_Atomic changed_listener)(void) = NULL;
+
+static void notify_changed()
+{
+    void (*listener)(void) = changed_listener;
+    if (listener)
+        listener();
+}
+
+void on_track_changed(const void *changed_val, void *user_data)
+{
+    (void)changed_val;
+    (void)user_data;
+
+    // the getters read the track from bt_player, there's nothing to keep here
+    notify_changed();
+}
+
 void on_position_changed(const void *changed_val, void *user_data)
 {
     (void)user_data;
@@ -22,6 +40,8 @@ void on_position_changed(const void *changed_val, void *user_data)
     position = *(const uint32_t *)changed_val;
 
     position_changed_at = time_ms();
+
+    notify_changed();
 }
 
 void on_status_changed(const void *changed_val, void *user_data)
@@ -30,6 +50,8 @@ void on_status_changed(const void *changed_val, void *user_data)
 
     is_playing = *(const bt_player_status_e *)changed_val == BT_PLAYER_STATUS_PLAYING;
     printf("status changed: %s\n", is_playing ? "playing" : "paused");
+
+    notify_changed();
 }
 
 void on_volume_changed(const void *changed_val, void *user_data)
@@ -38,6 +60,8 @@ void on_volume_changed(const void *changed_val, void *user_data)
 
     volume = *(const uint8_t *)changed_val;
     printf("volume changed: %d\n", volume);
+
+    notify_changed();
 }
 
 void on_shuffle_changed(const void *changed_val, void *user_data)
@@ -46,6 +70,8 @@ void on_shuffle_changed(const void *changed_val, void *user_data)
 
     shuffle = *(const bt_player_shuffle_e *)changed_val;
     printf("shuffle changed: %d\n", shuffle);
+
+    notify_changed();
 }
 
 void on_repeat_changed(const void *changed_val, void *user_data)
@@ -54,10 +80,13 @@ void on_repeat_changed(const void *changed_val, void *user_data)
 
     repeat = *(const bt_player_repeat_e *)changed_val;
     printf("repeat changed: %d\n", repeat);
+
+    notify_changed();
 }
 
 int app_model_init()
 {
+    bt_player_set_property_changed_cb(BT_PLAYER_PROP_TRACK, on_track_changed, NULL);
     bt_player_set_property_changed_cb(BT_PLAYER_PROP_PLAYBACK_POSITION, on_position_changed, NULL);
     bt_player_set_property_changed_cb(BT_PLAYER_PROP_PLAYBACK_STATUS, on_status_changed, NULL);
     bt_player_set_property_changed_cb(BT_PLAYER_PROP_VOLUME, on_volume_changed, NULL);
@@ -71,6 +100,11 @@ void app_model_cleanup()
     return;
 }
 
+void app_model_set_changed_listener(void (*listener)(void))
+{
+    changed_listener = listener;
+}
+
 char *app_model_get_track_title()
 {
     bt_player_track_info_t track;
@@ -152,6 +186,23 @@ int app_model_get_volume()
     return volume * 100.0 / 127;
 }
 
+static app_state_playback playback_for(uint32_t duration)
+{
+    if (!is_playing)
+    {
+        return (app_state_playback){
+            .seconds_passed = position / 1000,
+            .seconds_total = duration / 1000,
+        };
+    }
+
+    long curr_pos = position + (time_ms() - position_changed_at);
+    return (app_state_playback){
+        .seconds_passed = curr_pos / 1000,
+        .seconds_total = duration / 1000,
+    };
+}
+
 app_state_playback app_model_get_playback()
 {
     bt_player_track_info_t track;
@@ -163,18 +214,42 @@ app_state_playback app_model_get_playback()
     free(track.album);
     free(track.artist);
 
+    return playback_for(track.duration);
+}
+
+long app_model_ms_until_next_second()
+{
     if (!is_playing)
+        return -1;
+
+    long curr_pos = position + (time_ms() - position_changed_at);
+    return 1000 - curr_pos % 1000;
+}
+
+static const char *or_default(const char *str)
+{
+    if (!str || !strcmp(str, ""))
+        return "N/A";
+    return str;
+}
+
+app_state_track app_model_get_track(char *buf, size_t size)
+{
+    bt_player_track_info_t track;
+    if (buf == NULL || !bt_player_get_track_into(&track, buf, size))
     {
-        return (app_state_playback){
-            .seconds_passed = position / 1000,
-            .seconds_total = track.duration / 1000,
+        return (app_state_track){
+            .title = "N/A",
+            .album = "N/A",
+            .artist = "N/A",
         };
     }
 
-    long curr_pos = position + (time_ms() - position_changed_at);
-    return (app_state_playback){
-        .seconds_passed = curr_pos / 1000,
-        .seconds_total = track.duration / 1000,
+    return (app_state_track){
+        .title = or_default(track.title),
+        .album = or_default(track.album),
+        .artist = or_default(track.artist),
+        .playback = playback_for(track.duration),
     };
 }
 
@@ -0,0 +1,194 @@
+#include "app/display_governor.h"
+#include "hal/draw_stuff.h"
+#include "hal/frame_pacer.h"
+#include "hal/time_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+static const int ACTIVE_FPS = 30;
+static const int IDLE_FPS = 10;
+static const int PAUSED_FPS = 1;
+
+static const int BACKLIGHT_FULL = 1023;
+static const int BACKLIGHT_DIM = 200;
+
+// stay at full rate this long after an input
+static const long ACTIVE_AFTER_INPUT_MS = 3000;
+// this many changed frames in a row means something is animating (a scrolling title, a fade)
+static const int ANIMATING_FRAMES = 3;
+// with no input or model change, while paused
+static const long PAUSED_AFTER_MS = 10 * 1000;
+static const long SLEEP_AFTER_MS = 5 * 60 * 1000;
+// with no input, while playing
+static const long DIM_AFTER_MS = 60 * 1000;
+
+// input listeners read this from their own threads
+static _Atomic bool initialized = false;
+// on the time_mono_ms clock, so setting the wall clock neither dims the screen nor keeps it awake
+static _Atomic long last_input_ms = 0;
+// the last track, playback or volume change from the phone. Keeps a paused screen awake but doesn't raise the frame rate
+static _Atomic long last_model_change_ms = 0;
+static enum display_governor_state state = DISPLAY_GOVERNOR_ACTIVE;
+static int backlight = -1;
+static long long last_bytes_total = 0;
+static long last_frames_displayed = 0;
+static int changed_in_a_row = 0;
+
+void display_governor_init(void)
+{
+    assert(!initialized);
+    last_input_ms = time_mono_ms();
+    last_model_change_ms = last_input_ms;
+    state = DISPLAY_GOVERNOR_ACTIVE;
+    backlight = BACKLIGHT_FULL;
+    last_bytes_total = 0;
+    last_frames_displayed = 0;
+    changed_in_a_row = 0;
+    initialized = true;
+}
+
+static void set_backlight(int level)
+{
+    if(level != backlight) {
+        draw_stuff_set_backlight(level);
+        backlight = level;
+    }
+}
+
+// draw_stuff only sends tiles that changed, so bytes going out means the screen changed
+static void track_changes(void)
+{
+    struct draw_stuff_stats stats;
+    draw_stuff_get_stats(&stats);
+    if(stats.frames_displayed == last_frames_displayed) {
+        // the UI skips submitting frames that are the same as the last one
+        changed_in_a_row = 0;
+        return;
+    }
+    if(stats.bytes_total != last_bytes_total) {
+        changed_in_a_row++;
+    } else {
+        changed_in_a_row = 0;
+    }
+    last_bytes_total = stats.bytes_total;
+    last_frames_displayed = stats.frames_displayed;
+}
+
+// idle_ms is since the last input, quiet_ms since the last input or model change
+static enum display_governor_state pick_state(bool playing, long idle_ms, long quiet_ms, bool animating)
+{
+    if(idle_ms < ACTIVE_AFTER_INPUT_MS || animating) {
+        return DISPLAY_GOVERNOR_ACTIVE;
+    }
+    if(playing) {
+        return DISPLAY_GOVERNOR_IDLE;
+    }
+    if(quiet_ms >= SLEEP_AFTER_MS) {
+        return DISPLAY_GOVERNOR_ASLEEP;
+    }
+    if(quiet_ms >= PAUSED_AFTER_MS) {
+        return DISPLAY_GOVERNOR_PAUSED;
+    }
+    return DISPLAY_GOVERNOR_IDLE;
+}
+
+bool display_governor_update(bool playing)
+{
+    assert(initialized);
+    long now = time_mono_ms();
+    long idle_ms = now - last_input_ms;
+    long quiet_ms = now - (last_model_change_ms > last_input_ms ? last_model_change_ms : last_input_ms);
+    track_changes();
+
+    // an animation can't wake the panel, input, the music starting or a change from the phone can
+    bool animating = changed_in_a_row >= ANIMATING_FRAMES && state != DISPLAY_GOVERNOR_ASLEEP;
+    enum display_governor_state next = pick_state(playing, idle_ms, quiet_ms, animating);
+
+    if(next != state) {
+        if(state == DISPLAY_GOVERNOR_ASLEEP) {
+            draw_stuff_set_sleep(false);
+        }
+        switch(next) {
+        case DISPLAY_GOVERNOR_ACTIVE:
+            frame_pacer_set_fps(ACTIVE_FPS);
+            break;
+        case DISPLAY_GOVERNOR_IDLE:
+            frame_pacer_set_fps(IDLE_FPS);
+            break;
+        case DISPLAY_GOVERNOR_PAUSED:
+            frame_pacer_set_fps(PAUSED_FPS);
+            break;
+        case DISPLAY_GOVERNOR_ASLEEP:
+            frame_pacer_set_fps(PAUSED_FPS);
+            set_backlight(0);
+            draw_stuff_set_sleep(true);
+            break;
+        }
+        state = next;
+    }
+
+    if(state != DISPLAY_GOVERNOR_ASLEEP) {
+        bool dim = state == DISPLAY_GOVERNOR_PAUSED || (playing && idle_ms >= DIM_AFTER_MS);
+        set_backlight(dim ? BACKLIGHT_DIM : BACKLIGHT_FULL);
+    }
+
+    return state != DISPLAY_GOVERNOR_ASLEEP;
+}
+
+long display_governor_ms_until_change(bool playing)
+{
+    assert(initialized);
+    long now = time_mono_ms();
+    long idle_ms = now - last_input_ms;
+    long quiet_ms = now - (last_model_change_ms > last_input_ms ? last_model_change_ms : last_input_ms);
+    // every time pick_state and the backlight care about, in order, and the clock each one is on
+    const long playing_steps[] = {ACTIVE_AFTER_INPUT_MS, DIM_AFTER_MS};
+    const long playing_clocks[] = {idle_ms, idle_ms};
+    const long paused_steps[] = {ACTIVE_AFTER_INPUT_MS, PAUSED_AFTER_MS, SLEEP_AFTER_MS};
+    const long paused_clocks[] = {idle_ms, quiet_ms, quiet_ms};
+    const long* steps = playing ? playing_steps : paused_steps;
+    const long* clocks = playing ? playing_clocks : paused_clocks;
+    int num_steps = playing ? 2 : 3;
+    long soonest = -1;
+    for(int i = 0; i < num_steps; i++) {
+        if(clocks[i] < steps[i] && (soonest < 0 || steps[i] - clocks[i] < soonest)) {
+            soonest = steps[i] - clocks[i];
+        }
+    }
+    return soonest;
+}
+
+void display_governor_input(void)
+{
+    if(!initialized) {
+        return;
+    }
+    last_input_ms = time_mono_ms();
+    frame_pacer_wake();
+}
+
+void display_governor_model_changed(void)
+{
+    if(!initialized) {
+        return;
+    }
+    last_model_change_ms = time_mono_ms();
+    frame_pacer_wake();
+}
+
+enum display_governor_state display_governor_get_state(void)
+{
+    assert(initialized);
+    return state;
+}
+
+void display_governor_cleanup(void)
+{
+    assert(initialized);
+    if(state == DISPLAY_GOVERNOR_ASLEEP) {
+        draw_stuff_set_sleep(false);
+    }
+    set_backlight(BACKLIGHT_FULL);
+    initialized = false;
+}
@@ -1,26 +1,46 @@
 #define _POSIX_C_SOURCE 200809L
 #include "app/init.h"
 #include "app/app_model.h"
+#include "app/display_governor.h"
 #include "hal/rotary_encoder.h"
 #include "hal/draw_stuff.h"
 #include "hal/joystick.h"
 #include "hal/lg_gpio_samples_func.h"
+#include "hal/frame_pacer.h"
+#include "hal/frame_arena.h"
+#include "hal/canvas_pool.h"
 #include "hal/audio_capture.h"
 #include "hal/microphone.h"
 #include "ui/load_image_assets.h"
+#include "ui/text_cache.h"
+#include "ui/glyph_cache.h"
 #include "hal/bt_agent.h"
 #include "hal/bt_dbus.h"
 #include "hal/bt_player.h"
 
 #include <stdio.h>
+#include <errno.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <stdbool.h>
 
 static _Atomic bool shutdown = false;
+// init_set_shutdown runs in the SIGINT handler where only sem_post is safe, this thread does the rest
+static sem_t shutdown_sem;
+static pthread_t shutdown_thread;
 static pthread_barrier_t barrier;
 // pthread_barrier_t with count = 1 not allowed
 static bool num_confirms_0 = false;
 
+static const int UI_FPS = 30;
+// the Waveshare 1.54" board doesn't break out the ST7789 TE pin, set this to the line it's wired to if it is
+static const int LCD_TE_CHIP = 2;
+static const int LCD_TE_GPIO = -1;
+// rendered strings kept around, a screen needs about 5 and track changes bring new ones
+static const int TEXT_CACHE_ENTRIES = 16;
+// per frame scratch memory for the UI thread, a frame uses well under 2 KB today
+static const size_t FRAME_ARENA_BYTES = 16 * 1024;
+
 
 void on_track_change(const void *val, void *user_data)
 {
@@ -47,6 +67,19 @@ void on_position_change(const void *val, void *user_data)
     g_print("\nposition changed callback: %u:%02u.%u\n\n", pos_min, pos_sec, pos_ms);
 }
 
+// the UI thread can be asleep in frame_pacer_idle with no deadline, wake it so it sees the shutdown
+static void *watch_shutdown(void *arg)
+{
+    (void)arg;
+    int code;
+    do
+    {
+        code = sem_wait(&shutdown_sem);
+    } while (code != 0 && errno == EINTR);
+    frame_pacer_wake();
+    return NULL;
+}
+
 
 int init_start(int num_confirms)
 {
@@ -64,6 +97,18 @@ int init_start(int num_confirms)
         return 1;
     }
 
+    code = frame_arena_init(FRAME_ARENA_BYTES);
+    if(code) {
+        fprintf(stderr, "init: failed to init frame arena %d\n", code);
+        return 1;
+    }
+
+    code = text_cache_init(TEXT_CACHE_ENTRIES);
+    if(code) {
+        fprintf(stderr, "init: failed to init text cache %d\n", code);
+        return 1;
+    }
+
     code = joystick_init();
     if(code) {
         fprintf(stderr, "failed to init stick %d\n", code);
@@ -79,6 +124,13 @@ int init_start(int num_confirms)
 
     draw_stuff_init();
 
+    code = frame_pacer_init(UI_FPS, LCD_TE_CHIP, LCD_TE_GPIO);
+    if(code) {
+        fprintf(stderr, "init: failed to init frame pacer %d\n", code);
+        return 4;
+    }
+    display_governor_init();
+
     if(num_confirms > 0) {
         code = pthread_barrier_init(&barrier, NULL, num_confirms + 1);
         if(code) {
@@ -90,6 +142,11 @@ int init_start(int num_confirms)
         num_confirms_0 = true;
     }
 
+    if(sem_init(&shutdown_sem, 0, 0) || pthread_create(&shutdown_thread, NULL, watch_shutdown, NULL)) {
+        fprintf(stderr, "init: failed to start shutdown thread\n");
+        return 6;
+    }
+
 
     bt_agent_init();
 
@@ -109,6 +166,7 @@ int init_start(int num_confirms)
 void init_set_shutdown()
 {
     shutdown = true;
+    sem_post(&shutdown_sem);
 }
 
 bool init_get_shutdown()
@@ -144,9 +202,19 @@ void init_end(void)
     dbus_cleanup();
 
     bt_agent_cleanup();
-    draw_stuff_cleanup();
+    // lets the thread finish if nothing asked to shut down
+    sem_post(&shutdown_sem);
+    pthread_join(shutdown_thread, NULL);
+    sem_destroy(&shutdown_sem);
 
+    // input listeners wake the frame pacer, so they have to stop before it goes away
     rotary_encoder_cleanup();
+    joystick_cleanup();
+
+    display_governor_cleanup();
+    frame_pacer_cleanup();
+    draw_stuff_cleanup();
+
     if(!num_confirms_0) {
         code = pthread_barrier_destroy(&barrier);
         if(code) {
@@ -154,12 +222,30 @@ void init_end(void)
         }
     }
 
-    joystick_cleanup();
-
     // ENABLE FOR MICROPHONE
     // audio_capture_cleanup();
     // microphone_cleanup();
     
+    struct text_cache_stats text_stats;
+    text_cache_get_stats(&text_stats);
+    printf("text cache: %ld hits, %ld misses, %ld evictions, %d strips using %zu bytes\n",
+           text_stats.hits, text_stats.misses, text_stats.evictions, text_stats.entries, text_stats.bytes);
+    text_cache_cleanup();
+
+    struct glyph_cache_stats glyph_stats;
+    glyph_cache_get_stats(&glyph_stats);
+    printf("glyph cache: %ld hits, %ld misses, %ld evictions, %d glyphs using %zu bytes\n",
+           glyph_stats.hits, glyph_stats.misses, glyph_stats.evictions, glyph_stats.entries, glyph_stats.bytes);
+
+    struct frame_arena_stats arena_stats;
+    frame_arena_get_stats(&arena_stats);
+    struct canvas_pool_stats pool_stats;
+    canvas_pool_get_stats(&pool_stats);
+    printf("frame arena: %zu of %zu bytes used at most, %ld overflows. canvas pool: %ld mallocs, %ld frees, %ld reused\n",
+           arena_stats.high_water, arena_stats.capacity, arena_stats.overflows,
+           pool_stats.heap_allocs, pool_stats.heap_frees, pool_stats.reused);
+    frame_arena_cleanup();
     load_image_assets_cleanup();
+    canvas_pool_trim();
     lg_gpio_samples_func_cleanup();
 }
\ No newline at end of file
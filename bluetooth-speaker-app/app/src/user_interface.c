@@ -2,22 +2,28 @@
 #include "app/user_interface.h"
 #include "app/app_model.h"
 #include "app/init.h"
+#include "app/display_governor.h"
 #include "hal/rotary_encoder.h"
 #include "hal/draw_stuff.h"
 #include "hal/image_loader.h"
+#include "hal/raster.h"
 #include "hal/audio_capture.h"
 #include "hal/microphone.h"
 #include "ui/draw_ui.h"
 #include "ui/load_image_assets.h"
+#include "ui/widget.h"
+#include "ui/glyph_atlas.h"
+#include "ui/perf_hud.h"
 #include "hal/time_util.h"
 #include "hal/joystick.h"
+#include "hal/frame_pacer.h"
+#include "hal/frame_arena.h"
 
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
-#include <math.h>
 
 static pthread_t ui_thread;
 
@@ -30,57 +36,135 @@ static bool rotary_encoder_pressed = false;
 //     dest[max_size] = '\0';
 // }
 
-static void olivec_line_thick(Olivec_Canvas oc, int x1, int y1, int x2, int y2, int t, uint32_t color)
+// how long the error X takes to fade out, and how long the volume bar takes to reach a new level
+static const long ERROR_FADE_MS = 500;
+static const long VOLUME_GLIDE_MS = 150;
+// per label text buffer
+static const int LABEL_BYTES = 256;
+// room for the title, artist, album and genre of one track
+static const size_t TRACK_TEXT_BYTES = 1024;
+
+// bumped by the input threads on every failed command, the UI thread starts the fade when it sees a new one
+static _Atomic long cmd_errors = 0;
+
+// show the error X, and wake the UI since it might be idle
+static void flag_error(void)
+{
+    cmd_errors++;
+    frame_pacer_wake();
+}
+
+// when the screen would change next without any input or model change, on the time_us clock. -1 if never.
+// tree_ms is how long until a widget changes on its own, -1 if none will
+static long long next_change_us(bool playing, long tree_ms)
 {
-    int d_x = x2 - x1;
-    int d_y = y2 - y1;
-
-    double len = 2 * sqrt(d_x * d_x + d_y * d_y);
-
-    int ax = x1 + d_y * t / len;
-    int ay = y1 - d_x * t / len;
-    int bx = x1 - d_y * t / len;
-    int by = y1 + d_x * t / len;
-    int cx = x2 + d_y * t / len;
-    int cy = y2 - d_x * t / len;
-    int dx = x2 - d_y * t / len;
-    int dy = y2 + d_x * t / len;
-
-    olivec_triangle(oc, ax, ay, cx, cy, bx, by, color);
-    olivec_triangle(oc, dx, dy, bx, by, cx, cy, color);
+    long wait_ms = app_model_ms_until_next_second();
+    if (wait_ms < 0 || (tree_ms >= 0 && tree_ms < wait_ms))
+        wait_ms = tree_ms;
+    long governor_ms = display_governor_ms_until_change(playing);
+    if (wait_ms < 0 || (governor_ms >= 0 && governor_ms < wait_ms))
+        wait_ms = governor_ms;
+    long hud_ms = perf_hud_ms_until_refresh(time_mono_ms());
+    if (wait_ms < 0 || (hud_ms >= 0 && hud_ms < wait_ms))
+        wait_ms = hud_ms;
+    if (wait_ms < 0)
+        return -1;
+    // a millisecond late so the new second has definitely started
+    return time_us() + (wait_ms + 1) * 1000LL;
 }
 
-bool cmd_errored = false;
-long cmd_errored_time = 0;
+// the error X, data is the fade tween going from 1 to 0
+static void draw_error_x(Olivec_Canvas16 canvas, int x, int y, void *data)
+{
+    const struct tween *fade = data;
+    uint32_t alpha = fade->value * 255;
+
+    uint32_t fg = 0x000000FF | (alpha << 24);
+    uint32_t bg = 0xFFFFFFFF;
+
+    olivec_blend_color(&bg, fg);
+
+    // the strokes are centred in the 24 pixel box, with smooth edges
+    raster_line(canvas, x + 4, y + 4, x + 20, y + 20, 4, bg, true);
+    raster_line(canvas, x + 20, y + 4, x + 4, y + 20, 4, bg, true);
+}
 
 void *run_ui(void *arg __attribute__((unused)))
 {
-    int max_chars = LCD_WIDTH / LOAD_IMAGE_ASSETS_CHAR_WIDTH;
-    char *album_str_buf = malloc(sizeof(*album_str_buf) * (max_chars + 1));
-    char *track_str_buf = malloc(sizeof(*track_str_buf) * (max_chars + 1));
-    char *playback_str_buf = malloc(sizeof(*playback_str_buf) * (max_chars + 1));
-    char *artist_str_buf = malloc(sizeof(*artist_str_buf) * (max_chars + 1));
-    Olivec_Canvas *screen = image_loader_image_create(240, 240);
+    int mid_section_start = 60;
+
+    // the screen is built once, each frame only updates values and redraws the widgets they changed
+    struct widget_tree *tree = widget_tree_create(LCD_WIDTH, LCD_HEIGHT, OLIVEC_RGBA(255, 255, 255, 255));
+    if (tree == NULL)
+    {
+        fprintf(stderr, "ui: no memory for the screen, shutting down\n");
+        init_set_shutdown();
+        init_signal_done();
+        return NULL;
+    }
+    int vol_bar_x = (LCD_WIDTH - 120) / 2;
+    // chrome that never changes is drawn once into the tree's base canvas
+    widget_tree_add_layer(tree, true);
+    widget_tree_add_icon(tree, vol_bar_x - 25, mid_section_start + 153, load_image_assets_get_volume_icon());
+    widget_tree_add_layer(tree, false);
+    struct widget *album_label = widget_tree_add_label(tree, WIDGET_CENTER_X, 10);
+    // long titles scroll instead of getting cut off
+    struct widget *track_marquee = widget_tree_add_marquee(tree, mid_section_start, LCD_WIDTH);
+    struct widget *artist_label = widget_tree_add_label(tree, WIDGET_CENTER_X, mid_section_start + 20);
+    struct widget *time_bar = widget_tree_add_progress_bar(tree, (LCD_WIDTH - 160) / 2, mid_section_start + 45, 160, 5, OLIVEC_RGBA(255, 0, 0, 255));
+    struct widget *time_label = widget_tree_add_label(tree, WIDGET_CENTER_X, mid_section_start + 50);
+    struct widget *shuffle_icon = widget_tree_add_icon(tree, 50, mid_section_start + 80, load_image_assets_get_shuffle_icon());
+    struct widget *repeat_icon = widget_tree_add_icon(tree, 160, mid_section_start + 80, load_image_assets_get_repeat_icon());
+    struct widget *play_icon = widget_tree_add_icon(tree, WIDGET_CENTER_X, mid_section_start + 80, load_image_assets_get_play_icon());
+    struct widget *volume_bar = widget_tree_add_progress_bar(tree, vol_bar_x, mid_section_start + 160, 120, 5, OLIVEC_RGBA(0, 0, 255, 255));
+    struct widget *error_x = widget_tree_add_overlay(tree, 108, 181, 24, 24, draw_error_x, NULL);
+    struct tween *error_fade = widget_tree_add_tween(tree, error_x, NULL);
+    error_x->overlay.data = error_fade;
+    widget_set_visible(error_x, false);
+    // performance overlay in the bottom right corner, on top of everything
+    perf_hud_init(tree, LCD_WIDTH - 61, LCD_HEIGHT - 43);
+    // the volume bar glides to a new level instead of jumping
+    struct tween *volume_glide = widget_tree_add_tween(tree, volume_bar, widget_progress_bar_set);
+    int shown_volume = -1;
+    long errors_seen = cmd_errors;
+    struct draw_stuff_rect damage[WIDGET_MAX_DAMAGE];
 
     while (!init_get_shutdown())
     {
-        char *album_temp = app_model_get_album_title();
-        char *track_temp = app_model_get_track_title();
-        char *track_artist = app_model_get_artist();
-        app_state_playback playback = app_model_get_playback();
+        // read before any state, so a change that lands while this frame is drawn still wakes the idle wait below
+        long wakes = frame_pacer_wake_count();
+        // everything below that only lives for this frame comes from the arena, the loop never touches the heap
+        frame_arena_reset();
+
+        // nothing to draw while the panel is asleep, input or a change from the phone wakes it
+        if (!display_governor_update(app_model_is_playing()))
+        {
+            frame_pacer_idle(wakes, -1);
+            continue;
+        }
+
+        perf_hud_mark();
+        char *track_buf = frame_arena_alloc(TRACK_TEXT_BYTES);
+        app_state_track track = app_model_get_track(track_buf, TRACK_TEXT_BYTES);
+        app_state_playback playback = track.playback;
         int volume = app_model_get_volume();
         int shuffle = app_model_get_shuffle();
         int repeat = app_model_get_repeat();
         bool playing = app_model_is_playing();
+        perf_hud_stage_done(PERF_HUD_MODEL);
 
 // stop compiler from complaining about string getting cut off because we actually want that
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat-truncation"
 
-        snprintf(album_str_buf, max_chars + 1, "%s", album_temp);
-        snprintf(track_str_buf, max_chars + 1, "%s", track_temp);
-        snprintf(artist_str_buf, max_chars + 1, "By: %s", track_artist);
-        snprintf(playback_str_buf, max_chars + 1, "%02d:%02d / %02d:%02d",
+        // metadata is UTF-8, cut below to what fits across the screen, which is always far fewer bytes than this
+        int max_bytes = LABEL_BYTES;
+        char *album_str_buf = frame_arena_alloc(max_bytes);
+        char *artist_str_buf = frame_arena_alloc(max_bytes);
+        char *playback_str_buf = frame_arena_alloc(max_bytes);
+        snprintf(album_str_buf, max_bytes, "%s", track.album);
+        snprintf(artist_str_buf, max_bytes, "By: %s", track.artist);
+        snprintf(playback_str_buf, max_bytes, "%02d:%02d / %02d:%02d",
                  playback.seconds_passed / 60,
                  playback.seconds_passed % 60,
                  playback.seconds_total / 60,
@@ -88,94 +172,66 @@ void *run_ui(void *arg __attribute__((unused)))
 
 #pragma GCC diagnostic pop
 
-        free(album_temp);
-        free(track_temp);
-        free(track_artist);
-
-        Olivec_Canvas *album_txt = draw_ui_text(album_str_buf);
-        Olivec_Canvas *track_txt = draw_ui_text(track_str_buf);
-        Olivec_Canvas *artist_txt = draw_ui_text(artist_str_buf);
-        Olivec_Canvas *time_txt = draw_ui_text(playback_str_buf);
-        Olivec_Canvas *time_bar = draw_ui_progress_bar(160, 5, playback.seconds_passed / (float)playback.seconds_total, OLIVEC_RGBA(255, 0, 0, 255));
-        Olivec_Canvas *volume_bar = draw_ui_progress_bar(120, 5, volume / 100.0f, OLIVEC_RGBA(0, 0, 255, 255));
-        Olivec_Canvas *volume_icon = load_image_assets_get_volume_icon();
+        // measured, since glyphs from the glyph cache can be wider than the atlas ones
+        glyph_atlas_truncate(album_str_buf, LCD_WIDTH);
+        glyph_atlas_truncate(artist_str_buf, LCD_WIDTH);
 
-        int mid_section_start = 60;
-
-        olivec_fill(*screen, OLIVEC_RGBA(255, 255, 255, 255));
-        draw_ui_blend_centered(*screen, *album_txt, 10);
-        draw_ui_blend_centered(*screen, *track_txt, mid_section_start);
-        draw_ui_blend_centered(*screen, *artist_txt, mid_section_start + 20);
-        draw_ui_blend_centered(*screen, *time_bar, mid_section_start + 45);
-        draw_ui_blend_centered(*screen, *time_txt, mid_section_start + 50);
-
-        int vol_bar_x = draw_ui_blend_centered(*screen, *volume_bar, mid_section_start + 160);
-        olivec_sprite_blend(*screen, vol_bar_x - 25, mid_section_start + 153, volume_icon->width, volume_icon->height, *volume_icon);
-
-        if (shuffle == 1)
-        {
-            Olivec_Canvas *shuffle_icon = load_image_assets_get_shuffle_icon();
-            olivec_sprite_blend(*screen, 50, mid_section_start + 80, shuffle_icon->width, shuffle_icon->height, *shuffle_icon);
-        }
+        widget_label_set_text(album_label, album_str_buf);
+        widget_label_set_text(track_marquee, track.title);
+        widget_label_set_text(artist_label, artist_str_buf);
+        widget_label_set_text(time_label, playback_str_buf);
 
-        if (repeat == 1)
+        widget_progress_bar_set(time_bar, playback.seconds_passed / (float)playback.seconds_total);
+        long now = time_mono_ms();
+        if (shown_volume < 0)
         {
-            Olivec_Canvas *replay_icon = load_image_assets_get_replay_icon();
-            olivec_sprite_blend(*screen, 160, mid_section_start + 80, replay_icon->width, replay_icon->height, *replay_icon);
+            tween_set(volume_glide, volume / 100.0f);
+            widget_progress_bar_set(volume_bar, volume / 100.0f);
         }
-        else if (repeat == 2)
+        else if (volume != shown_volume)
         {
-            Olivec_Canvas *repeat_icon = load_image_assets_get_repeat_icon();
-            olivec_sprite_blend(*screen, 160, mid_section_start + 80, repeat_icon->width, repeat_icon->height, *repeat_icon);
+            tween_start(volume_glide, volume_glide->value, volume / 100.0f, now, VOLUME_GLIDE_MS, TWEEN_EASE_OUT);
         }
+        shown_volume = volume;
 
-        if (playing)
-        {
-            Olivec_Canvas *pause_icon = load_image_assets_get_pause_icon();
-            draw_ui_blend_centered(*screen, *pause_icon, mid_section_start + 80);
-        }
-        else
-        {
-            Olivec_Canvas *play_icon = load_image_assets_get_play_icon();
-            draw_ui_blend_centered(*screen, *play_icon, mid_section_start + 80);
-        }
+        widget_set_visible(shuffle_icon, shuffle == 1);
+        widget_set_visible(repeat_icon, repeat == 1 || repeat == 2);
+        if (repeat == 1)
+            widget_icon_set(repeat_icon, load_image_assets_get_replay_icon());
+        else if (repeat == 2)
+            widget_icon_set(repeat_icon, load_image_assets_get_repeat_icon());
+        widget_icon_set(play_icon, playing ? load_image_assets_get_pause_icon() : load_image_assets_get_play_icon());
 
-        if (cmd_errored)
+        long errors = cmd_errors;
+        if (errors != errors_seen)
         {
-            long time_since_err = time_ms() - cmd_errored_time;
-            long alpha = 500 - time_since_err;
-            if (alpha < 0)
-                alpha = 0;
-            else if (alpha > 255)
-                alpha = 255;
-
-            uint32_t fg = 0x000000FF | (alpha << 24);
-            uint32_t bg = 0xFFFFFFFF;
-
-            olivec_blend_color(&bg, fg);
-
-            olivec_line_thick(*screen, 112, 185, 128, 201, 4, bg);
-            olivec_line_thick(*screen, 128, 185, 112, 201, 4, bg);
-
-            if (alpha == 0)
-                cmd_errored = false;
+            errors_seen = errors;
+            tween_start(error_fade, 1.0f, 0.0f, now, ERROR_FADE_MS, TWEEN_EASE_IN);
         }
-
-        draw_stuff_screen(screen);
-
-        image_loader_image_free(&album_txt);
-        image_loader_image_free(&track_txt);
-        image_loader_image_free(&time_txt);
-        image_loader_image_free(&time_bar);
-        image_loader_image_free(&volume_bar);
-        image_loader_image_free(&artist_txt);
+        // hidden once it has faded, the tree redraws the X every frame while the fade runs
+        widget_set_visible(error_x, error_fade->running);
+
+        perf_hud_update(now);
+
+        // steady frame rate instead of redrawing as fast as SPI allows
+        int num_damage = widget_tree_render(tree, now, damage);
+        perf_hud_stage_done(PERF_HUD_COMPOSE);
+        frame_pacer_wait();
+        perf_hud_mark();
+        if (num_damage > 0)
+            draw_stuff_screen16(widget_tree_screen(tree), damage, num_damage);
+        perf_hud_stage_done(PERF_HUD_CONVERT);
+        perf_hud_frame_done(num_damage > 0);
+
+        // animations keep the governor's frame rate, otherwise sleep until the model, an input or the clock changes
+        // something on screen
+        long tree_ms = widget_tree_ms_until_change(tree, time_mono_ms());
+        if (tree_ms != 0)
+            frame_pacer_idle(wakes, next_change_us(playing, tree_ms));
     }
 
-    free(album_str_buf);
-    free(track_str_buf);
-    free(playback_str_buf);
-    free(artist_str_buf);
-    image_loader_image_free(&screen);
+    perf_hud_cleanup();
+    widget_tree_free(&tree);
 
     init_signal_done();
     return NULL;
@@ -183,6 +239,7 @@ void *run_ui(void *arg __attribute__((unused)))
 
 void listen_press()
 {
+    display_governor_input();
     if (!rotary_encoder_pressed)
     {
         printf("Listening...\n");
@@ -268,82 +325,84 @@ void listen_press()
 
 void listen_prev()
 {
+    display_governor_input();
     printf("previous\n");
     int code = app_model_previous();
     if (code)
     {
-        cmd_errored_time = time_ms();
-        cmd_errored = true;
+        flag_error();
         fprintf(stderr, "user_interface: app_model_previous failed %d\n", code);
     }
 }
 
 void listen_next()
 {
+    display_governor_input();
     printf("next\n");
     int code = app_model_next();
     if (code)
     {
-        cmd_errored_time = time_ms();
-        cmd_errored = true;
+        flag_error();
         fprintf(stderr, "user_interface: app_model_next failed %d\n", code);
     }
 }
 
 void listen_pause_play()
 {
+    display_governor_input();
     printf("toggle pause/play\n");
     int code = app_model_toggle_pause_play();
     if (code)
     {
-        cmd_errored_time = time_ms();
-        cmd_errored = true;
+        flag_error();
         fprintf(stderr, "user_interface: app_model_toggle_pause_play failed %d\n", code);
     }
 }
 
 void listen_shuffle()
 {
+    display_governor_input();
     printf("cycle shuffle mode\n");
     int code = app_model_toggle_shuffle();
     if (code)
     {
-        cmd_errored_time = time_ms();
-        cmd_errored = true;
+        flag_error();
         fprintf(stderr, "user_interface: app_model_toggle_shuffle failed %d\n", code);
     }
 }
 
 void listen_repeat()
 {
+    display_governor_input();
     printf("cycle repeat mode\n");
     int code = app_model_toggle_repeat();
     if (code)
     {
-        cmd_errored_time = time_ms();
-        cmd_errored = true;
+        flag_error();
         fprintf(stderr, "user_interface: app_model_toggle_repeat failed %d\n", code);
     }
 }
 
+void listen_perf_hud()
+{
+    display_governor_input();
+    perf_hud_toggle();
+    frame_pacer_wake();
+}
+
 void on_encoder_turn(bool clockwise)
 {
+    display_governor_input();
     if (clockwise)
     {
         if (app_model_increase_volume())
-        {
-            cmd_errored_time = time_ms();
-            cmd_errored = true;
-        }
+            flag_error();
         // printf("Rotated Clockwise!\n");
     }
     else
     {
         if (app_model_decrease_volume())
-        {
-            cmd_errored_time = time_ms();
-            cmd_errored = true;
-        }
+            flag_error();
         // printf("Rotated Counter-Clockwise!\n");
     }
 }
@@ -357,6 +416,11 @@ int user_interface_init()
     joystick_set_on_down_listener(listen_repeat);
     joystick_set_on_left_listener(listen_prev);
     joystick_set_on_right_listener(listen_next);
+    // holding the stick's button down shows the performance overlay
+    joystick_set_on_long_press_listener(listen_perf_hud);
+
+    // model changes wake the UI thread, it sleeps while the screen has nothing to update
+    app_model_set_changed_listener(display_governor_model_changed);
 
     int thread_code = pthread_create(&ui_thread, NULL, run_ui, NULL);
     if (thread_code)
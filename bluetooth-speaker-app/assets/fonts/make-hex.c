@@ -0,0 +1,146 @@
+// Builds fallback.hex, the glyphs for code points the character images don't have, by rendering outline fonts into
+// 16 pixel tall one bit cells in the GNU Unifont .hex format. Run it on the host, it isn't part of the build:
+//
+//   gcc make-hex.c $(pkg-config --cflags --libs freetype2) -o make-hex
+//   ./make-hex DejaVuSans.ttf NanumBarunGothic.ttf > fallback.hex
+//
+// The first font gives the scripts written left to right a letter at a time, the second Hangul. See README.md
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CELL_HEIGHT 16
+
+struct range {
+    uint32_t first;
+    uint32_t last;
+};
+
+// Latin-1 symbols and the letters glyph_cache doesn't build from the atlas, Greek, Cyrillic, Armenian, Hebrew,
+// Georgian, Vietnamese, punctuation and the symbols that turn up in track names
+static const struct range NARROW_RANGES[] = {
+    {0x00A1, 0x024F}, {0x0370, 0x03FF}, {0x0400, 0x052F}, {0x0531, 0x058A}, {0x05D0, 0x05EA}, {0x10A0, 0x10FF},
+    {0x1E00, 0x1EFF}, {0x2010, 0x205E}, {0x20A0, 0x20BF}, {0x2100, 0x214F}, {0x2190, 0x21FF}, {0x2460, 0x24FF},
+    {0x25A0, 0x25FF}, {0x2600, 0x26FF},
+};
+// compatibility jamo and every Hangul syllable
+static const struct range WIDE_RANGES[] = {
+    {0x3131, 0x318E},
+    {0xAC00, 0xD7A3},
+};
+
+struct font {
+    FT_Face face;
+    // pixel size and baseline row chosen so the font's ascent and descent fill the cell
+    int baseline;
+};
+
+static bool open_font(FT_Library library, const char* path, struct font* font)
+{
+    if(FT_New_Face(library, path, 0, &font->face) != 0) {
+        fprintf(stderr, "make-hex: can't open %s\n", path);
+        return false;
+    }
+    FT_Face face = font->face;
+    double height = (double)(face->ascender - face->descender) / face->units_per_EM;
+    int pixels = (int)(CELL_HEIGHT / height);
+    FT_Set_Pixel_Sizes(face, 0, pixels);
+    font->baseline = (int)((double)face->ascender / face->units_per_EM * pixels + 0.5);
+    return true;
+}
+
+// one bit per pixel, rows of width bits, false if the font has no glyph or it's blank
+static bool render(const struct font* font, uint32_t code_point, int width, uint8_t cell[CELL_HEIGHT][2])
+{
+    FT_Face face = font->face;
+    FT_UInt index = FT_Get_Char_Index(face, code_point);
+    if(index == 0 || FT_Load_Glyph(face, index, FT_LOAD_RENDER | FT_LOAD_TARGET_MONO) != 0) {
+        return false;
+    }
+    FT_Bitmap* bitmap = &face->glyph->bitmap;
+    if(bitmap->pixel_mode != FT_PIXEL_MODE_MONO) {
+        return false;
+    }
+    // narrow glyphs sit one pixel in unless that cuts them off, wide ones are centred
+    int left = face->glyph->bitmap_left;
+    if(width == 16) {
+        left = (16 - (int)bitmap->width) / 2;
+    } else if(left + (int)bitmap->width > width) {
+        left = width - (int)bitmap->width;
+    }
+    left = left < 0 ? 0 : left;
+    int top = font->baseline - face->glyph->bitmap_top;
+    memset(cell, 0, CELL_HEIGHT * 2);
+    bool ink = false;
+    for(unsigned y = 0; y < bitmap->rows; y++) {
+        for(unsigned x = 0; x < bitmap->width; x++) {
+            int cx = left + (int)x;
+            int cy = top + (int)y;
+            if(cx >= width || cy < 0 || cy >= CELL_HEIGHT) {
+                continue;
+            }
+            if(bitmap->buffer[y * bitmap->pitch + x / 8] & (0x80 >> (x % 8))) {
+                cell[cy][cx / 8] |= 0x80 >> (cx % 8);
+                ink = true;
+            }
+        }
+    }
+    return ink;
+}
+
+static void print_cell(uint32_t code_point, int width, uint8_t cell[CELL_HEIGHT][2])
+{
+    printf("%04X:", (unsigned)code_point);
+    for(int y = 0; y < CELL_HEIGHT; y++) {
+        for(int b = 0; b < width / 8; b++) {
+            printf("%02X", cell[y][b]);
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc != 3) {
+        fprintf(stderr, "usage: %s NARROW_FONT HANGUL_FONT > fallback.hex\n", argv[0]);
+        return 2;
+    }
+    FT_Library library;
+    struct font narrow;
+    struct font wide;
+    if(FT_Init_FreeType(&library) != 0 || !open_font(library, argv[1], &narrow) || !open_font(library, argv[2], &wide)) {
+        return 1;
+    }
+
+    // the ranges are in order, so the lines come out sorted like glyph_cache needs
+    uint8_t cell[CELL_HEIGHT][2];
+    for(size_t r = 0; r < sizeof(NARROW_RANGES) / sizeof(NARROW_RANGES[0]); r++) {
+        for(uint32_t c = NARROW_RANGES[r].first; c <= NARROW_RANGES[r].last; c++) {
+            FT_UInt index = FT_Get_Char_Index(narrow.face, c);
+            if(index == 0 || FT_Load_Glyph(narrow.face, index, FT_LOAD_DEFAULT) != 0) {
+                continue;
+            }
+            int width = narrow.face->glyph->advance.x > 9 * 64 ? 16 : 8;
+            if(render(&narrow, c, width, cell)) {
+                print_cell(c, width, cell);
+            }
+        }
+    }
+    for(size_t r = 0; r < sizeof(WIDE_RANGES) / sizeof(WIDE_RANGES[0]); r++) {
+        for(uint32_t c = WIDE_RANGES[r].first; c <= WIDE_RANGES[r].last; c++) {
+            if(render(&wide, c, 16, cell)) {
+                print_cell(c, 16, cell);
+            }
+        }
+    }
+
+    FT_Done_Face(narrow.face);
+    FT_Done_Face(wide.face);
+    FT_Done_FreeType(library);
+    return 0;
+}
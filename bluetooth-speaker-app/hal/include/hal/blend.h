@@ -0,0 +1,42 @@
+// Source-over alpha blending of whole rows, the inner loop of every sprite, glyph and text strip blend. Each row goes
+// through the fastest kernel the cpu has (NEON, AVX2 or SSE2), which give exactly the same result as the scalar
+// reference: olivec_blend_color for RGBA rows and olivec16_blend_pixel for 16 bit rows. Runs of fully opaque or fully
+// transparent pixels are copied or skipped without any arithmetic
+#ifndef _BLEND_H_
+#define _BLEND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct blend_kernels {
+    const char* name;
+    // blend count RGBA src pixels over dst, dst alpha becomes src alpha + dst alpha * (1 - src alpha)
+    void (*row32)(uint32_t* dst, const uint32_t* src, size_t count);
+    // same for 16 bit pixels (see Olivec_Canvas16) with their alpha in separate planes, dst_alpha can be NULL
+    void (*row16)(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha, size_t count);
+    // the same for premultiplied sources (see olivec_premultiply), matching olivec_blend_color_premul and
+    // olivec16_mix_premul
+    void (*row32_premul)(uint32_t* dst, const uint32_t* src, size_t count);
+    void (*row16_premul)(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha,
+                         size_t count);
+};
+
+void blend_row32(uint32_t* dst, const uint32_t* src, size_t count);
+void blend_row16(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha, size_t count);
+// blend RGBA src pixels over a 16 bit row, for icons loaded as RGBA drawn onto 16 bit canvases
+void blend_row32_to16(uint16_t* dst, uint8_t* dst_alpha, const uint32_t* src, size_t count);
+void blend_row32_premul(uint32_t* dst, const uint32_t* src, size_t count);
+void blend_row16_premul(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha,
+                        size_t count);
+void blend_row32_premul_to16(uint16_t* dst, uint8_t* dst_alpha, const uint32_t* src, size_t count);
+// blend the OLIVEC_RGBA colour over a 16 bit row with coverage per pixel scaled by the colour's alpha, for tinting
+// glyph masks
+void blend_mask_row16(uint16_t* dst, uint8_t* dst_alpha, uint32_t colour, const uint8_t* coverage, size_t count);
+
+// name of the kernels the rows go through, for logging
+const char* blend_kernel_name(void);
+
+// every kernel set this cpu can run, fastest first and the scalar reference last, for tests and benchmarks
+const struct blend_kernels* blend_available_kernels(int* count);
+
+#endif
@@ -128,6 +128,18 @@ typedef enum
  */
 bool bt_player_get_property(bt_player_prop_e property, void *retval);
 
+/**
+ * Get the track info without allocating
+ *
+ * Same as bt_player_get_property with BT_PLAYER_PROP_TRACK, except the
+ * strings are copied into buf instead of being duplicated on the heap, so
+ * it can be called every frame. Strings that don't fit are cut short, and
+ * strings that aren't set are NULL. Don't free them.
+ *
+ * Returns true if the value was successfully retrieved, false otherwise.
+ */
+bool bt_player_get_track_into(bt_player_track_info_t *track, char *buf, size_t size);
+
 /**
  * Set a property value
  *
@@ -27,6 +27,9 @@ struct button_state_machine {
 // create a heap allocated state machine. on_press takes in current time as arg1 and a pointer to its state machine as arg2
 struct button_state_machine* button_state_machine_init(void (*on_press)(long, struct button_state_machine*));
 
+// on_release is called like on_press when the pressed button comes back up, NULL for nothing
+void button_state_machine_set_on_release(struct button_state_machine* state_machine, void (*on_release)(long, struct button_state_machine*));
+
 // change the state of a state machine
 void button_state_machine_update(struct button_state_machine* state_machine, bool is_rising, long curr_time);
 
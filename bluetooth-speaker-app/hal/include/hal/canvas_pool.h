@@ -0,0 +1,30 @@
+// Size class pool for long lived blocks like canvases and text strips. Freed blocks are kept on a free list per power
+// of two size class and handed out again, so things that come and go with track changes stop costing a malloc and a
+// free each time. Thread safe, needs no init
+#ifndef _CANVAS_POOL_H_
+#define _CANVAS_POOL_H_
+
+#include <stddef.h>
+
+struct canvas_pool_stats {
+    // calls that had to go to malloc or free, these stay flat once the UI has warmed up
+    long heap_allocs;
+    long heap_frees;
+    // allocations served from a free list
+    long reused;
+    // blocks waiting on the free lists and their total size
+    int cached_blocks;
+    size_t cached_bytes;
+};
+
+// returns a block of at least size bytes aligned for any type, or NULL if the heap is out of memory
+void* canvas_pool_alloc(size_t size);
+// give back a block from canvas_pool_alloc, NULL is ignored
+void canvas_pool_free(void* block);
+
+void canvas_pool_get_stats(struct canvas_pool_stats* stats);
+
+// free every cached block, e.g. at shutdown or after leaving a screen with big canvases
+void canvas_pool_trim(void);
+
+#endif
@@ -0,0 +1,45 @@
+// Panels draw_stuff can send frames to: the ST7789 over SPI, or a virtual panel for running without hardware.
+// Frames are LCD_WIDTH x LCD_HEIGHT big-endian RGB565, the format draw_stuff keeps its frame buffers in.
+#ifndef _DISPLAY_BACKEND_H_
+#define _DISPLAY_BACKEND_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DISPLAY_BACKEND_BACKLIGHT_MAX 1023
+
+// draw_stuff calls init and cleanup around its display thread, and display, display_window and frame_done on it.
+// set_sleep runs on the thread calling draw_stuff_set_sleep (the UI thread, for the display governor), with the display
+// thread held off so it never overlaps a frame. set_backlight runs on the thread calling draw_stuff_set_backlight
+// without any lock, so it can overlap a frame being sent and must not touch the panel's SPI bus or DC line.
+struct display_backend {
+    const char* name;
+    // returns 0 if successful
+    int (*init)(void);
+    void (*cleanup)(void);
+    // send a whole frame
+    void (*display)(const uint16_t* frame);
+    // send the part of frame from (x1, y1) up to but not including (x2, y2)
+    void (*display_window)(int x1, int y1, int x2, int y2, const uint16_t* frame);
+    // called after the last display or display_window of a frame
+    void (*frame_done)(void);
+    // 0 to DISPLAY_BACKEND_BACKLIGHT_MAX, any thread, see above
+    void (*set_backlight)(int level);
+    void (*set_sleep)(bool sleep);
+};
+
+extern const struct display_backend display_backend_st7789;
+extern const struct display_backend display_backend_virtual;
+
+// Where the virtual panel puts its frames, call before draw_stuff_init_backend. Either can be NULL.
+// shm_name is a POSIX shared memory object (e.g. "/bt_speaker_lcd") that always holds the current panel contents.
+// ppm_prefix writes every frame to <ppm_prefix>NNNNN.ppm
+void display_backend_virtual_set_output(const char* shm_name, const char* ppm_prefix);
+
+// what the virtual panel is showing, LCD_WIDTH x LCD_HEIGHT big-endian RGB565
+const uint16_t* display_backend_virtual_pixels(void);
+
+// frames the virtual panel has received
+long display_backend_virtual_frame_count(void);
+
+#endif
@@ -3,17 +3,65 @@
 #define _DRAW_STUFF_H_
 
 #include "hal/olive.h"
+#include <stdbool.h>
 
 #define LCD_WIDTH 240
 #define LCD_HEIGHT 240
 
+// rectangle in screen pixels, x2 and y2 are exclusive
+struct draw_stuff_rect {
+    int x1, y1;
+    int x2, y2;
+};
+
+// frame pipeline counters, latency is measured from draw_stuff_screen returning to the last byte of the frame being
+// sent
+struct draw_stuff_stats {
+    long frames_submitted;
+    long frames_displayed;
+    // frames replaced by a newer frame before the display thread got to them
+    long frames_dropped;
+    // bytes sent over SPI for the last frame, and for every frame so far
+    long last_bytes;
+    long long bytes_total;
+    // time the last frame took to go out over SPI, without the time it spent queued
+    long long last_send_us;
+    long long last_latency_us;
+    long long avg_latency_us;
+    long long max_latency_us;
+};
+
+struct display_backend;
+
+// starts the display thread, sending frames to the ST7789 LCD
 void draw_stuff_init();
+// same as draw_stuff_init but sends frames to backend, e.g. &display_backend_virtual to run without hardware
+void draw_stuff_init_backend(const struct display_backend *backend);
 void draw_stuff_cleanup();
 
 // draw a message to screen. Supports \n. If the message is too long it gets cut off.
 void draw_stuff_update_screen(char* message);
 
-// draws img to lcd at (0, 0)
+// draws img to lcd at (0, 0). Only the parts of the screen that changed since the last call are sent to the lcd.
+// img is copied before returning, the transfer happens on the display thread. If the display thread is still busy
+// with an older frame when the next one arrives, the older frame is skipped.
 void draw_stuff_screen(Olivec_Canvas* img);
 
+// copy a 16 bit canvas (see Olivec_Canvas16) to the lcd at (0, 0). damage lists the only areas that changed since the
+// previous frame, so only those areas are copied, compared and sent. Pass NULL to check the whole screen.
+void draw_stuff_screen16(const Olivec_Canvas16* img, const struct draw_stuff_rect* damage, int num_damage);
+
+// wait until every submitted frame is on the lcd
+void draw_stuff_flush(void);
+
+void draw_stuff_get_stats(struct draw_stuff_stats* stats);
+
+// 0 is off, 1023 is full brightness, levels in between dim the backlight with PWM. Runs on the caller's thread and
+// doesn't wait for the frame being sent, the backlight pin is separate from the panel's bus
+void draw_stuff_set_backlight(int level);
+
+// sleep turns the panel off and puts it in its low power sleep mode, false wakes it back up showing the same image.
+// Waits for the frame being sent to finish, then sends the command on the caller's thread
+void draw_stuff_set_sleep(bool sleep);
+
 #endif
\ No newline at end of file
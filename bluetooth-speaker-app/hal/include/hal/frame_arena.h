@@ -0,0 +1,30 @@
+// Bump allocator for memory that only lives for one frame, like the track and time strings a frame is built from.
+// Allocating is a pointer bump and frame_arena_reset frees everything at once, so the render loop never touches the
+// heap. Belongs to the UI thread
+#ifndef _FRAME_ARENA_H_
+#define _FRAME_ARENA_H_
+
+#include <stddef.h>
+
+struct frame_arena_stats {
+    size_t capacity;
+    // most bytes used by one frame
+    size_t high_water;
+    // allocations that didn't fit and went to the heap instead, capacity should be raised if this isn't 0
+    long overflows;
+};
+
+// reserve capacity bytes for each frame. Returns 0 if successful
+int frame_arena_init(size_t capacity);
+
+// start a new frame, everything allocated since the last reset is gone
+void frame_arena_reset(void);
+
+// returns size bytes aligned for any type, valid until the next frame_arena_reset
+void* frame_arena_alloc(size_t size);
+
+void frame_arena_get_stats(struct frame_arena_stats* stats);
+
+void frame_arena_cleanup(void);
+
+#endif
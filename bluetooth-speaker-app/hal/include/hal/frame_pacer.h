@@ -0,0 +1,49 @@
+// Paces a render loop to a fixed frame rate, optionally lined up with the LCD tearing effect (TE) pin
+#ifndef _FRAME_PACER_H_
+#define _FRAME_PACER_H_
+
+#include <stdbool.h>
+
+struct frame_pacer_stats {
+    long frames;
+    // frames where the work between two frame_pacer_wait calls took longer than the frame budget
+    long overruns;
+    long long worst_overrun_us;
+    // frames started on a TE edge, and waits that gave up on TE and used the timer instead
+    long te_synced;
+    long te_timeouts;
+    // time between the last two frame starts
+    long long last_period_us;
+};
+
+// te_chip and te_gpio are the gpio wired to the LCD TE pin, pass a negative te_gpio to only use the timer.
+// If the TE gpio can't be claimed the pacer falls back to the timer. Needs lg_gpio_samples_func_init() first.
+// Returns 0 if successful
+int frame_pacer_init(int fps, int te_chip, int te_gpio);
+
+// blocks until the next frame should start. Call once per frame, right before sending the frame to the LCD
+void frame_pacer_wait(void);
+
+// change the target frame rate, call from the thread that calls frame_pacer_wait
+void frame_pacer_set_fps(int fps);
+
+// end the current (or next) frame_pacer_wait early so a frame starts straight away, e.g. to react to input.
+// Safe to call from any thread
+void frame_pacer_wake(void);
+
+// how many times frame_pacer_wake has been called, read it before looking at the state a frame is drawn from
+long frame_pacer_wake_count(void);
+
+// for loops that only draw when something changed. Blocks until frame_pacer_wake is called after wake_count was read
+// (straight away if it already was) or until deadline_us on the time_us clock, a negative deadline waits for a wake
+// only. The frame_pacer_wait after it doesn't sleep or count an overrun. Returns true if woken
+bool frame_pacer_idle(long wake_count, long long deadline_us);
+
+// true if frames are being lined up with TE edges
+bool frame_pacer_te_enabled(void);
+
+void frame_pacer_get_stats(struct frame_pacer_stats* stats);
+
+void frame_pacer_cleanup(void);
+
+#endif
@@ -5,13 +5,23 @@
 #include "stdint.h"
 #include "hal/olive.h"
 
-// create a heap allocated x by y image. 
+// create an x by y image, the struct and pixels are one block from the canvas pool. NULL if out of memory
 Olivec_Canvas* image_loader_image_create(int x, int y);
 
-// create a heap allocated image from a file
+// create a heap allocated image from a file. Its colours are premultiplied by alpha, blend it with the *_premul
+// functions
 Olivec_Canvas* image_loader_load(const char* path);
 
 // free an Olivec_Canvas created by image_loader_image_create or image_loader_load
 void image_loader_image_free(Olivec_Canvas** image);
 
+// create a heap allocated x by y 16 bit image, with an alpha plane if with_alpha is true. NULL if out of memory
+Olivec_Canvas16* image_loader_image16_create(int x, int y, bool with_alpha);
+
+// create a heap allocated 16 bit copy of the premultiplied image that keeps its alpha. NULL if out of memory
+Olivec_Canvas16* image_loader_image16_from(Olivec_Canvas* image);
+
+// free an Olivec_Canvas16 created by image_loader_image16_create or image_loader_image16_from
+void image_loader_image16_free(Olivec_Canvas16** image);
+
 #endif
\ No newline at end of file
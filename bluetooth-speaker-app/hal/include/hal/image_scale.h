@@ -0,0 +1,21 @@
+// Area filter downscaling of decoded images straight into the panel's pixel format. Each output pixel is the average of
+// the source pixels it covers. Summing the source rows is the bulk of the work and uses NEON (or SSE2) when available
+#ifndef _IMAGE_SCALE_H_
+#define _IMAGE_SCALE_H_
+
+#include "hal/olive.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Scale the src_width x src_height block of 8 bit RGB pixels at rgb (stride bytes per row) to fill dst. The source
+// should be at least as big as dst, smaller sources are scaled up with nearest neighbour. dst's alpha plane is set
+// opaque if it has one
+void image_scale_rgb_to16(const uint8_t* rgb, int src_width, int src_height, int stride, Olivec_Canvas16 dst);
+
+// same, using only the plain C loops. For checking the vector version against
+void image_scale_rgb_to16_scalar(const uint8_t* rgb, int src_width, int src_height, int stride, Olivec_Canvas16 dst);
+
+// true if image_scale_rgb_to16 is using vector instructions on this build
+bool image_scale_is_vectorized(void);
+
+#endif
@@ -19,7 +19,7 @@ int joystick_read_y(float* result);
 // from -1.0 to 1.0, up being 1.0, right being 1.0. Returns 0 is successful
 int joystick_read_xy(struct joystick_position* result);
 
-// triggers when the joystick button is pressed
+// triggers when the joystick button is released after a short press
 void joystick_set_on_press_listener(void (*on_press)());
 
 // triggers when a joystick is moved up, triggers repeatedly at regular intervals when the joystick is held in the up position
@@ -34,5 +34,8 @@ void joystick_set_on_left_listener(void (*on_left)());
 // triggers when a joystick is moved right, triggers repeatedly at regular intervals when the joystick is held in the right position
 void joystick_set_on_right_listener(void (*on_right)());
 
+// triggers once the joystick button has been held down for a moment, instead of the press listener on release
+void joystick_set_on_long_press_listener(void (*on_long_press)());
+
 void joystick_cleanup(void);
 #endif
\ No newline at end of file
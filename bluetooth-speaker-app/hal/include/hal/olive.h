@@ -446,6 +446,111 @@ OLIVECDEF void olivec_sprite_copy(Olivec_Canvas oc, int x, int y, int w, int h,
 OLIVECDEF void olivec_sprite_copy_bilinear(Olivec_Canvas oc, int x, int y, int w, int h, Olivec_Canvas sprite);
 OLIVECDEF uint32_t olivec_pixel_bilinear(Olivec_Canvas sprite, int nx, int ny, int w, int h);
 
+// Premultiplied alpha: every colour channel is already scaled by the pixel's alpha, so blending is
+// dst = src + dst*(255 - a)/255 with the division done as a multiply and a shift. image_loader_load returns canvases
+// in this form, use the *_premul blends on them. Results match the straight alpha blends within rounding.
+OLIVECDEF uint32_t olivec_premultiply_color(uint32_t color);
+OLIVECDEF uint32_t olivec_unpremultiply_color(uint32_t color);
+OLIVECDEF void olivec_premultiply(Olivec_Canvas oc);
+OLIVECDEF void olivec_unpremultiply(Olivec_Canvas oc);
+// blend premultiplied c2 over premultiplied *c1
+OLIVECDEF void olivec_blend_color_premul(uint32_t *c1, uint32_t c2);
+OLIVECDEF void olivec_sprite_blend_premul(Olivec_Canvas oc, int x, int y, int w, int h, Olivec_Canvas sprite);
+
+// 16 bit canvas. Pixels are RGB565 stored high byte first (on a little endian cpu that is the byte swapped value),
+// the order SPI panels like the ST7789 take them in, so a finished canvas can be sent without converting it.
+// alpha is an optional 8 bit plane using the same stride as pixels, NULL means every pixel is opaque.
+// Colours passed to the olivec16_* functions are normal OLIVEC_RGBA colours.
+typedef struct {
+    uint16_t *pixels;
+    uint8_t *alpha;
+    size_t width;
+    size_t height;
+    size_t stride;
+} Olivec_Canvas16;
+
+#define OLIVEC_CANVAS16_NULL ((Olivec_Canvas16) {0})
+#define OLIVEC_PIXEL16(oc, x, y) (oc).pixels[(y)*(oc).stride + (x)]
+#define OLIVEC_PIXEL16_ALPHA(oc, x, y) (oc).alpha[(y)*(oc).stride + (x)]
+// pack an OLIVEC_RGBA colour into the Olivec_Canvas16 pixel format. Opaque OLIVEC_RGBA values are negative ints, so the
+// colour is made unsigned before shifting
+#define OLIVEC_RGB565(color) ((uint16_t)(((uint32_t)(color)&0xF8) | (((uint32_t)(color)>>13)&0x07) | \
+                                         (((uint32_t)(color)<<3)&0xE000) | (((uint32_t)(color)>>11)&0x1F00)))
+// unpack an Olivec_Canvas16 pixel back into an OLIVEC_RGBA colour with alpha a, the low bits of each channel are 0
+#define OLIVEC_RGBA_FROM565(pixel, a) OLIVEC_RGBA((pixel)&0xF8, (((pixel)&0x07)<<5) | (((pixel)>>11)&0x1C), ((pixel)>>5)&0xF8, (a))
+
+OLIVECDEF Olivec_Canvas16 olivec16_canvas(uint16_t *pixels, uint8_t *alpha, size_t width, size_t height, size_t stride);
+OLIVECDEF Olivec_Canvas16 olivec16_subcanvas(Olivec_Canvas16 oc, int x, int y, int w, int h);
+// blend the 16 bit colour c2 with coverage a2 over *c1. Both mixes are inline so row loops built with optimization
+// don't pay a call per pixel
+static inline uint16_t olivec16_mix(uint16_t c1, uint16_t c2, uint32_t a2)
+{
+    if (a2 >= 255) return c2;
+    if (a2 == 0) return c1;
+
+    // back to native RGB565, then spread green into the top half so all three channels blend in one multiply
+    uint32_t d = (uint16_t) ((c1 >> 8) | (c1 << 8));
+    uint32_t s = (uint16_t) ((c2 >> 8) | (c2 << 8));
+    d = (d | (d << 16)) & 0x07E0F81F;
+    s = (s | (s << 16)) & 0x07E0F81F;
+    uint32_t a = (a2 + 4) >> 3;
+    uint32_t r = ((d*(32 - a) + s*a) >> 5) & 0x07E0F81F;
+    r = (r | (r >> 16)) & 0xFFFF;
+    return (uint16_t) ((r >> 8) | (r << 8));
+}
+OLIVECDEF void olivec16_fill(Olivec_Canvas16 oc, uint32_t color);
+OLIVECDEF void olivec16_rect(Olivec_Canvas16 oc, int x, int y, int w, int h, uint32_t color);
+OLIVECDEF void olivec16_triangle(Olivec_Canvas16 oc, int x1, int y1, int x2, int y2, int x3, int y3, uint32_t color);
+// blend a 16 bit sprite using its alpha plane
+OLIVECDEF void olivec16_sprite_blend(Olivec_Canvas16 oc, int x, int y, int w, int h, Olivec_Canvas16 sprite);
+// blend an RGBA sprite, e.g. text rendered by the 32 bit routines
+OLIVECDEF void olivec16_sprite_blend32(Olivec_Canvas16 oc, int x, int y, int w, int h, Olivec_Canvas sprite);
+// blend the premultiplied 16 bit colour c2 with alpha a2 over c1
+static inline uint16_t olivec16_mix_premul(uint16_t c1, uint16_t c2, uint32_t a2)
+{
+    if (a2 >= 255) return c2;
+    if (a2 == 0) return c1;
+
+    // like olivec16_mix, but the source is already scaled so only the destination is multiplied
+    uint32_t d = (uint16_t) ((c1 >> 8) | (c1 << 8));
+    uint32_t s = (uint16_t) ((c2 >> 8) | (c2 << 8));
+    d = (d | (d << 16)) & 0x07E0F81F;
+    s = (s | (s << 16)) & 0x07E0F81F;
+    uint32_t a = (a2 + 4) >> 3;
+    uint32_t r = ((d*(32 - a) >> 5) & 0x07E0F81F) + s;
+    r = (r | (r >> 16)) & 0xFFFF;
+    return (uint16_t) ((r >> 8) | (r << 8));
+}
+// blend a premultiplied RGBA sprite, e.g. an icon from image_loader_load
+OLIVECDEF void olivec16_sprite_blend32_premul(Olivec_Canvas16 oc, int x, int y, int w, int h, Olivec_Canvas sprite);
+OLIVECDEF void olivec16_sprite_copy(Olivec_Canvas16 oc, int x, int y, int w, int h, Olivec_Canvas16 sprite);
+// convert src into dst, which must be at least as big. The alpha channel is kept if dst has an alpha plane
+OLIVECDEF void olivec16_from_canvas(Olivec_Canvas16 dst, Olivec_Canvas src);
+// same for a premultiplied src, dst gets straight colours like every Olivec_Canvas16
+OLIVECDEF void olivec16_from_canvas_premul(Olivec_Canvas16 dst, Olivec_Canvas src);
+
+// 8 bit coverage without a colour, e.g. glyphs. The colour is picked when the mask is drawn, the coverage is scaled by
+// its alpha
+typedef struct {
+    uint8_t *coverage;
+    size_t width;
+    size_t height;
+    size_t stride;
+} Olivec_Mask;
+
+#define OLIVEC_MASK_NULL ((Olivec_Mask) {0})
+#define OLIVEC_COVERAGE(mask, x, y) (mask).coverage[(y)*(mask).stride + (x)]
+
+OLIVECDEF Olivec_Mask olivec_mask(uint8_t *coverage, size_t width, size_t height, size_t stride);
+OLIVECDEF Olivec_Mask olivec_mask_subcanvas(Olivec_Mask mask, int x, int y, int w, int h);
+// the alpha channel of src as coverage, dst must be at least as big
+OLIVECDEF void olivec_mask_from_canvas(Olivec_Mask dst, Olivec_Canvas src);
+// blend mask in color into a premultiplied canvas with its top left corner at (x, y)
+OLIVECDEF void olivec_mask_blend_premul(Olivec_Canvas oc, int x, int y, Olivec_Mask mask, uint32_t color);
+OLIVECDEF void olivec16_mask_blend(Olivec_Canvas16 oc, int x, int y, Olivec_Mask mask, uint32_t color);
+// write color with the coverage as alpha instead of blending, for building images that are blended later
+OLIVECDEF void olivec16_mask_copy(Olivec_Canvas16 oc, int x, int y, Olivec_Mask mask, uint32_t color);
+
 typedef struct {
     // Safe ranges to iterate over.
     int x1, x2;
@@ -474,7 +579,15 @@ OLIVECDEF bool olivec_normalize_rect(int x, int y, int w, int h,
 
 #endif // OLIVE_C_
 
-#ifdef OLIVEC_IMPLEMENTATION
+// guarded so headers included below can include this file again
+#if defined(OLIVEC_IMPLEMENTATION) && !defined(OLIVEC_IMPLEMENTATION_INCLUDED)
+#define OLIVEC_IMPLEMENTATION_INCLUDED
+
+#include <string.h>
+// row kernels for the unscaled sprite blends
+#include "hal/blend.h"
+// scanline fills for the 16 bit triangles
+#include "hal/raster.h"
 
 OLIVECDEF Olivec_Canvas olivec_canvas(uint32_t *pixels, size_t width, size_t height, size_t stride)
 {
@@ -587,6 +700,68 @@ OLIVECDEF void olivec_blend_color(uint32_t *c1, uint32_t c2)
     *c1 = OLIVEC_RGBA(r1_new, g1_new, b1_new, out_a);
 }
 
+// x/255 rounded to nearest, exact for x up to 255*255
+static inline uint32_t olivec_div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+OLIVECDEF uint32_t olivec_premultiply_color(uint32_t color)
+{
+    uint32_t a = OLIVEC_ALPHA(color);
+    if (a == 255) return color;
+    return OLIVEC_RGBA(olivec_div255(OLIVEC_RED(color)*a), olivec_div255(OLIVEC_GREEN(color)*a),
+                       olivec_div255(OLIVEC_BLUE(color)*a), a);
+}
+
+OLIVECDEF uint32_t olivec_unpremultiply_color(uint32_t color)
+{
+    uint32_t a = OLIVEC_ALPHA(color);
+    if (a == 255) return color;
+    if (a == 0) return 0;
+    uint32_t r = (OLIVEC_RED(color)*255 + a/2)/a;
+    uint32_t g = (OLIVEC_GREEN(color)*255 + a/2)/a;
+    uint32_t b = (OLIVEC_BLUE(color)*255 + a/2)/a;
+    return OLIVEC_RGBA(r > 255 ? 255 : r, g > 255 ? 255 : g, b > 255 ? 255 : b, a);
+}
+
+OLIVECDEF void olivec_premultiply(Olivec_Canvas oc)
+{
+    for (size_t y = 0; y < oc.height; ++y) {
+        for (size_t x = 0; x < oc.width; ++x) {
+            OLIVEC_PIXEL(oc, x, y) = olivec_premultiply_color(OLIVEC_PIXEL(oc, x, y));
+        }
+    }
+}
+
+OLIVECDEF void olivec_unpremultiply(Olivec_Canvas oc)
+{
+    for (size_t y = 0; y < oc.height; ++y) {
+        for (size_t x = 0; x < oc.width; ++x) {
+            OLIVEC_PIXEL(oc, x, y) = olivec_unpremultiply_color(OLIVEC_PIXEL(oc, x, y));
+        }
+    }
+}
+
+OLIVECDEF void olivec_blend_color_premul(uint32_t *c1, uint32_t c2)
+{
+    uint32_t a2 = OLIVEC_ALPHA(c2);
+    if (a2 == 255) {
+        *c1 = c2;
+        return;
+    }
+    if (a2 == 0) return;
+
+    // the same multiply-add for all four channels, alpha included
+    uint32_t inv = 255 - a2;
+    uint32_t d = *c1;
+    *c1 = OLIVEC_RGBA(OLIVEC_RED(c2) + olivec_div255(OLIVEC_RED(d)*inv),
+                      OLIVEC_GREEN(c2) + olivec_div255(OLIVEC_GREEN(d)*inv),
+                      OLIVEC_BLUE(c2) + olivec_div255(OLIVEC_BLUE(d)*inv),
+                      a2 + olivec_div255(OLIVEC_ALPHA(d)*inv));
+}
+
 OLIVECDEF void olivec_fill(Olivec_Canvas oc, uint32_t color)
 {
     for (size_t y = 0; y < oc.height; ++y) {
@@ -842,7 +1017,8 @@ OLIVECDEF void olivec_triangle3z(Olivec_Canvas oc, int x1, int y1, int x2, int y
                 int u1, u2, det;
                 if (olivec_barycentric(x1, y1, x2, y2, x3, y3, x, y, &u1, &u2, &det)) {
                     float z = z1*u1/det + z2*u2/det + z3*(det - u1 - u2)/det;
-                    OLIVEC_PIXEL(oc, x, y) = *(uint32_t*)&z;
+                    // the bits of z, memcpy keeps it within the aliasing rules at -O2
+                    memcpy(&OLIVEC_PIXEL(oc, x, y), &z, sizeof(z));
                 }
             }
         }
@@ -956,6 +1132,13 @@ OLIVECDEF void olivec_sprite_blend(Olivec_Canvas oc, int x, int y, int w, int h,
     if (w < 0) xa = nr.ox2;
     int ya = nr.oy1;
     if (h < 0) ya = nr.oy2;
+    if (w == (int) sprite.width && h == (int) sprite.height) {
+        // same size, whole rows go through the blend kernels
+        for (int y = nr.y1; y <= nr.y2; ++y) {
+            blend_row32(&OLIVEC_PIXEL(oc, nr.x1, y), &OLIVEC_PIXEL(sprite, nr.x1 - xa, y - ya), nr.x2 - nr.x1 + 1);
+        }
+        return;
+    }
     for (int y = nr.y1; y <= nr.y2; ++y) {
         for (int x = nr.x1; x <= nr.x2; ++x) {
             size_t nx = (x - xa)*((int) sprite.width)/w;
@@ -967,6 +1150,33 @@ OLIVECDEF void olivec_sprite_blend(Olivec_Canvas oc, int x, int y, int w, int h,
     }
 }
 
+OLIVECDEF void olivec_sprite_blend_premul(Olivec_Canvas oc, int x, int y, int w, int h, Olivec_Canvas sprite)
+{
+    if (sprite.width == 0) return;
+    if (sprite.height == 0) return;
+
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr)) return;
+
+    int xa = nr.ox1;
+    if (w < 0) xa = nr.ox2;
+    int ya = nr.oy1;
+    if (h < 0) ya = nr.oy2;
+    if (w == (int) sprite.width && h == (int) sprite.height) {
+        for (int y = nr.y1; y <= nr.y2; ++y) {
+            blend_row32_premul(&OLIVEC_PIXEL(oc, nr.x1, y), &OLIVEC_PIXEL(sprite, nr.x1 - xa, y - ya), nr.x2 - nr.x1 + 1);
+        }
+        return;
+    }
+    for (int y = nr.y1; y <= nr.y2; ++y) {
+        size_t ny = (y - ya)*((int) sprite.height)/h;
+        for (int x = nr.x1; x <= nr.x2; ++x) {
+            size_t nx = (x - xa)*((int) sprite.width)/w;
+            olivec_blend_color_premul(&OLIVEC_PIXEL(oc, x, y), OLIVEC_PIXEL(sprite, nx, ny));
+        }
+    }
+}
+
 OLIVECDEF void olivec_sprite_copy(Olivec_Canvas oc, int x, int y, int w, int h, Olivec_Canvas sprite)
 {
     if (sprite.width == 0) return;
@@ -1050,6 +1260,321 @@ OLIVECDEF void olivec_sprite_copy_bilinear(Olivec_Canvas oc, int x, int y, int w
     }
 }
 
+OLIVECDEF Olivec_Canvas16 olivec16_canvas(uint16_t *pixels, uint8_t *alpha, size_t width, size_t height, size_t stride)
+{
+    Olivec_Canvas16 oc = {
+        .pixels = pixels,
+        .alpha  = alpha,
+        .width  = width,
+        .height = height,
+        .stride = stride,
+    };
+    return oc;
+}
+
+OLIVECDEF Olivec_Canvas16 olivec16_subcanvas(Olivec_Canvas16 oc, int x, int y, int w, int h)
+{
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr)) return OLIVEC_CANVAS16_NULL;
+    oc.pixels = &OLIVEC_PIXEL16(oc, nr.x1, nr.y1);
+    if (oc.alpha) oc.alpha = &OLIVEC_PIXEL16_ALPHA(oc, nr.x1, nr.y1);
+    oc.width = nr.x2 - nr.x1 + 1;
+    oc.height = nr.y2 - nr.y1 + 1;
+    return oc;
+}
+
+// blend one pixel, keeping the destination alpha plane (if any) the same way olivec_blend_color does
+static inline void olivec16_blend_pixel(Olivec_Canvas16 oc, size_t x, size_t y, uint16_t c2, uint32_t a2)
+{
+    uint16_t *p = &OLIVEC_PIXEL16(oc, x, y);
+    *p = olivec16_mix(*p, c2, a2);
+    if (oc.alpha) {
+        uint8_t *pa = &OLIVEC_PIXEL16_ALPHA(oc, x, y);
+        *pa = a2 + (*pa)*(255 - a2)/255;
+    }
+}
+
+OLIVECDEF void olivec16_fill(Olivec_Canvas16 oc, uint32_t color)
+{
+    uint16_t c = OLIVEC_RGB565(color);
+    for (size_t y = 0; y < oc.height; ++y) {
+        uint16_t *row = &OLIVEC_PIXEL16(oc, 0, y);
+        for (size_t x = 0; x < oc.width; ++x) {
+            row[x] = c;
+        }
+        if (oc.alpha) memset(&OLIVEC_PIXEL16_ALPHA(oc, 0, y), OLIVEC_ALPHA(color), oc.width);
+    }
+}
+
+OLIVECDEF void olivec16_rect(Olivec_Canvas16 oc, int x, int y, int w, int h, uint32_t color)
+{
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr)) return;
+    uint32_t a = OLIVEC_ALPHA(color);
+    if (a == 0) return;
+    uint16_t c = OLIVEC_RGB565(color);
+    for (int y = nr.y1; y <= nr.y2; ++y) {
+        if (a == 255) {
+            uint16_t *row = &OLIVEC_PIXEL16(oc, 0, y);
+            for (int x = nr.x1; x <= nr.x2; ++x) {
+                row[x] = c;
+            }
+            if (oc.alpha) memset(&OLIVEC_PIXEL16_ALPHA(oc, nr.x1, y), 255, nr.x2 - nr.x1 + 1);
+        } else {
+            for (int x = nr.x1; x <= nr.x2; ++x) {
+                olivec16_blend_pixel(oc, x, y, c, a);
+            }
+        }
+    }
+}
+
+OLIVECDEF void olivec16_triangle(Olivec_Canvas16 oc, int x1, int y1, int x2, int y2, int x3, int y3, uint32_t color)
+{
+    // the barycentric test at integer points picks the same pixels as a span per row through the pixel centres
+    if ((x1 - x3)*(y2 - y3) != (x2 - x3)*(y1 - y3)) {
+        raster_triangle(oc, x1 + 0.5f, y1 + 0.5f, x2 + 0.5f, y2 + 0.5f, x3 + 0.5f, y3 + 0.5f, color, false);
+        return;
+    }
+    // without any area the test above has its own idea of what to draw, keep it
+    int lx, hx, ly, hy;
+    uint16_t c = OLIVEC_RGB565(color);
+    if (olivec_normalize_triangle(oc.width, oc.height, x1, y1, x2, y2, x3, y3, &lx, &hx, &ly, &hy)) {
+        for (int y = ly; y <= hy; ++y) {
+            for (int x = lx; x <= hx; ++x) {
+                int u1, u2, det;
+                if (olivec_barycentric(x1, y1, x2, y2, x3, y3, x, y, &u1, &u2, &det)) {
+                    olivec16_blend_pixel(oc, x, y, c, OLIVEC_ALPHA(color));
+                }
+            }
+        }
+    }
+}
+
+OLIVECDEF void olivec16_sprite_blend(Olivec_Canvas16 oc, int x, int y, int w, int h, Olivec_Canvas16 sprite)
+{
+    if (sprite.width == 0) return;
+    if (sprite.height == 0) return;
+    if (sprite.alpha == NULL) {
+        olivec16_sprite_copy(oc, x, y, w, h, sprite);
+        return;
+    }
+
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr)) return;
+
+    int xa = nr.ox1;
+    if (w < 0) xa = nr.ox2;
+    int ya = nr.oy1;
+    if (h < 0) ya = nr.oy2;
+    if (w == (int) sprite.width && h == (int) sprite.height) {
+        // same size, whole rows go through the blend kernels
+        for (int y = nr.y1; y <= nr.y2; ++y) {
+            blend_row16(&OLIVEC_PIXEL16(oc, nr.x1, y), oc.alpha ? &OLIVEC_PIXEL16_ALPHA(oc, nr.x1, y) : NULL,
+                        &OLIVEC_PIXEL16(sprite, nr.x1 - xa, y - ya), &OLIVEC_PIXEL16_ALPHA(sprite, nr.x1 - xa, y - ya),
+                        nr.x2 - nr.x1 + 1);
+        }
+        return;
+    }
+    for (int y = nr.y1; y <= nr.y2; ++y) {
+        size_t ny = (y - ya)*((int) sprite.height)/h;
+        for (int x = nr.x1; x <= nr.x2; ++x) {
+            size_t nx = (x - xa)*((int) sprite.width)/w;
+            olivec16_blend_pixel(oc, x, y, OLIVEC_PIXEL16(sprite, nx, ny), OLIVEC_PIXEL16_ALPHA(sprite, nx, ny));
+        }
+    }
+}
+
+OLIVECDEF void olivec16_sprite_blend32(Olivec_Canvas16 oc, int x, int y, int w, int h, Olivec_Canvas sprite)
+{
+    if (sprite.width == 0) return;
+    if (sprite.height == 0) return;
+
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr)) return;
+
+    int xa = nr.ox1;
+    if (w < 0) xa = nr.ox2;
+    int ya = nr.oy1;
+    if (h < 0) ya = nr.oy2;
+    if (w == (int) sprite.width && h == (int) sprite.height) {
+        // same size, whole rows go through the blend kernels
+        for (int y = nr.y1; y <= nr.y2; ++y) {
+            blend_row32_to16(&OLIVEC_PIXEL16(oc, nr.x1, y), oc.alpha ? &OLIVEC_PIXEL16_ALPHA(oc, nr.x1, y) : NULL,
+                             &OLIVEC_PIXEL(sprite, nr.x1 - xa, y - ya), nr.x2 - nr.x1 + 1);
+        }
+        return;
+    }
+    for (int y = nr.y1; y <= nr.y2; ++y) {
+        size_t ny = (y - ya)*((int) sprite.height)/h;
+        for (int x = nr.x1; x <= nr.x2; ++x) {
+            size_t nx = (x - xa)*((int) sprite.width)/w;
+            uint32_t c = OLIVEC_PIXEL(sprite, nx, ny);
+            olivec16_blend_pixel(oc, x, y, OLIVEC_RGB565(c), OLIVEC_ALPHA(c));
+        }
+    }
+}
+
+OLIVECDEF void olivec16_sprite_blend32_premul(Olivec_Canvas16 oc, int x, int y, int w, int h, Olivec_Canvas sprite)
+{
+    if (sprite.width == 0) return;
+    if (sprite.height == 0) return;
+
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr)) return;
+
+    int xa = nr.ox1;
+    if (w < 0) xa = nr.ox2;
+    int ya = nr.oy1;
+    if (h < 0) ya = nr.oy2;
+    if (w == (int) sprite.width && h == (int) sprite.height) {
+        for (int y = nr.y1; y <= nr.y2; ++y) {
+            blend_row32_premul_to16(&OLIVEC_PIXEL16(oc, nr.x1, y), oc.alpha ? &OLIVEC_PIXEL16_ALPHA(oc, nr.x1, y) : NULL,
+                                    &OLIVEC_PIXEL(sprite, nr.x1 - xa, y - ya), nr.x2 - nr.x1 + 1);
+        }
+        return;
+    }
+    for (int y = nr.y1; y <= nr.y2; ++y) {
+        size_t ny = (y - ya)*((int) sprite.height)/h;
+        for (int x = nr.x1; x <= nr.x2; ++x) {
+            size_t nx = (x - xa)*((int) sprite.width)/w;
+            uint32_t c = OLIVEC_PIXEL(sprite, nx, ny);
+            uint32_t a2 = OLIVEC_ALPHA(c);
+            uint16_t *p = &OLIVEC_PIXEL16(oc, x, y);
+            *p = olivec16_mix_premul(*p, OLIVEC_RGB565(c), a2);
+            if (oc.alpha) {
+                uint8_t *pa = &OLIVEC_PIXEL16_ALPHA(oc, x, y);
+                *pa = a2 + olivec_div255((*pa)*(255 - a2));
+            }
+        }
+    }
+}
+
+OLIVECDEF void olivec16_sprite_copy(Olivec_Canvas16 oc, int x, int y, int w, int h, Olivec_Canvas16 sprite)
+{
+    if (sprite.width == 0) return;
+    if (sprite.height == 0) return;
+
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr)) return;
+
+    int xa = nr.ox1;
+    if (w < 0) xa = nr.ox2;
+    int ya = nr.oy1;
+    if (h < 0) ya = nr.oy2;
+    bool unscaled = w == (int) sprite.width && h == (int) sprite.height;
+    for (int y = nr.y1; y <= nr.y2; ++y) {
+        size_t ny = (y - ya)*((int) sprite.height)/h;
+        if (unscaled) {
+            // same size, whole rows can be copied
+            size_t n = nr.x2 - nr.x1 + 1;
+            memcpy(&OLIVEC_PIXEL16(oc, nr.x1, y), &OLIVEC_PIXEL16(sprite, nr.x1 - xa, ny), n*sizeof(uint16_t));
+            if (oc.alpha) {
+                if (sprite.alpha) memcpy(&OLIVEC_PIXEL16_ALPHA(oc, nr.x1, y), &OLIVEC_PIXEL16_ALPHA(sprite, nr.x1 - xa, ny), n);
+                else memset(&OLIVEC_PIXEL16_ALPHA(oc, nr.x1, y), 255, n);
+            }
+            continue;
+        }
+        for (int x = nr.x1; x <= nr.x2; ++x) {
+            size_t nx = (x - xa)*((int) sprite.width)/w;
+            OLIVEC_PIXEL16(oc, x, y) = OLIVEC_PIXEL16(sprite, nx, ny);
+            if (oc.alpha) OLIVEC_PIXEL16_ALPHA(oc, x, y) = sprite.alpha ? OLIVEC_PIXEL16_ALPHA(sprite, nx, ny) : 255;
+        }
+    }
+}
+
+OLIVECDEF void olivec16_from_canvas(Olivec_Canvas16 dst, Olivec_Canvas src)
+{
+    for (size_t y = 0; y < src.height && y < dst.height; ++y) {
+        for (size_t x = 0; x < src.width && x < dst.width; ++x) {
+            uint32_t c = OLIVEC_PIXEL(src, x, y);
+            OLIVEC_PIXEL16(dst, x, y) = OLIVEC_RGB565(c);
+            if (dst.alpha) OLIVEC_PIXEL16_ALPHA(dst, x, y) = OLIVEC_ALPHA(c);
+        }
+    }
+}
+
+OLIVECDEF void olivec16_from_canvas_premul(Olivec_Canvas16 dst, Olivec_Canvas src)
+{
+    for (size_t y = 0; y < src.height && y < dst.height; ++y) {
+        for (size_t x = 0; x < src.width && x < dst.width; ++x) {
+            uint32_t c = olivec_unpremultiply_color(OLIVEC_PIXEL(src, x, y));
+            OLIVEC_PIXEL16(dst, x, y) = OLIVEC_RGB565(c);
+            if (dst.alpha) OLIVEC_PIXEL16_ALPHA(dst, x, y) = OLIVEC_ALPHA(c);
+        }
+    }
+}
+
+OLIVECDEF Olivec_Mask olivec_mask(uint8_t *coverage, size_t width, size_t height, size_t stride)
+{
+    Olivec_Mask mask = {
+        .coverage = coverage,
+        .width = width,
+        .height = height,
+        .stride = stride,
+    };
+    return mask;
+}
+
+OLIVECDEF Olivec_Mask olivec_mask_subcanvas(Olivec_Mask mask, int x, int y, int w, int h)
+{
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, w, h, mask.width, mask.height, &nr)) return OLIVEC_MASK_NULL;
+    mask.coverage = &OLIVEC_COVERAGE(mask, nr.x1, nr.y1);
+    mask.width = nr.x2 - nr.x1 + 1;
+    mask.height = nr.y2 - nr.y1 + 1;
+    return mask;
+}
+
+OLIVECDEF void olivec_mask_from_canvas(Olivec_Mask dst, Olivec_Canvas src)
+{
+    for (size_t y = 0; y < src.height && y < dst.height; ++y) {
+        for (size_t x = 0; x < src.width && x < dst.width; ++x) {
+            OLIVEC_COVERAGE(dst, x, y) = OLIVEC_ALPHA(OLIVEC_PIXEL(src, x, y));
+        }
+    }
+}
+
+OLIVECDEF void olivec_mask_blend_premul(Olivec_Canvas oc, int x, int y, Olivec_Mask mask, uint32_t color)
+{
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, mask.width, mask.height, oc.width, oc.height, &nr)) return;
+    uint32_t a = OLIVEC_ALPHA(color);
+    for (int y = nr.y1; y <= nr.y2; ++y) {
+        for (int x = nr.x1; x <= nr.x2; ++x) {
+            uint32_t coverage = olivec_div255(OLIVEC_COVERAGE(mask, x - nr.ox1, y - nr.oy1)*a);
+            uint32_t c = (color & 0x00FFFFFF) | (coverage << (8*3));
+            olivec_blend_color_premul(&OLIVEC_PIXEL(oc, x, y), olivec_premultiply_color(c));
+        }
+    }
+}
+
+OLIVECDEF void olivec16_mask_blend(Olivec_Canvas16 oc, int x, int y, Olivec_Mask mask, uint32_t color)
+{
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, mask.width, mask.height, oc.width, oc.height, &nr)) return;
+    for (int y = nr.y1; y <= nr.y2; ++y) {
+        blend_mask_row16(&OLIVEC_PIXEL16(oc, nr.x1, y), oc.alpha ? &OLIVEC_PIXEL16_ALPHA(oc, nr.x1, y) : NULL, color,
+                         &OLIVEC_COVERAGE(mask, nr.x1 - nr.ox1, y - nr.oy1), nr.x2 - nr.x1 + 1);
+    }
+}
+
+OLIVECDEF void olivec16_mask_copy(Olivec_Canvas16 oc, int x, int y, Olivec_Mask mask, uint32_t color)
+{
+    Olivec_Normalized_Rect nr = {0};
+    if (!olivec_normalize_rect(x, y, mask.width, mask.height, oc.width, oc.height, &nr)) return;
+    uint16_t c = OLIVEC_RGB565(color);
+    uint32_t a = OLIVEC_ALPHA(color);
+    for (int y = nr.y1; y <= nr.y2; ++y) {
+        for (int x = nr.x1; x <= nr.x2; ++x) {
+            OLIVEC_PIXEL16(oc, x, y) = c;
+        }
+        if (oc.alpha == NULL) continue;
+        for (int x = nr.x1; x <= nr.x2; ++x) {
+            OLIVEC_PIXEL16_ALPHA(oc, x, y) = olivec_div255(OLIVEC_COVERAGE(mask, x - nr.ox1, y - nr.oy1)*a);
+        }
+    }
+}
+
 #endif // OLIVEC_IMPLEMENTATION
 
 // TODO: Benchmarking
@@ -0,0 +1,29 @@
+// Filled shapes for 16 bit canvases, drawn a scanline at a time. Each row of a shape is its horizontal extent, so the
+// inside is filled as one span and only the pixels on the edges get any per pixel work, instead of testing every
+// pixel of the bounding box. Every shape is convex.
+//
+// Coordinates are floats on the pixel grid, pixel (x, y) covers x to x + 1 and y to y + 1. Without antialiasing a pixel
+// is drawn if its centre is inside the shape, edges included. With it, edge pixels are blended by how much of them the
+// shape covers
+#ifndef _RASTER_H_
+#define _RASTER_H_
+
+#include "hal/olive.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RASTER_MAX_POINTS 8
+
+// fill the triangle in the OLIVEC_RGBA colour, the corners can be in any order
+void raster_triangle(Olivec_Canvas16 canvas, float x1, float y1, float x2, float y2, float x3, float y3,
+                     uint32_t colour, bool antialias);
+// fill a convex polygon of count points, up to RASTER_MAX_POINTS. points holds x and y of each, in either winding
+void raster_polygon(Olivec_Canvas16 canvas, const float* points, int count, uint32_t colour, bool antialias);
+// a line thickness wide with square ends at (x1, y1) and (x2, y2)
+void raster_line(Olivec_Canvas16 canvas, float x1, float y1, float x2, float y2, float thickness, uint32_t colour,
+                 bool antialias);
+// a rectangle with its corners rounded off by quarter circles of radius, which is capped at half the shorter side
+void raster_round_rect(Olivec_Canvas16 canvas, float x, float y, float width, float height, float radius,
+                       uint32_t colour, bool antialias);
+
+#endif
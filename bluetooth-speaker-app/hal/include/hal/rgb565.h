@@ -0,0 +1,33 @@
+// Converts RGBA Olivec canvases into the byte-swapped (big-endian) RGB565 format the LCD expects
+#ifndef _RGB565_H_
+#define _RGB565_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hal/olive.h"
+
+// clockwise rotation applied while converting, matches the ROTATE_* behaviour of Paint_SetPixel
+enum rgb565_rotation {
+    RGB565_ROTATE_0,
+    RGB565_ROTATE_90,
+    RGB565_ROTATE_180,
+    RGB565_ROTATE_270,
+};
+
+// pack one RGBA colour as RGB565 with its bytes in panel order
+static inline uint16_t rgb565_from_rgba(uint32_t colour)
+{
+    return OLIVEC_RGB565(colour);
+}
+
+// convert count RGBA pixels to panel order RGB565 using the fastest kernel available on this cpu
+void rgb565_convert_row(uint16_t* dst, const uint32_t* src, size_t count);
+
+// convert src into a dst_width x dst_height panel order RGB565 buffer.
+// Parts of dst not covered by the (rotated) src are set to fill, which is a normal RGB565 colour like WHITE.
+void rgb565_convert(uint16_t* dst, int dst_width, int dst_height, Olivec_Canvas src, enum rgb565_rotation rotation, uint16_t fill);
+
+// name of the row kernel rgb565_convert_row uses, for logging
+const char* rgb565_kernel_name(void);
+
+#endif
@@ -0,0 +1,53 @@
+// Run length encoded sprites for mostly transparent images like icons. Each row is stored as the spans that have
+// something in them, so blitting skips the transparent margins and gaps without reading them, copies opaque spans with
+// memcpy and only blends the rest. Built once when the image is loaded, read only afterwards.
+//
+// Text isn't worth encoding. Antialiased glyphs have almost no opaque runs to copy, atlas glyphs are already trimmed to
+// their ink and the blend kernels skip transparent pixels nearly for free, so rle-bench only measures 1.0x to 1.3x
+#ifndef _RLE_SPRITE_H_
+#define _RLE_SPRITE_H_
+
+#include "hal/olive.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct rle_span {
+    // first pixel of the span in the row
+    uint16_t x;
+    uint16_t length;
+    // every pixel has alpha 255, so the span is copied instead of blended
+    bool opaque;
+    // index of the span's first pixel in pixels and alpha
+    uint32_t data;
+};
+
+struct rle_sprite {
+    int width;
+    int height;
+    // pixels are premultiplied by alpha, like images from image_loader_load
+    bool premultiplied;
+    // the spans of row y are spans[rows[y]] up to spans[rows[y + 1]], rows has height + 1 entries
+    const uint32_t* rows;
+    const struct rle_span* spans;
+    // RGB565 in the same byte order as Olivec_Canvas16 and an alpha per pixel, only for pixels in a span
+    const uint16_t* pixels;
+    const uint8_t* alpha;
+    int num_spans;
+    // size of the whole sprite, one block from the canvas pool
+    size_t bytes;
+};
+
+// encode a 16 bit image with straight colour. An image without an alpha plane
+// becomes one opaque span per row. Returns NULL if out of memory
+struct rle_sprite* rle_sprite_from16(Olivec_Canvas16 image);
+
+// encode a premultiplied RGBA image from image_loader_load. Returns NULL if out of memory
+struct rle_sprite* rle_sprite_from_premul(Olivec_Canvas image);
+
+// blend sprite into canvas with its top left corner at (x, y), anything outside canvas is clipped
+void rle_sprite_blit(Olivec_Canvas16 canvas, int x, int y, const struct rle_sprite* sprite);
+
+void rle_sprite_free(struct rle_sprite** sprite);
+
+#endif
@@ -2,8 +2,15 @@
 #ifndef _TIME_UTIL_H
 #define _TIME_UTIL_H
 
+// wall clock milliseconds, steps when the clock is set
 long time_ms(void);
 
+// milliseconds from a monotonic clock, for timing animations and timeouts that must not jump when the clock is set
+long time_mono_ms(void);
+
+// microseconds from a monotonic clock, for measuring intervals
+long long time_us(void);
+
 int sleep_ms(long miliseconds);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,665 @@
+#include "hal/blend.h"
+#include "hal/olive.h"
+#include "hal/rgb565.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLEND_HAVE_X86
+#endif
+
+// The vector kernels divide by 255 with (t + 1 + (t >> 8)) >> 8, which is exact for every t up to 255 * 255, so they
+// match the division in the scalar reference bit for bit. Source-over in one formula per channel:
+//   colour = (dst * (255 - a) + src * a) / 255
+//   alpha  = (dst_alpha * (255 - a) + 255 * a) / 255 = a + dst_alpha * (255 - a) / 255
+// 16 bit pixels blend with a in 32 steps like olivec16_mix:
+//   channel = (dst * (32 - a5) + src * a5) >> 5, a5 = (a + 4) >> 3
+// Both are already exact for a = 0 and 255, the fast paths just avoid the arithmetic.
+// Premultiplied sources only scale the destination, rounding like olivec_div255 does:
+//   channel = src + (dst * (255 - a) + 128) / 255, and for 16 bit pixels src + (dst * (32 - a5)) >> 5
+
+static void row32_scalar(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    for(size_t i = 0; i < count; i++) {
+        olivec_blend_color(&dst[i], src[i]);
+    }
+}
+
+static void row16_scalar(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha, size_t count)
+{
+    for(size_t i = 0; i < count; i++) {
+        uint32_t a = src_alpha[i];
+        if(a == 0) {
+            continue;
+        }
+        dst[i] = olivec16_mix(dst[i], src[i], a);
+        if(dst_alpha != NULL) {
+            dst_alpha[i] = a + dst_alpha[i] * (255 - a) / 255;
+        }
+    }
+}
+
+static void row32_premul_scalar(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    for(size_t i = 0; i < count; i++) {
+        olivec_blend_color_premul(&dst[i], src[i]);
+    }
+}
+
+static void row16_premul_scalar(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha,
+                                size_t count)
+{
+    for(size_t i = 0; i < count; i++) {
+        uint32_t a = src_alpha[i];
+        if(a == 0) {
+            continue;
+        }
+        dst[i] = olivec16_mix_premul(dst[i], src[i], a);
+        if(dst_alpha != NULL) {
+            uint32_t t = dst_alpha[i] * (255 - a) + 128;
+            dst_alpha[i] = a + ((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+#if defined(__ARM_NEON)
+
+static inline uint16x8_t div255_round_neon(uint16x8_t t)
+{
+    t = vaddq_u16(t, vdupq_n_u16(128));
+    return vshrq_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+static inline uint16x8_t div255_neon(uint16x8_t t)
+{
+    return vshrq_n_u16(vaddq_u16(vaddq_u16(t, vdupq_n_u16(1)), vshrq_n_u16(t, 8)), 8);
+}
+
+static inline bool all_u8_neon(uint8x8_t v, uint64_t value)
+{
+    return vget_lane_u64(vreinterpret_u64_u8(v), 0) == value;
+}
+
+// 8 pixels per iteration, vld4 splits the channels so every lane is one channel of one pixel
+static void row32_neon(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t*)(src + i));
+        if(all_u8_neon(s.val[3], UINT64_MAX)) {
+            memcpy(dst + i, src + i, 8 * sizeof(uint32_t));
+            continue;
+        }
+        if(all_u8_neon(s.val[3], 0)) {
+            continue;
+        }
+        uint8x8x4_t d = vld4_u8((const uint8_t*)(dst + i));
+        uint8x8_t a = s.val[3];
+        uint8x8_t inv_a = vmvn_u8(a);
+        for(int c = 0; c < 3; c++) {
+            d.val[c] = vmovn_u16(div255_neon(vmlal_u8(vmull_u8(d.val[c], inv_a), s.val[c], a)));
+        }
+        d.val[3] = vmovn_u16(div255_neon(vmlal_u8(vmull_u8(d.val[3], inv_a), vdup_n_u8(255), a)));
+        vst4_u8((uint8_t*)(dst + i), d);
+    }
+    row32_scalar(dst + i, src + i, count - i);
+}
+
+static void row16_neon(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha, size_t count)
+{
+    size_t i = 0;
+    const uint16x8_t mask5 = vdupq_n_u16(0x1F);
+    const uint16x8_t mask6 = vdupq_n_u16(0x3F);
+    for(; i + 8 <= count; i += 8) {
+        uint8x8_t a8 = vld1_u8(src_alpha + i);
+        if(all_u8_neon(a8, UINT64_MAX)) {
+            memcpy(dst + i, src + i, 8 * sizeof(uint16_t));
+            if(dst_alpha != NULL) {
+                memset(dst_alpha + i, 255, 8);
+            }
+            continue;
+        }
+        if(all_u8_neon(a8, 0)) {
+            continue;
+        }
+        uint16x8_t a = vmovl_u8(a8);
+        uint16x8_t a5 = vshrq_n_u16(vaddq_u16(a, vdupq_n_u16(4)), 3);
+        uint16x8_t inv_a5 = vsubq_u16(vdupq_n_u16(32), a5);
+        // panel order to native RGB565
+        uint16x8_t d = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(vld1q_u16(dst + i))));
+        uint16x8_t s = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(vld1q_u16(src + i))));
+        uint16x8_t r = vmlaq_u16(vmulq_u16(vshrq_n_u16(d, 11), inv_a5), vshrq_n_u16(s, 11), a5);
+        uint16x8_t g = vmlaq_u16(vmulq_u16(vandq_u16(vshrq_n_u16(d, 5), mask6), inv_a5),
+                                 vandq_u16(vshrq_n_u16(s, 5), mask6), a5);
+        uint16x8_t b = vmlaq_u16(vmulq_u16(vandq_u16(d, mask5), inv_a5), vandq_u16(s, mask5), a5);
+        uint16x8_t out = vorrq_u16(vshlq_n_u16(vshrq_n_u16(r, 5), 11),
+                                   vorrq_u16(vshlq_n_u16(vshrq_n_u16(g, 5), 5), vshrq_n_u16(b, 5)));
+        vst1q_u16(dst + i, vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(out))));
+        if(dst_alpha != NULL) {
+            uint16x8_t t = vmull_u8(vld1_u8(dst_alpha + i), vmvn_u8(a8));
+            vst1_u8(dst_alpha + i, vmovn_u16(vaddq_u16(div255_neon(t), a)));
+        }
+    }
+    row16_scalar(dst + i, dst_alpha ? dst_alpha + i : NULL, src + i, src_alpha + i, count - i);
+}
+
+static void row32_premul_neon(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t*)(src + i));
+        if(all_u8_neon(s.val[3], UINT64_MAX)) {
+            memcpy(dst + i, src + i, 8 * sizeof(uint32_t));
+            continue;
+        }
+        if(all_u8_neon(s.val[3], 0)) {
+            continue;
+        }
+        uint8x8x4_t d = vld4_u8((const uint8_t*)(dst + i));
+        uint8x8_t inv_a = vmvn_u8(s.val[3]);
+        for(int c = 0; c < 4; c++) {
+            d.val[c] = vadd_u8(s.val[c], vmovn_u16(div255_round_neon(vmull_u8(d.val[c], inv_a))));
+        }
+        vst4_u8((uint8_t*)(dst + i), d);
+    }
+    row32_premul_scalar(dst + i, src + i, count - i);
+}
+
+static void row16_premul_neon(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha,
+                              size_t count)
+{
+    size_t i = 0;
+    const uint16x8_t mask5 = vdupq_n_u16(0x1F);
+    const uint16x8_t mask6 = vdupq_n_u16(0x3F);
+    for(; i + 8 <= count; i += 8) {
+        uint8x8_t a8 = vld1_u8(src_alpha + i);
+        if(all_u8_neon(a8, UINT64_MAX)) {
+            memcpy(dst + i, src + i, 8 * sizeof(uint16_t));
+            if(dst_alpha != NULL) {
+                memset(dst_alpha + i, 255, 8);
+            }
+            continue;
+        }
+        if(all_u8_neon(a8, 0)) {
+            continue;
+        }
+        uint16x8_t a = vmovl_u8(a8);
+        uint16x8_t inv_a5 = vsubq_u16(vdupq_n_u16(32), vshrq_n_u16(vaddq_u16(a, vdupq_n_u16(4)), 3));
+        uint16x8_t d = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(vld1q_u16(dst + i))));
+        uint16x8_t s = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(vld1q_u16(src + i))));
+        uint16x8_t r = vaddq_u16(vshrq_n_u16(vmulq_u16(vshrq_n_u16(d, 11), inv_a5), 5), vshrq_n_u16(s, 11));
+        uint16x8_t g = vaddq_u16(vshrq_n_u16(vmulq_u16(vandq_u16(vshrq_n_u16(d, 5), mask6), inv_a5), 5),
+                                 vandq_u16(vshrq_n_u16(s, 5), mask6));
+        uint16x8_t b = vaddq_u16(vshrq_n_u16(vmulq_u16(vandq_u16(d, mask5), inv_a5), 5), vandq_u16(s, mask5));
+        uint16x8_t out = vorrq_u16(vshlq_n_u16(r, 11), vorrq_u16(vshlq_n_u16(g, 5), b));
+        vst1q_u16(dst + i, vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(out))));
+        if(dst_alpha != NULL) {
+            uint16x8_t t = vmull_u8(vld1_u8(dst_alpha + i), vmvn_u8(a8));
+            vst1_u8(dst_alpha + i, vmovn_u16(vaddq_u16(div255_round_neon(t), a)));
+        }
+    }
+    row16_premul_scalar(dst + i, dst_alpha ? dst_alpha + i : NULL, src + i, src_alpha + i, count - i);
+}
+
+#endif
+
+#ifdef BLEND_HAVE_X86
+
+// The x86 kernels share their arithmetic through these macros, instantiated for 128 bit (sse2) and 256 bit (avx2)
+// vectors. V is the vector type and P the intrinsic prefix
+
+// blend 16 bit lanes holding one channel each: (d * (255 - a) + s * a) / 255
+#define BLEND_DIV255(P, t) P##_srli_epi16(P##_add_epi16(P##_add_epi16(t, P##_set1_epi16(1)), P##_srli_epi16(t, 8)), 8)
+#define BLEND_DIV255_ROUND(P, t) \
+    P##_srli_epi16(P##_add_epi16(P##_add_epi16(t, P##_set1_epi16(128)), \
+                                 P##_srli_epi16(P##_add_epi16(t, P##_set1_epi16(128)), 8)), 8)
+#define BLEND_LANES(P, d, s, a) \
+    BLEND_DIV255(P, P##_add_epi16(P##_mullo_epi16(d, P##_sub_epi16(P##_set1_epi16(255), a)), P##_mullo_epi16(s, a)))
+
+// 16 bit lanes of panel order RGB565 blended with 5 bit alpha a5
+#define BLEND_565(P, V, BITS, d_in, s_in, a5, out)                                                                   \
+    do {                                                                                                              \
+        V d_ = P##_or_si##BITS(P##_slli_epi16(d_in, 8), P##_srli_epi16(d_in, 8));                                     \
+        V s_ = P##_or_si##BITS(P##_slli_epi16(s_in, 8), P##_srli_epi16(s_in, 8));                                     \
+        V inv_ = P##_sub_epi16(P##_set1_epi16(32), a5);                                                               \
+        V m5_ = P##_set1_epi16(0x1F);                                                                                 \
+        V m6_ = P##_set1_epi16(0x3F);                                                                                 \
+        V r_ = P##_add_epi16(P##_mullo_epi16(P##_srli_epi16(d_, 11), inv_), P##_mullo_epi16(P##_srli_epi16(s_, 11), a5)); \
+        V g_ = P##_add_epi16(P##_mullo_epi16(P##_and_si##BITS(P##_srli_epi16(d_, 5), m6_), inv_),                       \
+                             P##_mullo_epi16(P##_and_si##BITS(P##_srli_epi16(s_, 5), m6_), a5));                       \
+        V b_ = P##_add_epi16(P##_mullo_epi16(P##_and_si##BITS(d_, m5_), inv_), P##_mullo_epi16(P##_and_si##BITS(s_, m5_), a5)); \
+        V n_ = P##_or_si##BITS(P##_slli_epi16(P##_srli_epi16(r_, 5), 11),                                             \
+                               P##_or_si##BITS(P##_slli_epi16(P##_srli_epi16(g_, 5), 5), P##_srli_epi16(b_, 5)));     \
+        out = P##_or_si##BITS(P##_slli_epi16(n_, 8), P##_srli_epi16(n_, 8));                                          \
+    } while(0)
+
+// premultiplied: src + (dst * (32 - a5)) >> 5 per channel
+#define BLEND_565_PREMUL(P, V, BITS, d_in, s_in, a5, out)                                                            \
+    do {                                                                                                              \
+        V d_ = P##_or_si##BITS(P##_slli_epi16(d_in, 8), P##_srli_epi16(d_in, 8));                                     \
+        V s_ = P##_or_si##BITS(P##_slli_epi16(s_in, 8), P##_srli_epi16(s_in, 8));                                     \
+        V inv_ = P##_sub_epi16(P##_set1_epi16(32), a5);                                                               \
+        V m5_ = P##_set1_epi16(0x1F);                                                                                 \
+        V m6_ = P##_set1_epi16(0x3F);                                                                                 \
+        V r_ = P##_add_epi16(P##_srli_epi16(P##_mullo_epi16(P##_srli_epi16(d_, 11), inv_), 5), P##_srli_epi16(s_, 11)); \
+        V g_ = P##_add_epi16(P##_srli_epi16(P##_mullo_epi16(P##_and_si##BITS(P##_srli_epi16(d_, 5), m6_), inv_), 5),   \
+                             P##_and_si##BITS(P##_srli_epi16(s_, 5), m6_));                                           \
+        V b_ = P##_add_epi16(P##_srli_epi16(P##_mullo_epi16(P##_and_si##BITS(d_, m5_), inv_), 5), P##_and_si##BITS(s_, m5_)); \
+        V n_ = P##_or_si##BITS(P##_slli_epi16(r_, 11), P##_or_si##BITS(P##_slli_epi16(g_, 5), b_));                   \
+        out = P##_or_si##BITS(P##_slli_epi16(n_, 8), P##_srli_epi16(n_, 8));                                          \
+    } while(0)
+
+__attribute__((target("sse2")))
+static void row32_sse2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000);
+    for(; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i s_alpha = _mm_and_si128(s, alpha_mask);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, alpha_mask)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i*)(dst + i), s);
+            continue;
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, zero)) == 0xFFFF) {
+            continue;
+        }
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        // every channel of a pixel is weighted by its alpha, and the alpha channel blends towards 255
+        __m128i a = _mm_srli_epi32(s, 24);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+        s = _mm_or_si128(s, alpha_mask);
+        __m128i lo = BLEND_LANES(_mm, _mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(a, zero));
+        __m128i hi = BLEND_LANES(_mm, _mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(a, zero));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    row32_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void row16_sse2(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha, size_t count)
+{
+    size_t i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8((char)0xFF);
+    for(; i + 8 <= count; i += 8) {
+        __m128i a8 = _mm_loadl_epi64((const __m128i*)(src_alpha + i));
+        if((_mm_movemask_epi8(_mm_cmpeq_epi8(a8, ones)) & 0xFF) == 0xFF) {
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+            if(dst_alpha != NULL) {
+                _mm_storel_epi64((__m128i*)(dst_alpha + i), ones);
+            }
+            continue;
+        }
+        if((_mm_movemask_epi8(_mm_cmpeq_epi8(a8, zero)) & 0xFF) == 0xFF) {
+            continue;
+        }
+        __m128i a = _mm_unpacklo_epi8(a8, zero);
+        __m128i a5 = _mm_srli_epi16(_mm_add_epi16(a, _mm_set1_epi16(4)), 3);
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i out;
+        BLEND_565(_mm, __m128i, 128, d, s, a5, out);
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+        if(dst_alpha != NULL) {
+            __m128i da = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(dst_alpha + i)), zero);
+            __m128i t = _mm_mullo_epi16(da, _mm_sub_epi16(_mm_set1_epi16(255), a));
+            __m128i res = _mm_add_epi16(BLEND_DIV255(_mm, t), a);
+            _mm_storel_epi64((__m128i*)(dst_alpha + i), _mm_packus_epi16(res, zero));
+        }
+    }
+    row16_scalar(dst + i, dst_alpha ? dst_alpha + i : NULL, src + i, src_alpha + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void row32_premul_sse2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000);
+    for(; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i s_alpha = _mm_and_si128(s, alpha_mask);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, alpha_mask)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i*)(dst + i), s);
+            continue;
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, zero)) == 0xFFFF) {
+            continue;
+        }
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        // 255 - a in every channel of each pixel
+        __m128i inv = _mm_srli_epi32(_mm_xor_si128(s, alpha_mask), 24);
+        inv = _mm_or_si128(inv, _mm_slli_epi32(inv, 8));
+        inv = _mm_or_si128(inv, _mm_slli_epi32(inv, 16));
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(inv, zero));
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(inv, zero));
+        __m128i scaled = _mm_packus_epi16(BLEND_DIV255_ROUND(_mm, lo), BLEND_DIV255_ROUND(_mm, hi));
+        // byte adds wrap like the scalar version's channel masks
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi8(scaled, s));
+    }
+    row32_premul_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void row16_premul_sse2(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha,
+                              size_t count)
+{
+    size_t i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8((char)0xFF);
+    for(; i + 8 <= count; i += 8) {
+        __m128i a8 = _mm_loadl_epi64((const __m128i*)(src_alpha + i));
+        if((_mm_movemask_epi8(_mm_cmpeq_epi8(a8, ones)) & 0xFF) == 0xFF) {
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+            if(dst_alpha != NULL) {
+                _mm_storel_epi64((__m128i*)(dst_alpha + i), ones);
+            }
+            continue;
+        }
+        if((_mm_movemask_epi8(_mm_cmpeq_epi8(a8, zero)) & 0xFF) == 0xFF) {
+            continue;
+        }
+        __m128i a = _mm_unpacklo_epi8(a8, zero);
+        __m128i a5 = _mm_srli_epi16(_mm_add_epi16(a, _mm_set1_epi16(4)), 3);
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i out;
+        BLEND_565_PREMUL(_mm, __m128i, 128, d, s, a5, out);
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+        if(dst_alpha != NULL) {
+            __m128i da = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(dst_alpha + i)), zero);
+            __m128i t = _mm_mullo_epi16(da, _mm_sub_epi16(_mm_set1_epi16(255), a));
+            __m128i res = _mm_add_epi16(BLEND_DIV255_ROUND(_mm, t), a);
+            _mm_storel_epi64((__m128i*)(dst_alpha + i), _mm_packus_epi16(res, zero));
+        }
+    }
+    row16_premul_scalar(dst + i, dst_alpha ? dst_alpha + i : NULL, src + i, src_alpha + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void row32_avx2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32((int)0xFF000000);
+    for(; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i s_alpha = _mm256_and_si256(s, alpha_mask);
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(s_alpha, alpha_mask)) == -1) {
+            _mm256_storeu_si256((__m256i*)(dst + i), s);
+            continue;
+        }
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(s_alpha, zero)) == -1) {
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i a = _mm256_srli_epi32(s, 24);
+        a = _mm256_or_si256(a, _mm256_slli_epi32(a, 8));
+        a = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+        s = _mm256_or_si256(s, alpha_mask);
+        // unpack and pack both work within 128 bit halves, so the pixels come back out in order
+        __m256i lo = BLEND_LANES(_mm256, _mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero),
+                                 _mm256_unpacklo_epi8(a, zero));
+        __m256i hi = BLEND_LANES(_mm256, _mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero),
+                                 _mm256_unpackhi_epi8(a, zero));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    row32_sse2(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void row16_avx2(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha, size_t count)
+{
+    size_t i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8((char)0xFF);
+    for(; i + 16 <= count; i += 16) {
+        __m128i a8 = _mm_loadu_si128((const __m128i*)(src_alpha + i));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(a8, ones)) == 0xFFFF) {
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_loadu_si256((const __m256i*)(src + i)));
+            if(dst_alpha != NULL) {
+                _mm_storeu_si128((__m128i*)(dst_alpha + i), ones);
+            }
+            continue;
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(a8, zero)) == 0xFFFF) {
+            continue;
+        }
+        __m256i a = _mm256_cvtepu8_epi16(a8);
+        __m256i a5 = _mm256_srli_epi16(_mm256_add_epi16(a, _mm256_set1_epi16(4)), 3);
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i out;
+        BLEND_565(_mm256, __m256i, 256, d, s, a5, out);
+        _mm256_storeu_si256((__m256i*)(dst + i), out);
+        if(dst_alpha != NULL) {
+            __m256i da = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(dst_alpha + i)));
+            __m256i t = _mm256_mullo_epi16(da, _mm256_sub_epi16(_mm256_set1_epi16(255), a));
+            __m256i res = _mm256_add_epi16(BLEND_DIV255(_mm256, t), a);
+            __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(res), _mm256_extracti128_si256(res, 1));
+            _mm_storeu_si128((__m128i*)(dst_alpha + i), packed);
+        }
+    }
+    row16_sse2(dst + i, dst_alpha ? dst_alpha + i : NULL, src + i, src_alpha + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void row32_premul_avx2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32((int)0xFF000000);
+    for(; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i s_alpha = _mm256_and_si256(s, alpha_mask);
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(s_alpha, alpha_mask)) == -1) {
+            _mm256_storeu_si256((__m256i*)(dst + i), s);
+            continue;
+        }
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(s_alpha, zero)) == -1) {
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i inv = _mm256_srli_epi32(_mm256_xor_si256(s, alpha_mask), 24);
+        inv = _mm256_or_si256(inv, _mm256_slli_epi32(inv, 8));
+        inv = _mm256_or_si256(inv, _mm256_slli_epi32(inv, 16));
+        __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(inv, zero));
+        __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(inv, zero));
+        __m256i scaled = _mm256_packus_epi16(BLEND_DIV255_ROUND(_mm256, lo), BLEND_DIV255_ROUND(_mm256, hi));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi8(scaled, s));
+    }
+    row32_premul_sse2(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void row16_premul_avx2(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha,
+                              size_t count)
+{
+    size_t i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8((char)0xFF);
+    for(; i + 16 <= count; i += 16) {
+        __m128i a8 = _mm_loadu_si128((const __m128i*)(src_alpha + i));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(a8, ones)) == 0xFFFF) {
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_loadu_si256((const __m256i*)(src + i)));
+            if(dst_alpha != NULL) {
+                _mm_storeu_si128((__m128i*)(dst_alpha + i), ones);
+            }
+            continue;
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(a8, zero)) == 0xFFFF) {
+            continue;
+        }
+        __m256i a = _mm256_cvtepu8_epi16(a8);
+        __m256i a5 = _mm256_srli_epi16(_mm256_add_epi16(a, _mm256_set1_epi16(4)), 3);
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i out;
+        BLEND_565_PREMUL(_mm256, __m256i, 256, d, s, a5, out);
+        _mm256_storeu_si256((__m256i*)(dst + i), out);
+        if(dst_alpha != NULL) {
+            __m256i da = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(dst_alpha + i)));
+            __m256i t = _mm256_mullo_epi16(da, _mm256_sub_epi16(_mm256_set1_epi16(255), a));
+            __m256i res = _mm256_add_epi16(BLEND_DIV255_ROUND(_mm256, t), a);
+            __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(res), _mm256_extracti128_si256(res, 1));
+            _mm_storeu_si128((__m128i*)(dst_alpha + i), packed);
+        }
+    }
+    row16_premul_sse2(dst + i, dst_alpha ? dst_alpha + i : NULL, src + i, src_alpha + i, count - i);
+}
+
+#endif
+
+static const struct blend_kernels KERNELS[] = {
+#if defined(__ARM_NEON)
+    {"neon", row32_neon, row16_neon, row32_premul_neon, row16_premul_neon},
+#elif defined(BLEND_HAVE_X86)
+    {"avx2", row32_avx2, row16_avx2, row32_premul_avx2, row16_premul_avx2},
+    {"sse2", row32_sse2, row16_sse2, row32_premul_sse2, row16_premul_sse2},
+#endif
+    {"scalar", row32_scalar, row16_scalar, row32_premul_scalar, row16_premul_scalar},
+};
+#define NUM_KERNELS ((int)(sizeof(KERNELS) / sizeof(KERNELS[0])))
+
+static bool kernel_supported(const struct blend_kernels* kernels)
+{
+#if defined(BLEND_HAVE_X86)
+    __builtin_cpu_init();
+    if(kernels->row32 == row32_avx2) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if(kernels->row32 == row32_sse2) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    (void)kernels;
+    return true;
+}
+
+// filled once by detect_kernels, pthread_once makes the table visible to every thread that gets past it
+static pthread_once_t detect_once = PTHREAD_ONCE_INIT;
+static struct blend_kernels available[NUM_KERNELS];
+static int num_available = 0;
+
+static void detect_kernels(void)
+{
+    for(int i = 0; i < NUM_KERNELS; i++) {
+        if(kernel_supported(&KERNELS[i])) {
+            available[num_available++] = KERNELS[i];
+        }
+    }
+}
+
+// the fastest kernel this CPU runs, scalar is always supported so there is at least one
+static const struct blend_kernels* pick_kernel(void)
+{
+    pthread_once(&detect_once, detect_kernels);
+    return &available[0];
+}
+
+void blend_row32(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    pick_kernel()->row32(dst, src, count);
+}
+
+// rows shorter than the narrowest vector would only reach the kernel's scalar tail, so skip the dispatch. Glyph and
+// sprite edges are mostly spans this short
+#define SHORT_ROW 8
+
+void blend_row16(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha, size_t count)
+{
+    if(count < SHORT_ROW) {
+        row16_scalar(dst, dst_alpha, src, src_alpha, count);
+        return;
+    }
+    pick_kernel()->row16(dst, dst_alpha, src, src_alpha, count);
+}
+
+// split into 16 bit pixels and alpha a chunk at a time, then blend like any 16 bit row
+static void row32_to16(uint16_t* dst, uint8_t* dst_alpha, const uint32_t* src, size_t count,
+                       void (*row16)(uint16_t*, uint8_t*, const uint16_t*, const uint8_t*, size_t))
+{
+    enum { CHUNK = 64 };
+    uint16_t pixels[CHUNK];
+    uint8_t alpha[CHUNK];
+    for(size_t i = 0; i < count; i += CHUNK) {
+        size_t n = count - i < CHUNK ? count - i : CHUNK;
+        rgb565_convert_row(pixels, src + i, n);
+        for(size_t j = 0; j < n; j++) {
+            alpha[j] = src[i + j] >> 24;
+        }
+        row16(dst + i, dst_alpha ? dst_alpha + i : NULL, pixels, alpha, n);
+    }
+}
+
+void blend_row32_to16(uint16_t* dst, uint8_t* dst_alpha, const uint32_t* src, size_t count)
+{
+    row32_to16(dst, dst_alpha, src, count, pick_kernel()->row16);
+}
+
+void blend_row32_premul(uint32_t* dst, const uint32_t* src, size_t count)
+{
+    pick_kernel()->row32_premul(dst, src, count);
+}
+
+void blend_row16_premul(uint16_t* dst, uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha,
+                        size_t count)
+{
+    if(count < SHORT_ROW) {
+        row16_premul_scalar(dst, dst_alpha, src, src_alpha, count);
+        return;
+    }
+    pick_kernel()->row16_premul(dst, dst_alpha, src, src_alpha, count);
+}
+
+void blend_row32_premul_to16(uint16_t* dst, uint8_t* dst_alpha, const uint32_t* src, size_t count)
+{
+    row32_to16(dst, dst_alpha, src, count, pick_kernel()->row16_premul);
+}
+
+void blend_mask_row16(uint16_t* dst, uint8_t* dst_alpha, uint32_t colour, const uint8_t* coverage, size_t count)
+{
+    // a row of the colour is blended with the coverage as its alpha, a chunk at a time
+    enum { CHUNK = 64 };
+    uint16_t pixels[CHUNK];
+    uint8_t alpha[CHUNK];
+    uint16_t c = OLIVEC_RGB565(colour);
+    uint32_t a = OLIVEC_ALPHA(colour);
+    for(size_t i = 0; i < CHUNK && i < count; i++) {
+        pixels[i] = c;
+    }
+    void (*row16)(uint16_t*, uint8_t*, const uint16_t*, const uint8_t*, size_t) =
+        count < SHORT_ROW ? row16_scalar : pick_kernel()->row16;
+    for(size_t i = 0; i < count; i += CHUNK) {
+        size_t n = count - i < CHUNK ? count - i : CHUNK;
+        const uint8_t* chunk_alpha = coverage + i;
+        if(a != 255) {
+            for(size_t j = 0; j < n; j++) {
+                uint32_t t = coverage[i + j] * a + 128;
+                alpha[j] = (t + (t >> 8)) >> 8;
+            }
+            chunk_alpha = alpha;
+        }
+        row16(dst + i, dst_alpha ? dst_alpha + i : NULL, pixels, chunk_alpha, n);
+    }
+}
+
+const char* blend_kernel_name(void)
+{
+    return pick_kernel()->name;
+}
+
+const struct blend_kernels* blend_available_kernels(int* count)
+{
+    pick_kernel();
+    *count = num_available;
+    return available;
+}
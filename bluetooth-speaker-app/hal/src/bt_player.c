@@ -279,6 +279,44 @@ bool bt_player_get_property(bt_player_prop_e property, void *retval)
     return ret;
 }
 
+// copy str to the start of *buf, moving *buf and *size past it. Returns NULL if str is NULL
+static char *copy_into(const char *str, char **buf, size_t *size)
+{
+    if (!str || *size == 0)
+        return NULL;
+
+    char *copy = *buf;
+    size_t len = strlen(str);
+    if (len >= *size)
+        len = *size - 1;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    *buf += len + 1;
+    *size -= len + 1;
+    return copy;
+}
+
+bool bt_player_get_track_into(bt_player_track_info_t *track, char *buf, size_t size)
+{
+    prop_entry_t *entry;
+
+    entry = &prop_entries[BT_PLAYER_PROP_TRACK];
+
+    pthread_mutex_lock(&entry->mtx);
+
+    track->title = copy_into(props.track_info.title, &buf, &size);
+    track->artist = copy_into(props.track_info.artist, &buf, &size);
+    track->album = copy_into(props.track_info.album, &buf, &size);
+    track->genre = copy_into(props.track_info.genre, &buf, &size);
+    track->track_count = props.track_info.track_count;
+    track->track_number = props.track_info.track_number;
+    track->duration = props.track_info.duration;
+
+    pthread_mutex_unlock(&entry->mtx);
+
+    return true;
+}
+
 bool bt_player_set_property(bt_player_prop_e property, void *arg)
 {
     const prop_entry_t *prop_entry;
@@ -18,6 +18,11 @@ struct button_state_machine* button_state_machine_init(void (*on_press)(long, st
     return state_machine;
 }
 
+void button_state_machine_set_on_release(struct button_state_machine* state_machine, void (*on_release)(long, struct button_state_machine*))
+{
+    state_machine->states[1].rising.action = on_release;
+}
+
 void button_state_machine_update(struct button_state_machine* state_machine, bool is_rising, long curr_time)
 {
     struct button_state_event* state_event = NULL;
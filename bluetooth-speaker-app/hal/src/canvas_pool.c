@@ -0,0 +1,119 @@
+#include "hal/canvas_pool.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// classes are 2^MIN_CLASS_SHIFT to 2^MAX_CLASS_SHIFT bytes, the largest fits a 240x240 RGBA canvas
+#define MIN_CLASS_SHIFT 6
+#define MAX_CLASS_SHIFT 18
+#define NUM_CLASSES (MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1)
+// bigger blocks aren't pooled
+#define UNPOOLED NUM_CLASSES
+
+// more free blocks than this in a class go back to the heap, so a burst of allocations doesn't pin memory forever
+static const int MAX_CACHED_PER_CLASS = 8;
+
+// sits in front of every block, the union keeps the block after it aligned for any type
+union block_header {
+    struct {
+        int size_class;
+        union block_header* next;
+    };
+    max_align_t align;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static union block_header* free_lists[NUM_CLASSES];
+static int free_counts[NUM_CLASSES];
+static struct canvas_pool_stats stats;
+
+static int size_class(size_t size)
+{
+    size_t total = size + sizeof(union block_header);
+    for(int c = 0; c < NUM_CLASSES; c++) {
+        if(total <= ((size_t)1 << (c + MIN_CLASS_SHIFT))) {
+            return c;
+        }
+    }
+    return UNPOOLED;
+}
+
+static size_t class_bytes(int c)
+{
+    return (size_t)1 << (c + MIN_CLASS_SHIFT);
+}
+
+void* canvas_pool_alloc(size_t size)
+{
+    int c = size_class(size);
+
+    pthread_mutex_lock(&lock);
+    if(c != UNPOOLED && free_lists[c] != NULL) {
+        union block_header* header = free_lists[c];
+        free_lists[c] = header->next;
+        free_counts[c]--;
+        stats.cached_blocks--;
+        stats.cached_bytes -= class_bytes(c);
+        stats.reused++;
+        pthread_mutex_unlock(&lock);
+        return header + 1;
+    }
+    stats.heap_allocs++;
+    pthread_mutex_unlock(&lock);
+
+    size_t total = c == UNPOOLED ? size + sizeof(union block_header) : class_bytes(c);
+    union block_header* header = malloc(total);
+    if(header == NULL) {
+        return NULL;
+    }
+    header->size_class = c;
+    return header + 1;
+}
+
+void canvas_pool_free(void* block)
+{
+    if(block == NULL) {
+        return;
+    }
+    union block_header* header = (union block_header*)block - 1;
+    int c = header->size_class;
+
+    pthread_mutex_lock(&lock);
+    if(c != UNPOOLED && free_counts[c] < MAX_CACHED_PER_CLASS) {
+        header->next = free_lists[c];
+        free_lists[c] = header;
+        free_counts[c]++;
+        stats.cached_blocks++;
+        stats.cached_bytes += class_bytes(c);
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+    stats.heap_frees++;
+    pthread_mutex_unlock(&lock);
+    free(header);
+}
+
+void canvas_pool_get_stats(struct canvas_pool_stats* result)
+{
+    pthread_mutex_lock(&lock);
+    *result = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+void canvas_pool_trim(void)
+{
+    pthread_mutex_lock(&lock);
+    for(int c = 0; c < NUM_CLASSES; c++) {
+        while(free_lists[c] != NULL) {
+            union block_header* header = free_lists[c];
+            free_lists[c] = header->next;
+            free(header);
+            stats.heap_frees++;
+        }
+        free_counts[c] = 0;
+    }
+    stats.cached_blocks = 0;
+    stats.cached_bytes = 0;
+    pthread_mutex_unlock(&lock);
+}
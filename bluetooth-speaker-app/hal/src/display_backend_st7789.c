@@ -0,0 +1,81 @@
+// Waveshare 1.54" ST7789 panel over SPI
+#include "hal/display_backend.h"
+#include "hal/time_util.h"
+
+#include "DEV_Config.h"
+#include "LCD_1in54.h"
+#include "GUI_Paint.h"
+
+// the ST7789 needs 120 ms in sleep mode before it can be woken up
+#define SLEEP_IN_TO_OUT_MS 120
+
+static long long sleep_time_us = 0;
+
+static int st7789_init(void)
+{
+    // Module Init
+    if(DEV_ModuleInit() != 0) {
+        DEV_ModuleExit();
+        return 1;
+    }
+
+    // LCD Init
+    DEV_Delay_ms(2000);
+    LCD_1IN54_Init(HORIZONTAL);
+    LCD_1IN54_Clear(WHITE);
+    LCD_SetBacklight(DISPLAY_BACKEND_BACKLIGHT_MAX);
+    // lets frame_pacer line frames up with the panel refresh when the TE pin is wired
+    LCD_1IN54_SetTearingEffect(1);
+    return 0;
+}
+
+static void st7789_cleanup(void)
+{
+    LCD_1IN54_Clear(BLACK);
+    LCD_1IN54_SetBacklight(0);
+    DEV_ModuleExit();
+}
+
+static void st7789_display(const uint16_t* frame)
+{
+    LCD_1IN54_Display((UWORD *)frame);
+}
+
+static void st7789_display_window(int x1, int y1, int x2, int y2, const uint16_t* frame)
+{
+    LCD_1IN54_DisplayWindows(x1, y1, x2, y2, (UWORD *)frame);
+}
+
+static void st7789_frame_done(void)
+{
+}
+
+static void st7789_set_backlight(int level)
+{
+    LCD_SetBacklight(level);
+}
+
+static void st7789_set_sleep(bool sleep)
+{
+    if(sleep) {
+        LCD_1IN54_SetSleep(1);
+        sleep_time_us = time_us();
+    } else {
+        long long asleep_ms = (time_us() - sleep_time_us) / 1000;
+        if(asleep_ms < SLEEP_IN_TO_OUT_MS) {
+            DEV_Delay_ms(SLEEP_IN_TO_OUT_MS - asleep_ms);
+        }
+        LCD_1IN54_SetSleep(0);
+    }
+}
+
+const struct display_backend display_backend_st7789 = {
+    .name = "st7789",
+    .init = st7789_init,
+    .cleanup = st7789_cleanup,
+    .display = st7789_display,
+    .display_window = st7789_display_window,
+    .frame_done = st7789_frame_done,
+    .set_backlight = st7789_set_backlight,
+    .set_sleep = st7789_set_sleep,
+};
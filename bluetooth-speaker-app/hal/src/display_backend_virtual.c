@@ -0,0 +1,160 @@
+// Panel that only exists in memory, for running and benchmarking the render path without hardware
+#define _POSIX_C_SOURCE 200809L
+#include "hal/display_backend.h"
+#include "hal/draw_stuff.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define PANEL_BYTES (LCD_WIDTH * LCD_HEIGHT * sizeof(uint16_t))
+
+static const char* shm_name = NULL;
+static const char* ppm_prefix = NULL;
+
+static uint16_t* pixels = NULL;
+static bool pixels_in_shm = false;
+static long frame_count = 0;
+static int backlight = DISPLAY_BACKEND_BACKLIGHT_MAX;
+static bool asleep = false;
+
+void display_backend_virtual_set_output(const char* shm, const char* ppm)
+{
+    shm_name = shm;
+    ppm_prefix = ppm;
+}
+
+const uint16_t* display_backend_virtual_pixels(void)
+{
+    return pixels;
+}
+
+long display_backend_virtual_frame_count(void)
+{
+    return frame_count;
+}
+
+static uint16_t* map_shm(void)
+{
+    int fd = shm_open(shm_name, O_CREAT | O_RDWR, 0644);
+    if(fd < 0) {
+        perror("display_backend_virtual: shm_open");
+        return NULL;
+    }
+    if(ftruncate(fd, PANEL_BYTES) != 0) {
+        perror("display_backend_virtual: ftruncate");
+        close(fd);
+        return NULL;
+    }
+    void* mem = mmap(NULL, PANEL_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mem == MAP_FAILED) {
+        perror("display_backend_virtual: mmap");
+        return NULL;
+    }
+    return mem;
+}
+
+static int virtual_init(void)
+{
+    pixels_in_shm = false;
+    if(shm_name != NULL) {
+        pixels = map_shm();
+        if(pixels == NULL) {
+            return 1;
+        }
+        pixels_in_shm = true;
+    } else {
+        pixels = malloc(PANEL_BYTES);
+        if(pixels == NULL) {
+            return 2;
+        }
+    }
+    // a cleared panel is white, like the real one after init
+    memset(pixels, 0xFF, PANEL_BYTES);
+    frame_count = 0;
+    backlight = DISPLAY_BACKEND_BACKLIGHT_MAX;
+    asleep = false;
+    return 0;
+}
+
+static void virtual_cleanup(void)
+{
+    if(pixels_in_shm) {
+        munmap(pixels, PANEL_BYTES);
+    } else {
+        free(pixels);
+    }
+    pixels = NULL;
+}
+
+static void virtual_display_window(int x1, int y1, int x2, int y2, const uint16_t* frame)
+{
+    for(int y = y1; y < y2; y++) {
+        memcpy(&pixels[y * LCD_WIDTH + x1], &frame[y * LCD_WIDTH + x1], (x2 - x1) * sizeof(uint16_t));
+    }
+}
+
+static void virtual_display(const uint16_t* frame)
+{
+    memcpy(pixels, frame, PANEL_BYTES);
+}
+
+static void write_ppm(void)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s%05ld.ppm", ppm_prefix, frame_count);
+    FILE* file = fopen(path, "wb");
+    if(file == NULL) {
+        perror("display_backend_virtual: fopen");
+        return;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", LCD_WIDTH, LCD_HEIGHT);
+    uint8_t row[LCD_WIDTH * 3];
+    for(int y = 0; y < LCD_HEIGHT; y++) {
+        for(int x = 0; x < LCD_WIDTH; x++) {
+            // pixels are stored high byte first
+            const uint8_t* p = (const uint8_t*)&pixels[y * LCD_WIDTH + x];
+            uint16_t c = (p[0] << 8) | p[1];
+            // what you'd see: nothing while asleep, scaled by the backlight otherwise
+            int level = asleep ? 0 : backlight;
+            row[x * 3 + 0] = ((c >> 11) << 3) * level / DISPLAY_BACKEND_BACKLIGHT_MAX;
+            row[x * 3 + 1] = (((c >> 5) & 0x3F) << 2) * level / DISPLAY_BACKEND_BACKLIGHT_MAX;
+            row[x * 3 + 2] = ((c & 0x1F) << 3) * level / DISPLAY_BACKEND_BACKLIGHT_MAX;
+        }
+        fwrite(row, sizeof(row), 1, file);
+    }
+    fclose(file);
+}
+
+static void virtual_frame_done(void)
+{
+    if(ppm_prefix != NULL) {
+        write_ppm();
+    }
+    frame_count++;
+}
+
+static void virtual_set_backlight(int level)
+{
+    backlight = level;
+}
+
+static void virtual_set_sleep(bool sleep)
+{
+    asleep = sleep;
+}
+
+const struct display_backend display_backend_virtual = {
+    .name = "virtual",
+    .init = virtual_init,
+    .cleanup = virtual_cleanup,
+    .display = virtual_display,
+    .display_window = virtual_display_window,
+    .frame_done = virtual_frame_done,
+    .set_backlight = virtual_set_backlight,
+    .set_sleep = virtual_set_sleep,
+};
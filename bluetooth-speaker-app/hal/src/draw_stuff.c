@@ -1,5 +1,8 @@
 #include "hal/draw_stuff.h"
 #include "hal/olive.h"
+#include "hal/rgb565.h"
+#include "hal/time_util.h"
+#include "hal/display_backend.h"
 
 #include "DEV_Config.h"
 #include "LCD_1in54.h"
@@ -9,39 +12,350 @@
 #include <stdlib.h>		//exit()
 #include <signal.h>     //signal()
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
+// the screen is diffed in square tiles, changed tiles get merged into at most MAX_DIRTY_RECTS windows
+#define TILE_SIZE 16
+#define TILES_X ((LCD_1IN54_WIDTH + TILE_SIZE - 1) / TILE_SIZE)
+#define TILES_Y ((LCD_1IN54_HEIGHT + TILE_SIZE - 1) / TILE_SIZE)
+#define MAX_DIRTY_RECTS 8
+
+// Frames are converted on the caller's thread and handed to a display thread that does the SPI transfer.
+// At most one frame waits in the queue, a newer frame replaces it. One extra buffer holds the panel contents.
+#define NUM_FRAMES 3
+#define NUM_BUFFERS (NUM_FRAMES + 1)
+
+static UWORD *s_buffers[NUM_BUFFERS];
+static UWORD *s_free[NUM_BUFFERS];
+static int s_num_free = 0;
+
+// frame waiting for the display thread
+static UWORD *s_queued = NULL;
+static long long s_queued_time = 0;
+// true while the display thread is sending a frame, or another thread is sending panel commands
+static bool s_sending = false;
+static bool s_asleep = false;
+
+static const struct display_backend *s_backend = NULL;
+
+// copy of what is currently on the panel, owned by the display thread
+static UWORD *s_panel = NULL;
+
+// tiles of each buffer that may differ from the panel, only these get compared when the buffer is displayed
+static bool s_damage[NUM_BUFFERS][TILES_Y][TILES_X];
+// tiles of each buffer that are older than the last submitted frame, draw_stuff_screen16 copies only these and the
+// damage into a buffer instead of the whole screen
+static bool s_stale[NUM_BUFFERS][TILES_Y][TILES_X];
+
+static struct draw_stuff_stats s_stats;
+static long long s_latency_total_us = 0;
+
+static pthread_t s_display_thread;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+static bool s_stop = false;
 
-static UWORD *s_fb;
 static bool isInitialized = false;
 
 static int max_chars_per_line = -1;
 static int max_num_lines = -1;
 
+static bool tile_changed(const UWORD *frame, const UWORD *panel, int tx, int ty)
+{
+    int x1 = tx * TILE_SIZE;
+    int y1 = ty * TILE_SIZE;
+    int x2 = x1 + TILE_SIZE > LCD_1IN54_WIDTH ? LCD_1IN54_WIDTH : x1 + TILE_SIZE;
+    int y2 = y1 + TILE_SIZE > LCD_1IN54_HEIGHT ? LCD_1IN54_HEIGHT : y1 + TILE_SIZE;
+    size_t row_bytes = (x2 - x1) * sizeof(*frame);
+
+    for(int y = y1; y < y2; y++) {
+        size_t offset = y * LCD_1IN54_WIDTH + x1;
+        if(memcmp(&frame[offset], &panel[offset], row_bytes) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int rect_area(const struct draw_stuff_rect* r)
+{
+    return (r->x2 - r->x1) * (r->y2 - r->y1);
+}
+
+static struct draw_stuff_rect rect_union(const struct draw_stuff_rect* a, const struct draw_stuff_rect* b)
+{
+    struct draw_stuff_rect r = {
+        .x1 = a->x1 < b->x1 ? a->x1 : b->x1,
+        .y1 = a->y1 < b->y1 ? a->y1 : b->y1,
+        .x2 = a->x2 > b->x2 ? a->x2 : b->x2,
+        .y2 = a->y2 > b->y2 ? a->y2 : b->y2,
+    };
+    return r;
+}
+
+static int buffer_index(const UWORD *fb)
+{
+    for(int i = 0; i < NUM_BUFFERS; i++) {
+        if(s_buffers[i] == fb) {
+            return i;
+        }
+    }
+    assert(false);
+    return 0;
+}
+
+// record which tiles of fb changed since the last submitted frame, num_rects < 0 means all of them
+static void set_damage(const UWORD *fb, const struct draw_stuff_rect *rects, int num_rects)
+{
+    bool (*damage)[TILES_X] = s_damage[buffer_index(fb)];
+    memset(damage, num_rects < 0, sizeof(s_damage[0]));
+    for(int i = 0; i < num_rects; i++) {
+        int tx1 = rects[i].x1 < 0 ? 0 : rects[i].x1 / TILE_SIZE;
+        int ty1 = rects[i].y1 < 0 ? 0 : rects[i].y1 / TILE_SIZE;
+        int tx2 = (rects[i].x2 + TILE_SIZE - 1) / TILE_SIZE;
+        int ty2 = (rects[i].y2 + TILE_SIZE - 1) / TILE_SIZE;
+        for(int ty = ty1; ty < ty2 && ty < TILES_Y; ty++) {
+            for(int tx = tx1; tx < tx2 && tx < TILES_X; tx++) {
+                damage[ty][tx] = true;
+            }
+        }
+    }
+}
+
+// Diff frame against panel and write the windows that need to be resent into rects. Returns the number of rects.
+static int find_dirty_rects(const UWORD *frame, const UWORD *panel, struct draw_stuff_rect rects[TILES_X * TILES_Y])
+{
+    bool (*damage)[TILES_X] = s_damage[buffer_index(frame)];
+    bool dirty[TILES_Y][TILES_X];
+    for(int ty = 0; ty < TILES_Y; ty++) {
+        for(int tx = 0; tx < TILES_X; tx++) {
+            dirty[ty][tx] = damage[ty][tx] && tile_changed(frame, panel, tx, ty);
+        }
+    }
+
+    int num_rects = 0;
+    for(int ty = 0; ty < TILES_Y; ty++) {
+        int tx = 0;
+        while(tx < TILES_X) {
+            if(!dirty[ty][tx]) {
+                tx++;
+                continue;
+            }
+
+            // horizontal run of changed tiles
+            int run_start = tx;
+            while(tx < TILES_X && dirty[ty][tx]) {
+                tx++;
+            }
+            struct draw_stuff_rect run = {
+                .x1 = run_start * TILE_SIZE,
+                .y1 = ty * TILE_SIZE,
+                .x2 = tx * TILE_SIZE > LCD_1IN54_WIDTH ? LCD_1IN54_WIDTH : tx * TILE_SIZE,
+                .y2 = (ty + 1) * TILE_SIZE > LCD_1IN54_HEIGHT ? LCD_1IN54_HEIGHT : (ty + 1) * TILE_SIZE,
+            };
+
+            // grow a rect from the row above downward if it covers exactly the same columns
+            bool merged = false;
+            for(int i = 0; i < num_rects; i++) {
+                if(rects[i].x1 == run.x1 && rects[i].x2 == run.x2 && rects[i].y2 == run.y1) {
+                    rects[i].y2 = run.y2;
+                    merged = true;
+                    break;
+                }
+            }
+            if(!merged) {
+                rects[num_rects++] = run;
+            }
+        }
+    }
+
+    // too many windows costs more in setup than it saves, merge the pair that wastes the least area
+    while(num_rects > MAX_DIRTY_RECTS) {
+        int best_a = 0;
+        int best_b = 1;
+        int best_waste = -1;
+        for(int a = 0; a < num_rects; a++) {
+            for(int b = a + 1; b < num_rects; b++) {
+                struct draw_stuff_rect u = rect_union(&rects[a], &rects[b]);
+                int waste = rect_area(&u) - rect_area(&rects[a]) - rect_area(&rects[b]);
+                if(best_waste < 0 || waste < best_waste) {
+                    best_waste = waste;
+                    best_a = a;
+                    best_b = b;
+                }
+            }
+        }
+        rects[best_a] = rect_union(&rects[best_a], &rects[best_b]);
+        rects[best_b] = rects[num_rects - 1];
+        num_rects--;
+    }
+
+    return num_rects;
+}
+
+// Send the parts of frame that differ from what is on the panel. Returns the number of bytes sent.
+static long display_changes(UWORD *frame)
+{
+    if(s_panel == NULL) {
+        s_backend->display(frame);
+        s_backend->frame_done();
+        return LCD_1IN54_WIDTH * LCD_1IN54_HEIGHT * sizeof(*frame);
+    }
+
+    long bytes = 0;
+    struct draw_stuff_rect rects[TILES_X * TILES_Y];
+    int num_rects = find_dirty_rects(frame, s_panel, rects);
+    for(int i = 0; i < num_rects; i++) {
+        s_backend->display_window(rects[i].x1, rects[i].y1, rects[i].x2, rects[i].y2, frame);
+        bytes += rect_area(&rects[i]) * sizeof(*frame);
+    }
+    s_backend->frame_done();
+    return bytes;
+}
+
+static void *run_display(void *arg __attribute__((unused)))
+{
+    pthread_mutex_lock(&s_lock);
+    while(true) {
+        while((s_queued == NULL || s_sending) && !s_stop) {
+            pthread_cond_wait(&s_cond, &s_lock);
+        }
+        if(s_queued == NULL) {
+            break;
+        }
+
+        UWORD *frame = s_queued;
+        long long submit_time = s_queued_time;
+        s_queued = NULL;
+        s_sending = true;
+        pthread_mutex_unlock(&s_lock);
+
+        long long send_start = time_us();
+        long bytes = display_changes(frame);
+
+        long long send_end = time_us();
+        long long latency = send_end - submit_time;
+
+        pthread_mutex_lock(&s_lock);
+        // every tile that was not sent is identical in both buffers, so frame now matches the panel
+        if(s_panel != NULL) {
+            s_free[s_num_free++] = s_panel;
+        }
+        s_panel = frame;
+        s_sending = false;
+
+        s_stats.frames_displayed++;
+        s_stats.last_bytes = bytes;
+        s_stats.bytes_total += bytes;
+        s_stats.last_send_us = send_end - send_start;
+        s_stats.last_latency_us = latency;
+        if(latency > s_stats.max_latency_us) {
+            s_stats.max_latency_us = latency;
+        }
+        s_latency_total_us += latency;
+        s_stats.avg_latency_us = s_latency_total_us / s_stats.frames_displayed;
+
+        pthread_cond_broadcast(&s_cond);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return NULL;
+}
+
+// get a buffer to draw the next frame into, waits if the display thread has all of them. If stale isn't NULL it gets
+// the tiles that are behind the last submitted frame, otherwise the caller has to draw the whole screen.
+static UWORD *take_buffer(bool (*stale)[TILES_X])
+{
+    pthread_mutex_lock(&s_lock);
+    while(s_num_free == 0) {
+        pthread_cond_wait(&s_cond, &s_lock);
+    }
+    UWORD *fb = s_free[--s_num_free];
+    int index = buffer_index(fb);
+    if(stale != NULL) {
+        memcpy(stale, s_stale[index], sizeof(s_stale[0]));
+    }
+    memset(s_stale[index], 0, sizeof(s_stale[0]));
+    pthread_mutex_unlock(&s_lock);
+    return fb;
+}
+
+// queue a buffer from take_buffer for display, dropping the queued frame if the display thread hasn't started it yet
+static void submit_buffer(UWORD *fb)
+{
+    pthread_mutex_lock(&s_lock);
+    // every other buffer now holds an older picture of the damaged tiles
+    int index = buffer_index(fb);
+    for(int i = 0; i < NUM_BUFFERS; i++) {
+        if(i == index) {
+            continue;
+        }
+        for(int ty = 0; ty < TILES_Y; ty++) {
+            for(int tx = 0; tx < TILES_X; tx++) {
+                s_stale[i][ty][tx] = s_stale[i][ty][tx] || s_damage[index][ty][tx];
+            }
+        }
+    }
+    if(s_queued != NULL) {
+        // the panel never got the dropped frame, so its changes still count
+        bool (*damage)[TILES_X] = s_damage[buffer_index(fb)];
+        bool (*dropped)[TILES_X] = s_damage[buffer_index(s_queued)];
+        for(int ty = 0; ty < TILES_Y; ty++) {
+            for(int tx = 0; tx < TILES_X; tx++) {
+                damage[ty][tx] = damage[ty][tx] || dropped[ty][tx];
+            }
+        }
+        s_free[s_num_free++] = s_queued;
+        s_stats.frames_dropped++;
+    }
+    s_queued = fb;
+    s_queued_time = time_us();
+    s_stats.frames_submitted++;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_lock);
+}
+
 void draw_stuff_init()
+{
+    draw_stuff_init_backend(&display_backend_st7789);
+}
+
+void draw_stuff_init_backend(const struct display_backend *backend)
 {
     assert(!isInitialized);
     max_chars_per_line = LCD_WIDTH / Font16.Width;
     max_num_lines = LCD_HEIGHT / Font16.Height;
     // Exception handling:ctrl + c
     // signal(SIGINT, Handler_1IN54_LCD);
-    
-    // Module Init
-	if(DEV_ModuleInit() != 0){
-        DEV_ModuleExit();
+
+    s_backend = backend;
+    if(s_backend->init() != 0) {
+        fprintf(stderr, "draw_stuff: failed to init %s display\n", s_backend->name);
         exit(0);
     }
-	
-    // LCD Init
-    DEV_Delay_ms(2000);
-	LCD_1IN54_Init(HORIZONTAL);
-	LCD_1IN54_Clear(WHITE);
-	LCD_SetBacklight(1023);
-
 
     UDOUBLE Imagesize = LCD_1IN54_HEIGHT*LCD_1IN54_WIDTH*2;
-    if((s_fb = (UWORD *)malloc(Imagesize)) == NULL) {
-        perror("Failed to apply for black memory");
+    s_num_free = 0;
+    for(int i = 0; i < NUM_BUFFERS; i++) {
+        if((s_buffers[i] = (UWORD *)malloc(Imagesize)) == NULL) {
+            perror("Failed to apply for black memory");
+            exit(0);
+        }
+        s_free[s_num_free++] = s_buffers[i];
+    }
+    memset(s_stale, true, sizeof(s_stale));
+    s_queued = NULL;
+    s_sending = false;
+    s_asleep = false;
+    s_panel = NULL;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_latency_total_us = 0;
+
+    s_stop = false;
+    int code = pthread_create(&s_display_thread, NULL, run_display, NULL);
+    if(code) {
+        fprintf(stderr, "draw_stuff: failed to create display thread %d\n", code);
         exit(0);
     }
     isInitialized = true;
@@ -51,14 +365,27 @@ void draw_stuff_cleanup()
     assert(isInitialized);
 
     draw_stuff_update_screen(" ");
+    draw_stuff_flush();
+
+    pthread_mutex_lock(&s_lock);
+    s_stop = true;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_lock);
+    int code = pthread_join(s_display_thread, NULL);
+    if(code) {
+        fprintf(stderr, "draw_stuff: failed to join display thread %d\n", code);
+    }
 
-    LCD_1IN54_Clear(BLACK);
-    LCD_1IN54_SetBacklight(0);
+    s_backend->cleanup();
 
-    // Module Exit
-    free(s_fb);
-    s_fb = NULL;
-	DEV_ModuleExit();
+    for(int i = 0; i < NUM_BUFFERS; i++) {
+        free(s_buffers[i]);
+        s_buffers[i] = NULL;
+    }
+    s_num_free = 0;
+    s_queued = NULL;
+    s_panel = NULL;
+    s_backend = NULL;
     isInitialized = false;
 }
 
@@ -102,7 +429,8 @@ void draw_stuff_update_screen(char* msg)
     buf[buf_i] = '\0';
 
     // Initialize the RAM frame buffer to be blank (white)
-    Paint_NewImage(s_fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, 0, WHITE, 16);
+    UWORD *fb = take_buffer(NULL);
+    Paint_NewImage(fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, 0, WHITE, 16);
     Paint_Clear(WHITE);
 
     // Draw into the RAM frame buffer
@@ -112,58 +440,120 @@ void draw_stuff_update_screen(char* msg)
     free(buf);
 
     // Send the RAM frame buffer to the LCD (actually display it)
-    // Option 1) Full screen refresh (~1 update / second)
-    // LCD_1IN54_Display(s_fb);
-    // Option 2) Update just a small window (~15 updates / second)
-    //           Assume font height <= 20
-    // LCD_1IN54_DisplayWindows(x, y, LCD_1IN54_WIDTH, y+20, s_fb);
-    LCD_1IN54_DisplayWindows(x, y, LCD_1IN54_WIDTH, y + LCD_HEIGHT, s_fb);
+    // The display thread only sends the lines that changed
+    set_damage(fb, NULL, -1);
+    submit_buffer(fb);
 }
 
-uint16_t to_16_bit_colour(int32_t colour)
+void draw_stuff_screen(Olivec_Canvas* img)
 {
-    // rrrr rggg gggb bbbb
-    uint16_t r = (OLIVEC_RED(colour) / 8) << 11;
-    uint16_t g = (OLIVEC_GREEN(colour) / 4) << 5;
-    uint16_t b = OLIVEC_BLUE(colour) / 8;
-    return r | g | b;
+    assert(isInitialized);
+
+    UWORD *fb = take_buffer(NULL);
+    rgb565_convert(fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, *img, RGB565_ROTATE_0, WHITE);
+    set_damage(fb, NULL, -1);
+    submit_buffer(fb);
 }
 
-void draw_stuff_screen(Olivec_Canvas* img)
+void draw_stuff_screen16(const Olivec_Canvas16* img, const struct draw_stuff_rect* damage, int num_damage)
 {
-    Paint_NewImage(s_fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, 0, WHITE, 16);
+    assert(isInitialized);
 
-    Paint_Clear(WHITE);
-    int img_i = 0;
-    for(size_t y_draw = 0; y_draw < img->height; y_draw++) {
-        for(size_t x_draw = 0; x_draw < img->width; x_draw++) {
-            if(x_draw < LCD_1IN54_WIDTH && y_draw < LCD_1IN54_HEIGHT) {
-                Paint_SetPixel(x_draw, y_draw, to_16_bit_colour(img->pixels[y_draw * img->width + x_draw]));
+    bool stale[TILES_Y][TILES_X];
+    UWORD *fb = take_buffer(stale);
+    set_damage(fb, damage, damage == NULL ? -1 : num_damage);
+    bool (*changed)[TILES_X] = s_damage[buffer_index(fb)];
+
+    // the rest of the buffer already matches the previous frame
+    for(int ty = 0; ty < TILES_Y; ty++) {
+        int tx = 0;
+        while(tx < TILES_X) {
+            if(!stale[ty][tx] && !changed[ty][tx]) {
+                tx++;
+                continue;
+            }
+            int run_start = tx;
+            while(tx < TILES_X && (stale[ty][tx] || changed[ty][tx])) {
+                tx++;
             }
-            img_i++;
-        }     
+            size_t x1 = run_start * TILE_SIZE;
+            size_t x2 = tx * TILE_SIZE > LCD_1IN54_WIDTH ? LCD_1IN54_WIDTH : tx * TILE_SIZE;
+            size_t y1 = ty * TILE_SIZE;
+            size_t y2 = y1 + TILE_SIZE > LCD_1IN54_HEIGHT ? LCD_1IN54_HEIGHT : y1 + TILE_SIZE;
+            size_t copy_end = img->width < x2 ? img->width : x2;
+            for(size_t y = y1; y < y2; y++) {
+                UWORD *row = &fb[y * LCD_1IN54_WIDTH];
+                size_t x = x1;
+                if(y < img->height && copy_end > x1) {
+                    memcpy(&row[x1], &OLIVEC_PIXEL16(*img, x1, y), (copy_end - x1) * sizeof(*row));
+                    x = copy_end;
+                }
+                // white is the same in either byte order
+                for(; x < x2; x++) {
+                    row[x] = WHITE;
+                }
+            }
+        }
     }
-        
-    LCD_1IN54_Display(s_fb);
+    submit_buffer(fb);
 }
 
 void draw_stuff_canvas(Olivec_Canvas* screen)
 {
-    // assert(screen->width <= LCD_WIDTH);
-    // assert(screen->height <= LCD_HEIGHT);
+    draw_stuff_screen(screen);
+}
 
-    Paint_NewImage(s_fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, 0, WHITE, 16);
+void draw_stuff_flush(void)
+{
+    assert(isInitialized);
 
-    Paint_Clear(WHITE);
-    int img_i = 0;
-    for(size_t y_draw = 0; y_draw < screen->height; y_draw++) {
-        for(size_t x_draw = 0; x_draw < screen->width; x_draw++) {
-            if(x_draw < LCD_1IN54_WIDTH && y_draw < LCD_1IN54_HEIGHT) {
-                Paint_SetPixel(x_draw, y_draw, to_16_bit_colour(screen->pixels[y_draw * screen->width + x_draw]));
-            }
-            img_i++;
-        }     
+    pthread_mutex_lock(&s_lock);
+    while(s_queued != NULL || s_sending) {
+        pthread_cond_wait(&s_cond, &s_lock);
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void draw_stuff_set_backlight(int level)
+{
+    assert(isInitialized);
+
+    if(level < 0) {
+        level = 0;
+    } else if(level > DISPLAY_BACKEND_BACKLIGHT_MAX) {
+        level = DISPLAY_BACKEND_BACKLIGHT_MAX;
+    }
+    s_backend->set_backlight(level);
+}
+
+void draw_stuff_set_sleep(bool sleep)
+{
+    assert(isInitialized);
+
+    // take the panel from the display thread, it waits while s_sending is set
+    pthread_mutex_lock(&s_lock);
+    while(s_sending) {
+        pthread_cond_wait(&s_cond, &s_lock);
+    }
+    if(s_asleep == sleep) {
+        pthread_mutex_unlock(&s_lock);
+        return;
     }
-        
-    LCD_1IN54_Display(s_fb);
-}
\ No newline at end of file
+    s_sending = true;
+    pthread_mutex_unlock(&s_lock);
+
+    s_backend->set_sleep(sleep);
+
+    pthread_mutex_lock(&s_lock);
+    s_asleep = sleep;
+    s_sending = false;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_lock);
+}
+
+void draw_stuff_get_stats(struct draw_stuff_stats* stats)
+{
+    pthread_mutex_lock(&s_lock);
+    *stats = s_stats;
+    pthread_mutex_unlock(&s_lock);
+}
@@ -0,0 +1,93 @@
+#include "hal/frame_arena.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// allocations that didn't fit, freed on the next reset
+struct overflow_block {
+    struct overflow_block* next;
+    max_align_t data[];
+};
+
+static bool initialized = false;
+static uint8_t* base = NULL;
+static size_t capacity = 0;
+static size_t used = 0;
+static struct overflow_block* overflow = NULL;
+static struct frame_arena_stats stats;
+
+int frame_arena_init(size_t size)
+{
+    assert(!initialized);
+    base = malloc(size);
+    if(base == NULL) {
+        fprintf(stderr, "frame_arena: failed to reserve %zu bytes\n", size);
+        return 1;
+    }
+    capacity = size;
+    used = 0;
+    overflow = NULL;
+    memset(&stats, 0, sizeof(stats));
+    stats.capacity = size;
+    initialized = true;
+    return 0;
+}
+
+static void free_overflow(void)
+{
+    while(overflow != NULL) {
+        struct overflow_block* next = overflow->next;
+        free(overflow);
+        overflow = next;
+    }
+}
+
+void frame_arena_reset(void)
+{
+    assert(initialized);
+    used = 0;
+    free_overflow();
+}
+
+void* frame_arena_alloc(size_t size)
+{
+    assert(initialized);
+    size_t start = (used + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+    if(start + size <= capacity) {
+        used = start + size;
+        if(used > stats.high_water) {
+            stats.high_water = used;
+        }
+        return base + start;
+    }
+
+    // still works, just slower, and the counter says the arena needs to be bigger
+    struct overflow_block* block = malloc(sizeof(*block) + size);
+    if(block == NULL) {
+        return NULL;
+    }
+    block->next = overflow;
+    overflow = block;
+    stats.overflows++;
+    return block->data;
+}
+
+void frame_arena_get_stats(struct frame_arena_stats* result)
+{
+    assert(initialized);
+    *result = stats;
+}
+
+void frame_arena_cleanup(void)
+{
+    assert(initialized);
+    free_overflow();
+    free(base);
+    base = NULL;
+    initialized = false;
+}
@@ -0,0 +1,318 @@
+#define _POSIX_C_SOURCE 200809L
+#include "hal/frame_pacer.h"
+#include "hal/lg_gpio_samples_func.h"
+#include "hal/time_util.h"
+#include "lgpio.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// wake this long before the frame deadline so the TE edge that follows it isn't missed
+static const long long TE_SLACK_US = 4000;
+// after this many waits in a row without a TE edge the pin is assumed dead and only the timer is used
+static const int MAX_TE_TIMEOUTS_IN_A_ROW = 10;
+
+static bool initialized = false;
+static long long period_us = 0;
+static long long last_start_us = 0;
+
+static int te_chip_num = -1;
+static int te_gpio_num = -1;
+static int te_handle = -1;
+static _Atomic bool te_enabled = false;
+static int te_timeouts_in_a_row = 0;
+
+// the next frame_pacer_wait starts a frame after an idle wait instead of keeping the schedule
+static bool resuming = false;
+
+// te_count, wake_requested, wake_count and stats are shared with the lgpio alert thread, frame_pacer_wake and
+// frame_pacer_get_stats
+static pthread_mutex_t lock;
+static pthread_cond_t cond;
+// only frame_pacer_wake signals this one, so TE edges don't wake an idle loop
+static pthread_cond_t idle_cond;
+static long te_count = 0;
+static bool wake_requested = false;
+static long wake_count = 0;
+static struct frame_pacer_stats stats;
+
+static struct timespec to_timespec(long long us)
+{
+    struct timespec spec;
+    spec.tv_sec = us / 1000000;
+    spec.tv_nsec = (us % 1000000) * 1000;
+    return spec;
+}
+
+// returns false if frame_pacer_wake cut the sleep short
+static bool sleep_until_us(long long deadline_us)
+{
+    struct timespec deadline = to_timespec(deadline_us);
+    pthread_mutex_lock(&lock);
+    while(!wake_requested) {
+        if(pthread_cond_timedwait(&cond, &lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    bool woken = wake_requested;
+    wake_requested = false;
+    pthread_mutex_unlock(&lock);
+    return !woken;
+}
+
+static void on_te(int num_events, lgGpioAlert_p events, void *data __attribute__((unused)))
+{
+    for(int i = 0; i < num_events; i++) {
+        struct lgGpioAlert_s* event = events + i;
+        // lgGpioSetSamplesFunc gets everything, only count rising edges of the TE pin
+        if(event->report.chip != te_chip_num || event->report.gpio != te_gpio_num || event->report.level != 1) {
+            continue;
+        }
+        pthread_mutex_lock(&lock);
+        te_count++;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+static int claim_te(int te_chip, int te_gpio)
+{
+    te_handle = lgGpiochipOpen(te_chip);
+    if(te_handle < 0) {
+        fprintf(stderr, "frame_pacer: failed to open TE chip %d %d\n", te_chip, te_handle);
+        te_handle = -1;
+        return 1;
+    }
+
+    te_chip_num = te_chip;
+    te_gpio_num = te_gpio;
+    int code = lg_gpio_samples_func_add(on_te);
+    if(code) {
+        lgGpiochipClose(te_handle);
+        te_handle = -1;
+        return 2;
+    }
+
+    code = lgGpioClaimAlert(te_handle, 0, LG_RISING_EDGE, te_gpio, -1);
+    if(code != 0) {
+        fprintf(stderr, "frame_pacer: failed to claim alert TE %d\n", code);
+        lg_gpio_samples_func_remove(on_te);
+        lgGpiochipClose(te_handle);
+        te_handle = -1;
+        return 3;
+    }
+    return 0;
+}
+
+int frame_pacer_init(int fps, int te_chip, int te_gpio)
+{
+    assert(!initialized);
+    assert(fps > 0);
+
+    int code = pthread_mutex_init(&lock, NULL);
+    if(code) {
+        fprintf(stderr, "frame_pacer: mutex create failed %d\n", code);
+        return 1;
+    }
+    // waits time out against the same clock the deadlines use
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    code = pthread_cond_init(&cond, &attr);
+    if(code == 0) {
+        code = pthread_cond_init(&idle_cond, &attr);
+        if(code) {
+            pthread_cond_destroy(&cond);
+        }
+    }
+    pthread_condattr_destroy(&attr);
+    if(code) {
+        fprintf(stderr, "frame_pacer: cond create failed %d\n", code);
+        pthread_mutex_destroy(&lock);
+        return 2;
+    }
+
+    period_us = 1000000 / fps;
+    last_start_us = 0;
+    te_count = 0;
+    wake_requested = false;
+    wake_count = 0;
+    resuming = false;
+    te_timeouts_in_a_row = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    te_enabled = false;
+    if(te_gpio >= 0) {
+        if(claim_te(te_chip, te_gpio) == 0) {
+            te_enabled = true;
+        } else {
+            fprintf(stderr, "frame_pacer: TE unavailable, pacing with a timer\n");
+        }
+    }
+
+    initialized = true;
+    return 0;
+}
+
+// returns true if a TE edge came before the timeout
+static bool wait_for_te(long long timeout_us)
+{
+    struct timespec deadline = to_timespec(time_us() + timeout_us);
+    bool got_edge = true;
+    pthread_mutex_lock(&lock);
+    long seen = te_count;
+    while(te_count == seen) {
+        if(pthread_cond_timedwait(&cond, &lock, &deadline) == ETIMEDOUT) {
+            got_edge = te_count != seen;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return got_edge;
+}
+
+void frame_pacer_wait(void)
+{
+    assert(initialized);
+    long long now = time_us();
+    if(last_start_us == 0) {
+        last_start_us = now - period_us;
+    }
+    long long deadline = last_start_us + period_us;
+    if(resuming) {
+        // the loop slept until something happened, there is no schedule to keep or fall behind
+        deadline = now;
+        resuming = false;
+    }
+
+    long long overrun_us = now - deadline;
+    if(overrun_us > 0) {
+        // start the next frame straight away, the schedule is re-anchored below so there is no burst of catch up frames
+        pthread_mutex_lock(&lock);
+        stats.overruns++;
+        if(overrun_us > stats.worst_overrun_us) {
+            stats.worst_overrun_us = overrun_us;
+        }
+        pthread_mutex_unlock(&lock);
+    }
+
+    bool synced = false;
+    bool timed_out = false;
+    bool woken = false;
+    if(te_enabled) {
+        if(now < deadline - TE_SLACK_US) {
+            woken = !sleep_until_us(deadline - TE_SLACK_US);
+        }
+        // the panel refreshes faster than we draw, so one edge always comes within a frame period
+        synced = wait_for_te(period_us);
+        timed_out = !synced;
+        if(synced) {
+            te_timeouts_in_a_row = 0;
+        } else if(++te_timeouts_in_a_row >= MAX_TE_TIMEOUTS_IN_A_ROW) {
+            fprintf(stderr, "frame_pacer: no TE edges, pacing with a timer\n");
+            te_enabled = false;
+        }
+    } else if(overrun_us < 0) {
+        woken = !sleep_until_us(deadline);
+    }
+
+    long long start = time_us();
+    // timer frames keep to the fixed schedule unless they fell behind or were woken early, TE frames follow the panel
+    if(!synced && overrun_us <= 0 && !timed_out && !woken) {
+        start = deadline;
+    }
+
+    pthread_mutex_lock(&lock);
+    stats.frames++;
+    if(synced) {
+        stats.te_synced++;
+    }
+    if(timed_out) {
+        stats.te_timeouts++;
+    }
+    stats.last_period_us = start - last_start_us;
+    pthread_mutex_unlock(&lock);
+
+    last_start_us = start;
+}
+
+void frame_pacer_set_fps(int fps)
+{
+    assert(initialized);
+    assert(fps > 0);
+    period_us = 1000000 / fps;
+}
+
+void frame_pacer_wake(void)
+{
+    assert(initialized);
+    pthread_mutex_lock(&lock);
+    wake_requested = true;
+    wake_count++;
+    pthread_cond_broadcast(&cond);
+    pthread_cond_broadcast(&idle_cond);
+    pthread_mutex_unlock(&lock);
+}
+
+long frame_pacer_wake_count(void)
+{
+    assert(initialized);
+    pthread_mutex_lock(&lock);
+    long count = wake_count;
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+bool frame_pacer_idle(long seen, long long deadline_us)
+{
+    assert(initialized);
+    struct timespec deadline = to_timespec(deadline_us);
+    pthread_mutex_lock(&lock);
+    // comparing counts instead of using wake_requested means a wake that came while the last frame was drawn isn't lost
+    while(wake_count == seen) {
+        if(deadline_us < 0) {
+            pthread_cond_wait(&idle_cond, &lock);
+        } else if(pthread_cond_timedwait(&idle_cond, &lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    bool woken = wake_count != seen;
+    wake_requested = false;
+    pthread_mutex_unlock(&lock);
+    resuming = true;
+    return woken;
+}
+
+bool frame_pacer_te_enabled(void)
+{
+    assert(initialized);
+    return te_enabled;
+}
+
+void frame_pacer_get_stats(struct frame_pacer_stats* result)
+{
+    assert(initialized);
+    pthread_mutex_lock(&lock);
+    *result = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+void frame_pacer_cleanup(void)
+{
+    assert(initialized);
+    if(te_handle >= 0) {
+        lg_gpio_samples_func_remove(on_te);
+        lgGpioFree(te_handle, te_gpio_num);
+        lgGpiochipClose(te_handle);
+        te_handle = -1;
+    }
+    te_enabled = false;
+    pthread_cond_destroy(&idle_cond);
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+    initialized = false;
+}
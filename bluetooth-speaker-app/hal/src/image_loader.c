@@ -1,4 +1,5 @@
 #include "hal/image_loader.h"
+#include "hal/canvas_pool.h"
 
 #define OLIVEC_IMPLEMENTATION
 #include "hal/olive.h"
@@ -10,18 +11,52 @@
 #include <stdlib.h>
 #include <string.h>
 
+// the canvas struct and its planes share one block from the pool
 Olivec_Canvas* image_loader_image_create(int x, int y)
 {
-    Olivec_Canvas* new_image = malloc(sizeof(*new_image));
-    uint32_t* pixels = malloc(sizeof(*pixels) * x * y);
-    *new_image = olivec_canvas(pixels, x, y, x);
+    Olivec_Canvas* new_image = canvas_pool_alloc(sizeof(*new_image) + sizeof(uint32_t) * x * y);
+    if(new_image == NULL) {
+        fprintf(stderr, "image_loader: failed to allocate a %dx%d image\n", x, y);
+        return NULL;
+    }
+    *new_image = olivec_canvas((uint32_t*)(new_image + 1), x, y, x);
     return new_image;
 }
 
 void image_loader_image_free(Olivec_Canvas** image)
 {
-    free((*image)->pixels);
-    free(*image);
+    canvas_pool_free(*image);
+    *image = NULL;
+}
+
+Olivec_Canvas16* image_loader_image16_create(int x, int y, bool with_alpha)
+{
+    size_t pixel_bytes = sizeof(uint16_t) * x * y;
+    size_t alpha_bytes = with_alpha ? sizeof(uint8_t) * x * y : 0;
+    Olivec_Canvas16* new_image = canvas_pool_alloc(sizeof(*new_image) + pixel_bytes + alpha_bytes);
+    if(new_image == NULL) {
+        fprintf(stderr, "image_loader: failed to allocate a %dx%d image\n", x, y);
+        return NULL;
+    }
+    uint16_t* pixels = (uint16_t*)(new_image + 1);
+    uint8_t* alpha = with_alpha ? (uint8_t*)pixels + pixel_bytes : NULL;
+    *new_image = olivec16_canvas(pixels, alpha, x, y, x);
+    return new_image;
+}
+
+Olivec_Canvas16* image_loader_image16_from(Olivec_Canvas* image)
+{
+    Olivec_Canvas16* new_image = image_loader_image16_create(image->width, image->height, true);
+    if(new_image == NULL) {
+        return NULL;
+    }
+    olivec16_from_canvas_premul(*new_image, *image);
+    return new_image;
+}
+
+void image_loader_image16_free(Olivec_Canvas16** image)
+{
+    canvas_pool_free(*image);
     *image = NULL;
 }
 
@@ -40,6 +75,10 @@ Olivec_Canvas* image_loader_load(const char* path)
     }
 
     Olivec_Canvas* new_image = image_loader_image_create(x, y);
+    if(new_image == NULL) {
+        free(data);
+        return NULL;
+    }
     if(n_channels == 3) {
         for(int i = 0; i < x * y; i ++) {
             uint8_t r = data[i * 3];
@@ -54,7 +93,8 @@ Olivec_Canvas* image_loader_load(const char* path)
             uint8_t g = data[i * 4 + 1];
             uint8_t b = data[i * 4 + 2];
             uint8_t a = data[i * 4 + 3];
-            new_image->pixels[i] = OLIVEC_RGBA(r, g, b, a);
+            // premultiplied once here so every blend of it skips the per channel multiply by alpha
+            new_image->pixels[i] = olivec_premultiply_color(OLIVEC_RGBA(r, g, b, a));
         }
     }
 
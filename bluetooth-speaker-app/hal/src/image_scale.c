@@ -0,0 +1,120 @@
+#include "hal/image_scale.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// add width bytes of row to the 32 bit sums in acc
+static void accumulate_row_scalar(uint32_t* acc, const uint8_t* row, int width)
+{
+    for(int i = 0; i < width; i++) {
+        acc[i] += row[i];
+    }
+}
+
+static void accumulate_row(uint32_t* acc, const uint8_t* row, int width)
+{
+    int i = 0;
+#if defined(__ARM_NEON)
+    for(; i + 16 <= width; i += 16) {
+        uint8x16_t bytes = vld1q_u8(row + i);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+        vst1q_u32(acc + i, vaddw_u16(vld1q_u32(acc + i), vget_low_u16(lo)));
+        vst1q_u32(acc + i + 4, vaddw_u16(vld1q_u32(acc + i + 4), vget_high_u16(lo)));
+        vst1q_u32(acc + i + 8, vaddw_u16(vld1q_u32(acc + i + 8), vget_low_u16(hi)));
+        vst1q_u32(acc + i + 12, vaddw_u16(vld1q_u32(acc + i + 12), vget_high_u16(hi)));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= width; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        __m128i* a = (__m128i*)(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi, zero)));
+    }
+#endif
+    accumulate_row_scalar(acc + i, row + i, width - i);
+}
+
+bool image_scale_is_vectorized(void)
+{
+#if defined(__ARM_NEON) || defined(__SSE2__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// first source index covered by output index i, every output covers at least one source pixel
+static int span_start(int i, int src, int dst)
+{
+    return (int)((long long)i * src / dst);
+}
+
+static int span_end(int i, int src, int dst)
+{
+    int end = (int)((long long)(i + 1) * src / dst);
+    int start = span_start(i, src, dst);
+    return end > start ? end : start + 1;
+}
+
+static void scale(const uint8_t* rgb, int src_width, int src_height, int stride, Olivec_Canvas16 dst,
+                  void (*accumulate)(uint32_t* acc, const uint8_t* row, int width))
+{
+    int row_bytes = src_width * 3;
+    // column sums of the source rows one output row covers
+    uint32_t* acc = malloc(sizeof(uint32_t) * row_bytes);
+    if(acc == NULL) {
+        return;
+    }
+    for(size_t y = 0; y < dst.height; y++) {
+        int y0 = span_start(y, src_height, dst.height);
+        int y1 = span_end(y, src_height, dst.height);
+        memset(acc, 0, sizeof(uint32_t) * row_bytes);
+        for(int sy = y0; sy < y1; sy++) {
+            accumulate(acc, rgb + (size_t)sy * stride, row_bytes);
+        }
+        for(size_t x = 0; x < dst.width; x++) {
+            int x0 = span_start(x, src_width, dst.width);
+            int x1 = span_end(x, src_width, dst.width);
+            uint32_t r = 0;
+            uint32_t g = 0;
+            uint32_t b = 0;
+            for(int sx = x0; sx < x1; sx++) {
+                r += acc[sx * 3];
+                g += acc[sx * 3 + 1];
+                b += acc[sx * 3 + 2];
+            }
+            uint32_t count = (uint32_t)(x1 - x0) * (y1 - y0);
+            // rounded average
+            r = (r + count / 2) / count;
+            g = (g + count / 2) / count;
+            b = (b + count / 2) / count;
+            OLIVEC_PIXEL16(dst, x, y) = OLIVEC_RGB565(OLIVEC_RGBA(r, g, b, 255));
+        }
+        if(dst.alpha) {
+            memset(&OLIVEC_PIXEL16_ALPHA(dst, 0, y), 255, dst.width);
+        }
+    }
+    free(acc);
+}
+
+void image_scale_rgb_to16(const uint8_t* rgb, int src_width, int src_height, int stride, Olivec_Canvas16 dst)
+{
+    scale(rgb, src_width, src_height, stride, dst, accumulate_row);
+}
+
+void image_scale_rgb_to16_scalar(const uint8_t* rgb, int src_width, int src_height, int stride, Olivec_Canvas16 dst)
+{
+    scale(rgb, src_width, src_height, stride, dst, accumulate_row_scalar);
+}
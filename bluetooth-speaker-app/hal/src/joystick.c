@@ -4,6 +4,7 @@
 #include <byteswap.h>
 
 #include <math.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,6 +27,8 @@ static const uint16_t JOYSTICK_Y_SAMPLE = 0x83C2;
 static const uint16_t JOYSTICK_X_SAMPLE = 0x83D2;
 
 static const long BUTTON_DEBOUNCE = 50;
+// holding the button this long is a long press instead of a press
+static const long LONG_PRESS_TIME = 600;
 
 static const uint16_t JOYSTICK_MIN = 200; //60;
 static const uint16_t JOYSTICK_MAX = 26000; // 26256;
@@ -63,13 +66,40 @@ static void (* _Atomic on_up_listener)() = do_nothing;
 static void (* _Atomic on_down_listener)() = do_nothing;
 static void (* _Atomic on_left_listener)() = do_nothing;
 static void (* _Atomic on_right_listener)() = do_nothing;
+static void (* _Atomic on_long_press_listener)() = do_nothing;
+// when the button went down, -1 while it's up. Set by the gpio alert thread, the sampling thread times long presses
+static _Atomic long button_down_time = -1;
+static long button_up_time = 0;
+// every press fires one listener, the release (press) or the sampling thread (long press) claims it first
+static _Atomic bool press_handled = true;
 
 
 static void on_press(long curr_time, struct button_state_machine* state_machine) 
 {
-     if(curr_time - state_machine->last_press_time > BUTTON_DEBOUNCE) {
+    // contacts bounce right after a press and right after a release
+    if(curr_time - state_machine->last_press_time <= BUTTON_DEBOUNCE || curr_time - button_up_time <= BUTTON_DEBOUNCE) {
+        return;
+    }
+    state_machine->last_press_time = curr_time;
+    press_handled = false;
+    button_down_time = curr_time;
+}
+
+static void on_release(long curr_time, struct button_state_machine* state_machine __attribute__((unused)))
+{
+    long down_time = button_down_time;
+    if(down_time < 0) {
+        return;
+    }
+    button_down_time = -1;
+    // released within the debounce window, the press was a bounce so neither listener fires
+    if(curr_time - down_time <= BUTTON_DEBOUNCE) {
+        press_handled = true;
+        return;
+    }
+    button_up_time = curr_time;
+    if(!atomic_exchange(&press_handled, true)) {
         on_press_listener();
-        state_machine->last_press_time = curr_time;
     }
 }
 
@@ -135,6 +165,10 @@ static void* do_sampling(void* args __attribute__((unused)))
 
         run_state_machine_l(&in_left_motion, &last_left_trigger, stick_y, JOYSTICK_LEFT_TRIGGER, JOYSTICK_LEFT_HYSTERESIS, curr_time, on_left_listener);
 
+        long down_time = button_down_time;
+        if(down_time >= 0 && curr_time - down_time >= LONG_PRESS_TIME && !atomic_exchange(&press_handled, true)) {
+            on_long_press_listener();
+        }
 
         // repeat listeners if held
         if(in_up_motion && curr_time - last_up_trigger > HOLD_REPEAT_TIME) {
@@ -209,6 +243,7 @@ int joystick_init(void)
     // gpio (button)
     // curr_state = &states[0];
     stick_button_state_machine = button_state_machine_init(on_press);
+    button_state_machine_set_on_release(stick_button_state_machine, on_release);
     chip_2_handle = lgGpiochipOpen(CHIP_2);
     if(chip_2_handle < 0) {
         printf("chip 2 failed to open code %d", chip_2_handle);
@@ -278,6 +313,16 @@ void joystick_set_on_right_listener(void (*on_right)())
     }
 }
 
+void joystick_set_on_long_press_listener(void (*on_long_press)())
+{
+    assert(initalized);
+    if(on_long_press == NULL) {
+        on_long_press_listener = do_nothing;
+    } else {
+        on_long_press_listener = on_long_press;
+    }
+}
+
 int joystick_read_x(float* result) 
 {
     assert(initalized);
@@ -392,6 +437,7 @@ void joystick_cleanup(void)
     on_right_listener = do_nothing;
     on_left_listener = do_nothing;
     on_press_listener = do_nothing;
+    on_long_press_listener = do_nothing;
 
     initalized = false;
 }
\ No newline at end of file
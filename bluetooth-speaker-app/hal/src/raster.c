@@ -0,0 +1,265 @@
+#include "hal/raster.h"
+#include "hal/blend.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+// antialiased rows are sampled this many times from top to bottom, across each sample the coverage is exact
+#define SUBSAMPLES 4
+// pixels handed to the blend kernels at a time
+#define CHUNK 64
+
+enum shape_kind {
+    SHAPE_POLYGON,
+    SHAPE_ROUND_RECT,
+};
+
+// fmin and fmax are library calls, their NaN handling isn't needed here
+static inline double min_d(double a, double b)
+{
+    return a < b ? a : b;
+}
+
+static inline double max_d(double a, double b)
+{
+    return a > b ? a : b;
+}
+
+struct shape {
+    enum shape_kind kind;
+    double top;
+    double bottom;
+    // SHAPE_POLYGON
+    int count;
+    double x[RASTER_MAX_POINTS];
+    double y[RASTER_MAX_POINTS];
+    // dx / dy of the edge from point i to the next, 0 for horizontal edges
+    double slope[RASTER_MAX_POINTS];
+    // SHAPE_ROUND_RECT
+    double left;
+    double right;
+    double radius;
+};
+
+// where the horizontal line at y crosses the shape, false if it misses. Exact divides instead of the slopes so integer
+// corners give exact crossings, then the pixels drawn without antialiasing don't depend on rounding
+static bool extent(const struct shape* shape, double y, bool exact, double* left, double* right)
+{
+    if(y < shape->top || y > shape->bottom) {
+        return false;
+    }
+    if(shape->kind == SHAPE_ROUND_RECT) {
+        double d = 0;
+        if(y < shape->top + shape->radius) {
+            d = shape->top + shape->radius - y;
+        } else if(y > shape->bottom - shape->radius) {
+            d = y - (shape->bottom - shape->radius);
+        }
+        double squared = shape->radius * shape->radius - d * d;
+        double inset = shape->radius - sqrt(squared > 0 ? squared : 0);
+        *left = shape->left + inset;
+        *right = shape->right - inset;
+        return true;
+    }
+
+    // a convex polygon is crossed by up to two edges, horizontal edges are covered by the ends of their neighbours
+    bool found = false;
+    for(int i = 0; i < shape->count; i++) {
+        int j = (i + 1) % shape->count;
+        double y0 = shape->y[i];
+        double y1 = shape->y[j];
+        if(y0 == y1 || y < min_d(y0, y1) || y > max_d(y0, y1)) {
+            continue;
+        }
+        double x = exact ? shape->x[i] + (y - y0) * (shape->x[j] - shape->x[i]) / (y1 - y0)
+                         : shape->x[i] + (y - y0) * shape->slope[i];
+        if(!found) {
+            *left = x;
+            *right = x;
+            found = true;
+        } else {
+            *left = min_d(*left, x);
+            *right = max_d(*right, x);
+        }
+    }
+    return found;
+}
+
+// x clamped to the canvas, before converting so huge coordinates don't overflow
+static int clamp_x(double x, size_t width)
+{
+    return (int)max_d(0, min_d(x, (double)width));
+}
+
+// pixels x1 up to x2 of row y are fully inside the shape
+static void fill_span(Olivec_Canvas16 canvas, int y, int x1, int x2, uint32_t colour)
+{
+    if(x1 >= x2) {
+        return;
+    }
+    uint16_t* row = &OLIVEC_PIXEL16(canvas, 0, y);
+    uint8_t* row_alpha = canvas.alpha != NULL ? &OLIVEC_PIXEL16_ALPHA(canvas, 0, y) : NULL;
+    if(OLIVEC_ALPHA(colour) == 255) {
+        uint16_t c = OLIVEC_RGB565(colour);
+        for(int x = x1; x < x2; x++) {
+            row[x] = c;
+        }
+        if(row_alpha != NULL) {
+            memset(row_alpha + x1, 255, x2 - x1);
+        }
+        return;
+    }
+    uint8_t full[CHUNK];
+    memset(full, 255, sizeof(full));
+    for(int x = x1; x < x2; x += CHUNK) {
+        int n = x2 - x < CHUNK ? x2 - x : CHUNK;
+        blend_mask_row16(row + x, row_alpha ? row_alpha + x : NULL, colour, full, n);
+    }
+}
+
+// blend pixels x1 up to x2 of row y by how much of each the spans of the samples that hit the shape cover
+static void blend_edge(Olivec_Canvas16 canvas, int y, int x1, int x2, const double* left, const double* right,
+                       int hits, uint32_t colour)
+{
+    uint16_t* row = &OLIVEC_PIXEL16(canvas, 0, y);
+    uint8_t* row_alpha = canvas.alpha != NULL ? &OLIVEC_PIXEL16_ALPHA(canvas, 0, y) : NULL;
+    uint8_t coverage[CHUNK];
+    for(int x = x1; x < x2; x += CHUNK) {
+        int n = x2 - x < CHUNK ? x2 - x : CHUNK;
+        for(int i = 0; i < n; i++) {
+            double px = x + i;
+            double covered = 0;
+            for(int s = 0; s < hits; s++) {
+                double overlap = min_d(px + 1, right[s]) - max_d(px, left[s]);
+                covered += overlap > 0 ? overlap : 0;
+            }
+            coverage[i] = (uint8_t)(covered * 255 / SUBSAMPLES + 0.5);
+        }
+        blend_mask_row16(row + x, row_alpha ? row_alpha + x : NULL, colour, coverage, n);
+    }
+}
+
+static void fill(Olivec_Canvas16 canvas, const struct shape* shape, uint32_t colour, bool antialias)
+{
+    if(OLIVEC_ALPHA(colour) == 0 || canvas.width == 0 || canvas.height == 0) {
+        return;
+    }
+    int top = (int)max_d(0, floor(shape->top));
+    int bottom = (int)min_d((double)canvas.height, ceil(shape->bottom));
+    for(int y = top; y < bottom; y++) {
+        double l;
+        double r;
+        if(!antialias) {
+            // the pixels whose centres are inside, edges included
+            if(extent(shape, y + 0.5, true, &l, &r)) {
+                fill_span(canvas, y, clamp_x(ceil(l - 0.5), canvas.width), clamp_x(floor(r - 0.5) + 1, canvas.width),
+                          colour);
+            }
+            continue;
+        }
+
+        double left[SUBSAMPLES];
+        double right[SUBSAMPLES];
+        int hits = 0;
+        for(int s = 0; s < SUBSAMPLES; s++) {
+            if(extent(shape, y + (s + 0.5) / SUBSAMPLES, false, &l, &r)) {
+                left[hits] = l;
+                right[hits] = r;
+                hits++;
+            }
+        }
+        if(hits == 0) {
+            continue;
+        }
+        double min_left = left[0];
+        double max_left = left[0];
+        double min_right = right[0];
+        double max_right = right[0];
+        for(int s = 1; s < hits; s++) {
+            min_left = min_d(min_left, left[s]);
+            max_left = max_d(max_left, left[s]);
+            min_right = min_d(min_right, right[s]);
+            max_right = max_d(max_right, right[s]);
+        }
+        // pixels every sample covers completely are filled, only the ones around the edges are blended
+        int outer1 = clamp_x(floor(min_left), canvas.width);
+        int outer2 = clamp_x(ceil(max_right), canvas.width);
+        int inner1 = clamp_x(ceil(max_left), canvas.width);
+        int inner2 = clamp_x(floor(min_right), canvas.width);
+        if(hits < SUBSAMPLES || inner1 >= inner2) {
+            blend_edge(canvas, y, outer1, outer2, left, right, hits, colour);
+        } else {
+            blend_edge(canvas, y, outer1, inner1, left, right, hits, colour);
+            fill_span(canvas, y, inner1, inner2, colour);
+            blend_edge(canvas, y, inner2, outer2, left, right, hits, colour);
+        }
+    }
+}
+
+void raster_polygon(Olivec_Canvas16 canvas, const float* points, int count, uint32_t colour, bool antialias)
+{
+    assert(count <= RASTER_MAX_POINTS);
+    if(count < 3) {
+        return;
+    }
+    struct shape shape = {.kind = SHAPE_POLYGON, .count = count};
+    for(int i = 0; i < count; i++) {
+        shape.x[i] = points[2 * i];
+        shape.y[i] = points[2 * i + 1];
+    }
+    for(int i = 0; i < count; i++) {
+        int j = (i + 1) % count;
+        shape.slope[i] = shape.y[j] != shape.y[i] ? (shape.x[j] - shape.x[i]) / (shape.y[j] - shape.y[i]) : 0;
+    }
+    shape.top = shape.y[0];
+    shape.bottom = shape.y[0];
+    for(int i = 1; i < count; i++) {
+        shape.top = min_d(shape.top, shape.y[i]);
+        shape.bottom = max_d(shape.bottom, shape.y[i]);
+    }
+    fill(canvas, &shape, colour, antialias);
+}
+
+void raster_triangle(Olivec_Canvas16 canvas, float x1, float y1, float x2, float y2, float x3, float y3,
+                     uint32_t colour, bool antialias)
+{
+    float points[] = {x1, y1, x2, y2, x3, y3};
+    raster_polygon(canvas, points, 3, colour, antialias);
+}
+
+void raster_line(Olivec_Canvas16 canvas, float x1, float y1, float x2, float y2, float thickness, uint32_t colour,
+                 bool antialias)
+{
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float length = sqrtf(dx * dx + dy * dy);
+    if(length == 0 || thickness <= 0) {
+        return;
+    }
+    // half the thickness out to each side, at right angles to the line
+    float nx = -dy / length * thickness / 2;
+    float ny = dx / length * thickness / 2;
+    float points[] = {
+        x1 + nx, y1 + ny, x2 + nx, y2 + ny, x2 - nx, y2 - ny, x1 - nx, y1 - ny,
+    };
+    raster_polygon(canvas, points, 4, colour, antialias);
+}
+
+void raster_round_rect(Olivec_Canvas16 canvas, float x, float y, float width, float height, float radius,
+                       uint32_t colour, bool antialias)
+{
+    if(width <= 0 || height <= 0) {
+        return;
+    }
+    float max_radius = (width < height ? width : height) / 2;
+    struct shape shape = {
+        .kind = SHAPE_ROUND_RECT,
+        .top = y,
+        .bottom = y + height,
+        .left = x,
+        .right = x + width,
+        .radius = radius < 0 ? 0 : radius > max_radius ? max_radius : radius,
+    };
+    fill(canvas, &shape, colour, antialias);
+}
@@ -0,0 +1,195 @@
+#include "hal/rgb565.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RGB565_HAVE_X86
+#endif
+
+static void convert_row_scalar(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    for(size_t i = 0; i < count; i++) {
+        dst[i] = rgb565_from_rgba(src[i]);
+    }
+}
+
+#if defined(__ARM_NEON)
+
+// 16 pixels per iteration, vld4 splits the channels so each output byte is a couple of lane ops
+static void convert_row_neon(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    const uint8x16_t mask_f8 = vdupq_n_u8(0xF8);
+    const uint8x16_t mask_1c = vdupq_n_u8(0x1C);
+    for(; i + 16 <= count; i += 16) {
+        uint8x16x4_t px = vld4q_u8((const uint8_t*)(src + i));
+        uint8x16x2_t out;
+        // first byte in memory: rrrrrggg, second: gggbbbbb
+        out.val[0] = vorrq_u8(vandq_u8(px.val[0], mask_f8), vshrq_n_u8(px.val[1], 5));
+        out.val[1] = vorrq_u8(vshlq_n_u8(vandq_u8(px.val[1], mask_1c), 3), vshrq_n_u8(px.val[2], 3));
+        vst2q_u8((uint8_t*)(dst + i), out);
+    }
+    convert_row_scalar(dst + i, src + i, count - i);
+}
+
+#endif
+
+#ifdef RGB565_HAVE_X86
+
+// Same bit shuffle as rgb565_from_rgba, done in 32 bit lanes
+#define RGB565_LANES(vec, AND, OR, SLLI, SRLI, SET1) \
+    OR(OR(AND(vec, SET1(0xF8)), AND(SRLI(vec, 13), SET1(0x07))), \
+       OR(AND(SLLI(vec, 3), SET1(0xE000)), AND(SRLI(vec, 11), SET1(0x1F00))))
+
+__attribute__((target("sse2")))
+static void convert_row_sse2(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 4));
+        a = RGB565_LANES(a, _mm_and_si128, _mm_or_si128, _mm_slli_epi32, _mm_srli_epi32, _mm_set1_epi32);
+        b = RGB565_LANES(b, _mm_and_si128, _mm_or_si128, _mm_slli_epi32, _mm_srli_epi32, _mm_set1_epi32);
+        // sse2 only has a signed 32 -> 16 pack, sign extend the low halves so nothing saturates
+        a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(a, b));
+    }
+    convert_row_scalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void convert_row_avx2(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 8));
+        a = RGB565_LANES(a, _mm256_and_si256, _mm256_or_si256, _mm256_slli_epi32, _mm256_srli_epi32, _mm256_set1_epi32);
+        b = RGB565_LANES(b, _mm256_and_si256, _mm256_or_si256, _mm256_slli_epi32, _mm256_srli_epi32, _mm256_set1_epi32);
+        // packus works per 128 bit half, put the quadwords back in order afterwards
+        __m256i packed = _mm256_packus_epi32(a, b);
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + i), packed);
+    }
+    convert_row_sse2(dst + i, src + i, count - i);
+}
+
+#endif
+
+typedef void (*convert_row_func)(uint16_t*, const uint32_t*, size_t);
+
+static convert_row_func detect_kernel(const char** name)
+{
+#if defined(__ARM_NEON)
+    *name = "neon";
+    return convert_row_neon;
+#elif defined(RGB565_HAVE_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return convert_row_avx2;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        *name = "sse2";
+        return convert_row_sse2;
+    }
+    *name = "scalar";
+    return convert_row_scalar;
+#else
+    *name = "scalar";
+    return convert_row_scalar;
+#endif
+}
+
+// detection always gives the same answer, so racing threads can only store the same values
+static convert_row_func _Atomic kernel = NULL;
+static const char* _Atomic kernel_name = NULL;
+
+static convert_row_func pick_kernel(void)
+{
+    convert_row_func k = kernel;
+    if(k == NULL) {
+        const char* name;
+        k = detect_kernel(&name);
+        kernel_name = name;
+        kernel = k;
+    }
+    return k;
+}
+
+void rgb565_convert_row(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    pick_kernel()(dst, src, count);
+}
+
+const char* rgb565_kernel_name(void)
+{
+    pick_kernel();
+    return kernel_name;
+}
+
+static size_t min_size(size_t a, size_t b)
+{
+    return a < b ? a : b;
+}
+
+void rgb565_convert(uint16_t* dst, int dst_width, int dst_height, Olivec_Canvas src, enum rgb565_rotation rotation, uint16_t fill)
+{
+    convert_row_func convert_row = pick_kernel();
+
+    bool sideways = rotation == RGB565_ROTATE_90 || rotation == RGB565_ROTATE_270;
+    // size of the source area that lands on the screen
+    size_t cols = min_size(src.width, sideways ? (size_t)dst_height : (size_t)dst_width);
+    size_t rows = min_size(src.height, sideways ? (size_t)dst_width : (size_t)dst_height);
+
+    if(cols * rows < (size_t)dst_width * dst_height) {
+        uint16_t fill_swapped = (fill << 8) | (fill >> 8);
+        for(int i = 0; i < dst_width * dst_height; i++) {
+            dst[i] = fill_swapped;
+        }
+    }
+    if(cols == 0 || rows == 0) {
+        return;
+    }
+
+    uint16_t row_buf[cols];
+    for(size_t y = 0; y < rows; y++) {
+        const uint32_t* src_row = &OLIVEC_PIXEL(src, 0, y);
+        switch(rotation) {
+        case RGB565_ROTATE_0:
+            convert_row(&dst[y * dst_width], src_row, cols);
+            break;
+        case RGB565_ROTATE_180: {
+            convert_row(row_buf, src_row, cols);
+            uint16_t* dst_row = &dst[(dst_height - y - 1) * dst_width + dst_width - 1];
+            for(size_t x = 0; x < cols; x++) {
+                *(dst_row - x) = row_buf[x];
+            }
+            break;
+        }
+        case RGB565_ROTATE_90: {
+            // source row y becomes screen column (width - y - 1), top to bottom
+            convert_row(row_buf, src_row, cols);
+            uint16_t* dst_col = &dst[dst_width - y - 1];
+            for(size_t x = 0; x < cols; x++) {
+                dst_col[x * dst_width] = row_buf[x];
+            }
+            break;
+        }
+        case RGB565_ROTATE_270: {
+            // source row y becomes screen column y, bottom to top
+            convert_row(row_buf, src_row, cols);
+            uint16_t* dst_col = &dst[(dst_height - 1) * dst_width + y];
+            for(size_t x = 0; x < cols; x++) {
+                *(dst_col - x * dst_width) = row_buf[x];
+            }
+            break;
+        }
+        }
+    }
+}
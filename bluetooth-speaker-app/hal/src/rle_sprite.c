@@ -0,0 +1,231 @@
+#include "hal/rle_sprite.h"
+#include "hal/blend.h"
+#include "hal/canvas_pool.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// opaque stretches shorter than this stay inside the partial span around them, splitting the span would cost more
+// than the blend kernel's own opaque fast path saves
+#define MIN_OPAQUE_RUN 8
+// transparent gaps shorter than this, like the space between two letters, stay inside the span too. The kernels skip
+// a fully transparent vector of pixels almost for free, a span per letter costs a call each
+#define MIN_GAP 16
+
+// the image being encoded, exactly one of the canvases is set
+struct source {
+    const Olivec_Canvas16* image16;
+    const Olivec_Canvas* image32;
+};
+
+// where encode writes to, or only counts into when spans is NULL
+struct encoder {
+    uint32_t* rows;
+    struct rle_span* spans;
+    uint16_t* pixels;
+    uint8_t* alpha;
+    uint32_t num_spans;
+    uint32_t num_pixels;
+};
+
+static int source_width(const struct source* source)
+{
+    return source->image16 != NULL ? (int)source->image16->width : (int)source->image32->width;
+}
+
+static int source_height(const struct source* source)
+{
+    return source->image16 != NULL ? (int)source->image16->height : (int)source->image32->height;
+}
+
+static uint8_t source_alpha(const struct source* source, int x, int y)
+{
+    if(source->image16 != NULL) {
+        return source->image16->alpha != NULL ? OLIVEC_PIXEL16_ALPHA(*source->image16, x, y) : 255;
+    }
+    return OLIVEC_ALPHA(OLIVEC_PIXEL(*source->image32, x, y));
+}
+
+static uint16_t source_pixel(const struct source* source, int x, int y)
+{
+    if(source->image16 != NULL) {
+        return OLIVEC_PIXEL16(*source->image16, x, y);
+    }
+    return OLIVEC_RGB565(OLIVEC_PIXEL(*source->image32, x, y));
+}
+
+static void emit(const struct source* source, struct encoder* encoder, int y, int x1, int x2, bool opaque)
+{
+    if(encoder->spans != NULL) {
+        struct rle_span* span = &encoder->spans[encoder->num_spans];
+        span->x = x1;
+        span->length = x2 - x1;
+        span->opaque = opaque;
+        span->data = encoder->num_pixels;
+        for(int x = x1; x < x2; x++) {
+            encoder->pixels[encoder->num_pixels + x - x1] = source_pixel(source, x, y);
+            encoder->alpha[encoder->num_pixels + x - x1] = source_alpha(source, x, y);
+        }
+    }
+    encoder->num_spans++;
+    encoder->num_pixels += x2 - x1;
+}
+
+static void encode(const struct source* source, struct encoder* encoder)
+{
+    int width = source_width(source);
+    int height = source_height(source);
+    for(int y = 0; y < height; y++) {
+        if(encoder->rows != NULL) {
+            encoder->rows[y] = encoder->num_spans;
+        }
+        int x = 0;
+        while(x < width) {
+            if(source_alpha(source, x, y) == 0) {
+                x++;
+                continue;
+            }
+            // a run of visible pixels and short gaps, split into partial spans and long enough opaque spans
+            int end = x;
+            for(;;) {
+                while(end < width && source_alpha(source, end, y) != 0) {
+                    end++;
+                }
+                int next = end;
+                while(next < width && next - end < MIN_GAP && source_alpha(source, next, y) == 0) {
+                    next++;
+                }
+                if(next == end || next == width || source_alpha(source, next, y) == 0) {
+                    break;
+                }
+                end = next;
+            }
+            int partial_start = x;
+            while(x < end) {
+                int opaque_end = x;
+                while(opaque_end < end && source_alpha(source, opaque_end, y) == 255) {
+                    opaque_end++;
+                }
+                if(opaque_end - x >= MIN_OPAQUE_RUN) {
+                    if(partial_start < x) {
+                        emit(source, encoder, y, partial_start, x, false);
+                    }
+                    emit(source, encoder, y, x, opaque_end, true);
+                    partial_start = opaque_end;
+                    x = opaque_end;
+                } else {
+                    x = opaque_end > x ? opaque_end : x + 1;
+                }
+            }
+            if(partial_start < end) {
+                emit(source, encoder, y, partial_start, end, false);
+            }
+        }
+    }
+    if(encoder->rows != NULL) {
+        encoder->rows[height] = encoder->num_spans;
+    }
+}
+
+static struct rle_sprite* build(const struct source* source, bool premultiplied)
+{
+    int width = source_width(source);
+    int height = source_height(source);
+    assert(width <= UINT16_MAX);
+
+    struct encoder counts = {0};
+    encode(source, &counts);
+
+    // the struct, rows, spans, pixels and alpha in one block, in order of decreasing alignment
+    size_t rows_bytes = sizeof(uint32_t) * (height + 1);
+    size_t spans_bytes = sizeof(struct rle_span) * counts.num_spans;
+    size_t pixel_bytes = sizeof(uint16_t) * counts.num_pixels;
+    size_t bytes = sizeof(struct rle_sprite) + rows_bytes + spans_bytes + pixel_bytes + counts.num_pixels;
+    struct rle_sprite* sprite = canvas_pool_alloc(bytes);
+    if(sprite == NULL) {
+        fprintf(stderr, "rle_sprite: failed to allocate %zu bytes\n", bytes);
+        return NULL;
+    }
+    uint8_t* block = (uint8_t*)(sprite + 1);
+    struct encoder encoder = {
+        .rows = (uint32_t*)block,
+        .spans = (struct rle_span*)(block + rows_bytes),
+        .pixels = (uint16_t*)(block + rows_bytes + spans_bytes),
+        .alpha = block + rows_bytes + spans_bytes + pixel_bytes,
+    };
+    encode(source, &encoder);
+
+    sprite->width = width;
+    sprite->height = height;
+    sprite->premultiplied = premultiplied;
+    sprite->rows = encoder.rows;
+    sprite->spans = encoder.spans;
+    sprite->pixels = encoder.pixels;
+    sprite->alpha = encoder.alpha;
+    sprite->num_spans = encoder.num_spans;
+    sprite->bytes = bytes;
+    return sprite;
+}
+
+struct rle_sprite* rle_sprite_from16(Olivec_Canvas16 image)
+{
+    struct source source = {.image16 = &image};
+    return build(&source, false);
+}
+
+struct rle_sprite* rle_sprite_from_premul(Olivec_Canvas image)
+{
+    struct source source = {.image32 = &image};
+    return build(&source, true);
+}
+
+void rle_sprite_blit(Olivec_Canvas16 canvas, int x, int y, const struct rle_sprite* sprite)
+{
+    Olivec_Normalized_Rect nr = {0};
+    if(sprite->width == 0 || sprite->height == 0 ||
+       !olivec_normalize_rect(x, y, sprite->width, sprite->height, canvas.width, canvas.height, &nr)) {
+        return;
+    }
+    for(int dy = nr.y1; dy <= nr.y2; dy++) {
+        uint16_t* row = &OLIVEC_PIXEL16(canvas, 0, dy);
+        uint8_t* row_alpha = canvas.alpha != NULL ? &OLIVEC_PIXEL16_ALPHA(canvas, 0, dy) : NULL;
+        uint32_t last = sprite->rows[dy - y + 1];
+        for(uint32_t s = sprite->rows[dy - y]; s < last; s++) {
+            const struct rle_span* span = &sprite->spans[s];
+            int x1 = x + span->x;
+            int x2 = x1 + span->length - 1;
+            if(x1 > nr.x2) {
+                // spans are in order, the rest of the row is clipped too
+                break;
+            }
+            if(x2 < nr.x1) {
+                continue;
+            }
+            // pixels of the span left of the canvas
+            int skip = x1 < nr.x1 ? nr.x1 - x1 : 0;
+            x1 += skip;
+            x2 = x2 > nr.x2 ? nr.x2 : x2;
+            size_t count = x2 - x1 + 1;
+            const uint16_t* pixels = sprite->pixels + span->data + skip;
+            const uint8_t* alpha = sprite->alpha + span->data + skip;
+
+            if(span->opaque) {
+                memcpy(row + x1, pixels, sizeof(uint16_t) * count);
+                if(row_alpha != NULL) {
+                    memset(row_alpha + x1, 255, count);
+                }
+            } else if(sprite->premultiplied) {
+                blend_row16_premul(row + x1, row_alpha ? row_alpha + x1 : NULL, pixels, alpha, count);
+            } else {
+                blend_row16(row + x1, row_alpha ? row_alpha + x1 : NULL, pixels, alpha, count);
+            }
+        }
+    }
+}
+
+void rle_sprite_free(struct rle_sprite** sprite)
+{
+    canvas_pool_free(*sprite);
+    *sprite = NULL;
+}
@@ -12,6 +12,18 @@ long time_ms(void)
     return milliSeconds;
 }
 
+long time_mono_ms(void)
+{
+    return time_us() / 1000;
+}
+
+long long time_us(void)
+{
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (long long)spec.tv_sec * 1000000 + spec.tv_nsec / 1000;
+}
+
 int sleep_ms(long miliseconds)
 {
     struct timespec req;
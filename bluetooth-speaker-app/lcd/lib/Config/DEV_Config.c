@@ -43,10 +43,24 @@ DEV_GPIO_Pin* DEV_GPIOS[4]; // Index 0 unused
 
 #endif
 
+/**
+ * Value is 0 to DEV_BACKLIGHT_MAX, levels in between are software PWM
+**/
 void DEV_SetBacklight(UWORD Value)
 {
 #ifdef USE_DEV_LIB
-    DEV_Digital_Write(LCD_BL, Value);
+    DEV_GPIO_Pin* gpio_pin = DEV_GPIOS[LCD_BL];
+    if (gpio_pin == NULL) {
+        printf("Invalid GPIO Pin: %d\n", LCD_BL);
+        return;
+    }
+    if (Value == 0 || Value >= DEV_BACKLIGHT_MAX) {
+        // fully off or on doesn't need the PWM thread
+        lgTxPwm(gpio_pin->handle, gpio_pin->line, 0, 0, 0, 0);
+        DEV_Digital_Write(LCD_BL, Value ? 1 : 0);
+        return;
+    }
+    lgTxPwm(gpio_pin->handle, gpio_pin->line, DEV_BACKLIGHT_PWM_HZ, Value * 100.0f / DEV_BACKLIGHT_MAX, 0, 0);
 #endif
 }
 
@@ -179,6 +193,30 @@ void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len)
 #endif
 }
 
+/**
+ * Write several buffers back to back with as few SPI syscalls as possible
+**/
+int DEV_SPI_Write_Segments(const DEV_SPI_Segment *pSegs, uint32_t Count)
+{
+#ifdef USE_DEV_LIB 
+    // nothing to send, and a zero length array isn't allowed
+    if (Count == 0) {
+        return 0;
+    }
+    lgSpiSeg_t segs[Count];
+    for(uint32_t i = 0; i < Count; i++) {
+        segs[i].txBuf = (const char *)pSegs[i].pData;
+        segs[i].count = pSegs[i].Len;
+    }
+    int status = lgSpiWriteSegments(SPI_Handle, segs, Count);
+    if (status < 0) {
+        printf("DEV_SPI_Write_Segments failed: %s\n", lguErrorText(status));
+        return status;
+    }
+#endif
+    return 0;
+}
+
 void DEV_ModuleExit(void)
 {
 #ifdef USE_DEV_LIB 
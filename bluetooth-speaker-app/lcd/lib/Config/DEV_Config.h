@@ -59,6 +59,16 @@ Define the pin constants to match those in DEV_Config.c
 
 // Backlight control
 #define LCD_SetBacklight(Value) DEV_SetBacklight(Value)
+#define DEV_BACKLIGHT_MAX 1023
+#define DEV_BACKLIGHT_PWM_HZ 1000
+
+/**
+ * One buffer of a multi-buffer SPI write
+**/
+typedef struct {
+    const uint8_t *pData;
+    uint32_t Len;
+} DEV_SPI_Segment;
 
 /*------------------------------------------------------------------------------------------------------*/
 UBYTE DEV_ModuleInit(void);
@@ -71,6 +81,8 @@ void DEV_Delay_ms(UDOUBLE xms);
 
 void DEV_SPI_WriteByte(UBYTE Value);
 void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len);
+// 0 if every segment was sent, otherwise the lgpio error. Chip select can drop between segments, so set DC first
+int DEV_SPI_Write_Segments(const DEV_SPI_Segment *pSegs, uint32_t Count);
 void DEV_SetBacklight(UWORD Value);
 
 #endif
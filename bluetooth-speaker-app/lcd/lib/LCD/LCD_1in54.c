@@ -12,6 +12,7 @@
 *
 ******************************************************************************/
 #include "LCD_1in54.h"
+#include "LCD_CmdList.h"
 #include "DEV_Config.h"
 
 #include <stdlib.h>		//itoa()
@@ -35,38 +36,27 @@ static void LCD_1IN54_Reset(void)
 }
 
 /******************************************************************************
-function :	send command
-parameter:
-     Reg : Command register
-******************************************************************************/
-static void LCD_1IN54_SendCommand(UBYTE Reg)
-{
-    LCD_1IN54_DC_0;
-    DEV_SPI_WriteByte(Reg);
-}
-
-/******************************************************************************
-function :	send data
-parameter:
-    Data : Write data
+function :	Register values sent by LCD_1IN54_InitReg
+            command, number of data bytes, data bytes
 ******************************************************************************/
-static void LCD_1IN54_SendData_8Bit(UBYTE Data)
-{
-    LCD_1IN54_DC_1;
-    DEV_SPI_WriteByte(Data);
-}
-
-/******************************************************************************
-function :	send data
-parameter:
-    Data : Write data
-******************************************************************************/
-static void LCD_1IN54_SendData_16Bit(UWORD Data)
-{
-    LCD_1IN54_DC_1;
-    DEV_SPI_WriteByte((Data >> 8) & 0xFF);
-    DEV_SPI_WriteByte(Data & 0xFF);
-}
+static const UBYTE LCD_1IN54_InitTable[] = {
+    0x3A, 1, 0x05,
+    0xB2, 5, 0x0C, 0x0C, 0x00, 0x33, 0x33,
+    0xB7, 1, 0x35,  //Gate Control
+    0xBB, 1, 0x19,  //VCOM Setting
+    0xC0, 1, 0x2C,  //LCM Control
+    0xC2, 1, 0x01,  //VDV and VRH Command Enable
+    0xC3, 1, 0x12,  //VRH Set
+    0xC4, 1, 0x20,  //VDV Set
+    0xC6, 1, 0x0F,  //Frame Rate Control in Normal Mode
+    0xD0, 2, 0xA4, 0xA1,  // Power Control 1
+    0xE0, 14, 0xD0, 0x04, 0x0D, 0x11, 0x13, 0x2B, 0x3F,  //Positive Voltage Gamma Control
+              0x54, 0x4C, 0x18, 0x0D, 0x0B, 0x1F, 0x23,
+    0xE1, 14, 0xD0, 0x04, 0x0C, 0x11, 0x13, 0x2C, 0x3F,  //Negative Voltage Gamma Control
+              0x44, 0x51, 0x2F, 0x1F, 0x1F, 0x20, 0x23,
+    0x21, 0,  //Display Inversion On
+    0x11, 0,  //Sleep Out
+};
 
 /******************************************************************************
 function :	Initialize the lcd register
@@ -74,76 +64,15 @@ parameter:
 ******************************************************************************/
 static void LCD_1IN54_InitReg(void)
 {
-    LCD_1IN54_SendCommand(0x3A);
-    LCD_1IN54_SendData_8Bit(0x05);
-
-    LCD_1IN54_SendCommand(0xB2);
-    LCD_1IN54_SendData_8Bit(0x0C);
-    LCD_1IN54_SendData_8Bit(0x0C);
-    LCD_1IN54_SendData_8Bit(0x00);
-    LCD_1IN54_SendData_8Bit(0x33);
-    LCD_1IN54_SendData_8Bit(0x33);
-
-    LCD_1IN54_SendCommand(0xB7);  //Gate Control
-    LCD_1IN54_SendData_8Bit(0x35);
-
-    LCD_1IN54_SendCommand(0xBB);  //VCOM Setting
-    LCD_1IN54_SendData_8Bit(0x19);
-
-    LCD_1IN54_SendCommand(0xC0); //LCM Control     
-    LCD_1IN54_SendData_8Bit(0x2C);
-
-    LCD_1IN54_SendCommand(0xC2);  //VDV and VRH Command Enable
-    LCD_1IN54_SendData_8Bit(0x01);
-    LCD_1IN54_SendCommand(0xC3);  //VRH Set
-    LCD_1IN54_SendData_8Bit(0x12);
-    LCD_1IN54_SendCommand(0xC4);  //VDV Set
-    LCD_1IN54_SendData_8Bit(0x20);
-
-    LCD_1IN54_SendCommand(0xC6);  //Frame Rate Control in Normal Mode
-    LCD_1IN54_SendData_8Bit(0x0F);
-    
-    LCD_1IN54_SendCommand(0xD0);  // Power Control 1
-    LCD_1IN54_SendData_8Bit(0xA4);
-    LCD_1IN54_SendData_8Bit(0xA1);
-
-    LCD_1IN54_SendCommand(0xE0);  //Positive Voltage Gamma Control
-    LCD_1IN54_SendData_8Bit(0xD0);
-    LCD_1IN54_SendData_8Bit(0x04);
-    LCD_1IN54_SendData_8Bit(0x0D);
-    LCD_1IN54_SendData_8Bit(0x11);
-    LCD_1IN54_SendData_8Bit(0x13);
-    LCD_1IN54_SendData_8Bit(0x2B);
-    LCD_1IN54_SendData_8Bit(0x3F);
-    LCD_1IN54_SendData_8Bit(0x54);
-    LCD_1IN54_SendData_8Bit(0x4C);
-    LCD_1IN54_SendData_8Bit(0x18);
-    LCD_1IN54_SendData_8Bit(0x0D);
-    LCD_1IN54_SendData_8Bit(0x0B);
-    LCD_1IN54_SendData_8Bit(0x1F);
-    LCD_1IN54_SendData_8Bit(0x23);
-
-    LCD_1IN54_SendCommand(0xE1);  //Negative Voltage Gamma Control
-    LCD_1IN54_SendData_8Bit(0xD0);
-    LCD_1IN54_SendData_8Bit(0x04);
-    LCD_1IN54_SendData_8Bit(0x0C);
-    LCD_1IN54_SendData_8Bit(0x11);
-    LCD_1IN54_SendData_8Bit(0x13);
-    LCD_1IN54_SendData_8Bit(0x2C);
-    LCD_1IN54_SendData_8Bit(0x3F);
-    LCD_1IN54_SendData_8Bit(0x44);
-    LCD_1IN54_SendData_8Bit(0x51);
-    LCD_1IN54_SendData_8Bit(0x2F);
-    LCD_1IN54_SendData_8Bit(0x1F);
-    LCD_1IN54_SendData_8Bit(0x1F);
-    LCD_1IN54_SendData_8Bit(0x20);
-    LCD_1IN54_SendData_8Bit(0x23);
-
-    LCD_1IN54_SendCommand(0x21);  //Display Inversion On
-
-    LCD_1IN54_SendCommand(0x11);  //Sleep Out
-
-    LCD_1IN54_SendCommand(0x29);  //Display On
+    LCD_CmdList List;
+    LCD_CmdList_Init(&List);
+    LCD_CmdList_Table(&List, LCD_1IN54_InitTable, sizeof(LCD_1IN54_InitTable));
+    LCD_CmdList_Flush(&List);
+
+    // the controller needs 5ms after Sleep Out before the next command
+    DEV_Delay_ms(5);
+    LCD_CmdList_Command(&List, 0x29, NULL, 0);  //Display On
+    LCD_CmdList_Flush(&List);
 }
 
 /********************************************************************************
@@ -169,8 +98,10 @@ static void LCD_1IN54_SetAttributes(UBYTE Scan_dir)
     }
 
     // Set the read / write scan direction of the frame memory
-    LCD_1IN54_SendCommand(0x36); //MX, MY, RGB mode
-    LCD_1IN54_SendData_8Bit(MemoryAccessReg);	//0x08 set RGB
+    LCD_CmdList List;
+    LCD_CmdList_Init(&List);
+    LCD_CmdList_Command_1Byte(&List, 0x36, MemoryAccessReg); //MX, MY, RGB mode
+    LCD_CmdList_Flush(&List);
 }
 
 /********************************************************************************
@@ -202,21 +133,55 @@ parameter:
 ********************************************************************************/
 void LCD_1IN54_SetWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
 {
+    LCD_CmdList List;
+    LCD_CmdList_Init(&List);
     //set the X coordinates
-    LCD_1IN54_SendCommand(0x2A);
-    LCD_1IN54_SendData_8Bit((Xstart >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit(Xstart & 0xFF);
-    LCD_1IN54_SendData_8Bit(((Xend  - 1) >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit((Xend  - 1) & 0xFF);
-
+    LCD_CmdList_Command_2Word(&List, 0x2A, Xstart, Xend - 1);
     //set the Y coordinates
-    LCD_1IN54_SendCommand(0x2B);
-    LCD_1IN54_SendData_8Bit((Ystart >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit(Ystart & 0xFF);
-    LCD_1IN54_SendData_8Bit(((Yend  - 1) >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit((Yend  - 1) & 0xFF);
+    LCD_CmdList_Command_2Word(&List, 0x2B, Ystart, Yend - 1);
+    LCD_CmdList_Command(&List, 0x2C, NULL, 0);
+    LCD_CmdList_Flush(&List);
+}
 
-    LCD_1IN54_SendCommand(0X2C);
+/********************************************************************************
+function:	Turn the tearing effect output on or off
+parameter:
+		On  :   1 pulses the TE pin at the start of every vertical blank, 0 turns it off
+********************************************************************************/
+void LCD_1IN54_SetTearingEffect(UBYTE On)
+{
+    LCD_CmdList List;
+    LCD_CmdList_Init(&List);
+    if(On) {
+        LCD_CmdList_Command_1Byte(&List, 0x35, 0x00); //TEON, V-blank only
+    } else {
+        LCD_CmdList_Command(&List, 0x34, NULL, 0); //TEOFF
+    }
+    LCD_CmdList_Flush(&List);
+}
+
+/********************************************************************************
+function:	Put the panel to sleep or wake it up, frame memory is kept while asleep
+parameter:
+		Sleep  :   1 turns the display off and enters sleep mode, 0 leaves sleep mode
+                   and turns the display back on
+********************************************************************************/
+void LCD_1IN54_SetSleep(UBYTE Sleep)
+{
+    LCD_CmdList List;
+    LCD_CmdList_Init(&List);
+    if(Sleep) {
+        LCD_CmdList_Command(&List, 0x28, NULL, 0); //DISPOFF
+        LCD_CmdList_Command(&List, 0x10, NULL, 0); //SLPIN
+        LCD_CmdList_Flush(&List);
+        DEV_Delay_ms(5);
+    } else {
+        LCD_CmdList_Command(&List, 0x11, NULL, 0); //SLPOUT
+        LCD_CmdList_Flush(&List);
+        DEV_Delay_ms(5);
+        LCD_CmdList_Command(&List, 0x29, NULL, 0); //DISPON
+        LCD_CmdList_Flush(&List);
+    }
 }
 
 /******************************************************************************
@@ -226,19 +191,23 @@ parameter:
 void LCD_1IN54_Clear(UWORD Color)
 {
     UWORD j;
-    UWORD Image[LCD_1IN54_WIDTH*LCD_1IN54_HEIGHT];
+    UWORD Row[LCD_1IN54_WIDTH];
+    DEV_SPI_Segment Segs[LCD_1IN54_HEIGHT];
     
     Color = ((Color<<8)&0xff00)|(Color>>8);
    
-    for (j = 0; j < LCD_1IN54_HEIGHT*LCD_1IN54_WIDTH; j++) {
-        Image[j] = Color;
+    for (j = 0; j < LCD_1IN54_WIDTH; j++) {
+        Row[j] = Color;
+    }
+    // every line of the screen is the same row buffer
+    for (j = 0; j < LCD_1IN54_HEIGHT; j++) {
+        Segs[j].pData = (const uint8_t *)Row;
+        Segs[j].Len = sizeof(Row);
     }
     
     LCD_1IN54_SetWindows(0, 0, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT);
     LCD_1IN54_DC_1;
-    for(j = 0; j < LCD_1IN54_HEIGHT; j++){
-        DEV_SPI_Write_nByte((uint8_t *)&Image[j*LCD_1IN54_WIDTH], LCD_1IN54_WIDTH*2);
-    }
+    DEV_SPI_Write_Segments(Segs, LCD_1IN54_HEIGHT);
 }
 
 /******************************************************************************
@@ -247,32 +216,47 @@ parameter:
 ******************************************************************************/
 void LCD_1IN54_Display(UWORD *Image)
 {
-    UWORD j;
+    DEV_SPI_Segment Seg = {
+        .pData = (const uint8_t *)Image,
+        .Len = LCD_1IN54_WIDTH * LCD_1IN54_HEIGHT * 2,
+    };
     LCD_1IN54_SetWindows(0, 0, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT);
     LCD_1IN54_DC_1;
-    for (j = 0; j < LCD_1IN54_HEIGHT; j++) {
-        DEV_SPI_Write_nByte((uint8_t *)&Image[j*LCD_1IN54_WIDTH], LCD_1IN54_WIDTH*2);
-    }
+    DEV_SPI_Write_Segments(&Seg, 1);
 }
 
 void LCD_1IN54_DisplayWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD *Image)
 {
     // display
     UDOUBLE Addr = 0;
+    DEV_SPI_Segment Segs[LCD_1IN54_HEIGHT];
+    UWORD Count = 0;
 
     UWORD j;
     LCD_1IN54_SetWindows(Xstart, Ystart, Xend , Yend);
     LCD_1IN54_DC_1;
-    for (j = Ystart; j < Yend - 1; j++) {
-        Addr = Xstart + j * LCD_1IN54_WIDTH ;
-        DEV_SPI_Write_nByte((uint8_t *)&Image[Addr], (Xend-Xstart)*2);
+    if (Xstart == 0 && Xend == LCD_1IN54_WIDTH) {
+        // full width rows are contiguous in Image
+        Segs[0].pData = (const uint8_t *)&Image[Ystart * LCD_1IN54_WIDTH];
+        Segs[0].Len = (Yend - Ystart) * LCD_1IN54_WIDTH * 2;
+        Count = 1;
+    } else {
+        for (j = Ystart; j < Yend; j++) {
+            Addr = Xstart + j * LCD_1IN54_WIDTH ;
+            Segs[Count].pData = (const uint8_t *)&Image[Addr];
+            Segs[Count].Len = (Xend-Xstart)*2;
+            Count++;
+        }
     }
+    DEV_SPI_Write_Segments(Segs, Count);
 }
 
 void LCD_1IN54_DisplayPoint(UWORD X, UWORD Y, UWORD Color)
 {
-    LCD_1IN54_SetWindows(X,Y,X,Y);
-    LCD_1IN54_SendData_16Bit(Color);
+    UBYTE Data[2] = { (Color >> 8) & 0xFF, Color & 0xFF };
+    LCD_1IN54_SetWindows(X, Y, X + 1, Y + 1);
+    LCD_1IN54_DC_1;
+    DEV_SPI_Write_nByte(Data, sizeof(Data));
 }
 
 void  Handler_1IN54_LCD(int signo)
@@ -54,9 +54,12 @@ function:
 ********************************************************************************/
 void LCD_1IN54_Init(UBYTE Scan_dir);
 void LCD_1IN54_Clear(UWORD Color);
+void LCD_1IN54_SetWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend);
 void LCD_1IN54_Display(UWORD *Image);
 void LCD_1IN54_DisplayWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD *Image);
 void LCD_1IN54_DisplayPoint(UWORD X, UWORD Y, UWORD Color);
+void LCD_1IN54_SetTearingEffect(UBYTE On);
+void LCD_1IN54_SetSleep(UBYTE Sleep);
 
 void Handler_1IN54_LCD(int signo);
 #endif
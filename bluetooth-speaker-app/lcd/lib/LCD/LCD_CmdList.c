@@ -0,0 +1,136 @@
+/*****************************************************************************
+* | File      	:   LCD_CmdList.c
+* | Function    :   Command stream builder shared by the LCD drivers
+* | Info        :
+*                Records (command, data...) sequences for MIPI DBI style
+*                controllers (ST7789 and friends) and sends them with one
+*                SPI write and one DC change per run of same-DC bytes
+*----------------
+* |	This version:   V1.0
+*
+******************************************************************************/
+#include "LCD_CmdList.h"
+#include "DEV_Config.h"
+
+/******************************************************************************
+function :	Append bytes to the list, joining the last run if DC matches
+parameter:
+******************************************************************************/
+static void LCD_CmdList_Append(LCD_CmdList *List, const UBYTE *Data, UWORD Len, UBYTE Dc)
+{
+    UWORD i;
+    LCD_CmdRun *Last;
+
+    if(Len == 0)
+        return;
+
+    Last = List->NumRuns ? &List->Runs[List->NumRuns - 1] : NULL;
+    if(Last == NULL || Last->Dc != Dc) {
+        List->Runs[List->NumRuns].Start = List->Len;
+        List->Runs[List->NumRuns].Len = 0;
+        List->Runs[List->NumRuns].Dc = Dc;
+        Last = &List->Runs[List->NumRuns];
+        List->NumRuns++;
+    }
+
+    for(i = 0; i < Len; i++) {
+        List->Buf[List->Len++] = Data[i];
+    }
+    Last->Len += Len;
+}
+
+/******************************************************************************
+function :	Start an empty command list
+parameter:
+******************************************************************************/
+void LCD_CmdList_Init(LCD_CmdList *List)
+{
+    List->Len = 0;
+    List->NumRuns = 0;
+}
+
+/******************************************************************************
+function :	Record a command followed by its data bytes
+parameter:
+     Cmd  : Command register
+     Data : Data bytes, may be NULL when Len is 0
+     Len  : Number of data bytes
+******************************************************************************/
+void LCD_CmdList_Command(LCD_CmdList *List, UBYTE Cmd, const UBYTE *Data, UWORD Len)
+{
+    // send what we have if this command would not fit, order is kept
+    if(List->Len + 1 + Len > LCD_CMDLIST_MAX_BYTES || List->NumRuns + 2 > LCD_CMDLIST_MAX_RUNS) {
+        LCD_CmdList_Flush(List);
+    }
+
+    if(1 + Len > LCD_CMDLIST_MAX_BYTES) {
+        // too big to buffer, send it on its own
+        LCD_DC_0;
+        DEV_SPI_WriteByte(Cmd);
+        LCD_DC_1;
+        DEV_SPI_Write_nByte((uint8_t *)Data, Len);
+        return;
+    }
+
+    LCD_CmdList_Append(List, &Cmd, 1, 0);
+    LCD_CmdList_Append(List, Data, Len, 1);
+}
+
+void LCD_CmdList_Command_1Byte(LCD_CmdList *List, UBYTE Cmd, UBYTE Data)
+{
+    LCD_CmdList_Command(List, Cmd, &Data, 1);
+}
+
+/******************************************************************************
+function :	Record a command with two big endian 16 bit parameters,
+            the layout used by CASET, RASET, VSCRDEF style registers
+parameter:
+******************************************************************************/
+void LCD_CmdList_Command_2Word(LCD_CmdList *List, UBYTE Cmd, UWORD Data1, UWORD Data2)
+{
+    UBYTE Data[4] = {
+        (Data1 >> 8) & 0xFF, Data1 & 0xFF,
+        (Data2 >> 8) & 0xFF, Data2 & 0xFF,
+    };
+    LCD_CmdList_Command(List, Cmd, Data, sizeof(Data));
+}
+
+/******************************************************************************
+function :	Record every command of a static init table
+parameter:
+    Table : command, data count, data bytes, repeated
+    Len   : size of Table in bytes
+******************************************************************************/
+void LCD_CmdList_Table(LCD_CmdList *List, const UBYTE *Table, UWORD Len)
+{
+    UWORD i = 0;
+    while(i + 1 < Len) {
+        UBYTE Cmd = Table[i];
+        UBYTE Count = Table[i + 1];
+        if(i + 2 + Count > Len) {
+            DEBUG("LCD_CmdList_Table: truncated table\r\n");
+            break;
+        }
+        LCD_CmdList_Command(List, Cmd, &Table[i + 2], Count);
+        i += 2 + Count;
+    }
+}
+
+/******************************************************************************
+function :	Send the recorded bytes, one DC write and one SPI write per run
+parameter:
+******************************************************************************/
+void LCD_CmdList_Flush(LCD_CmdList *List)
+{
+    UWORD i;
+    for(i = 0; i < List->NumRuns; i++) {
+        LCD_CmdRun *Run = &List->Runs[i];
+        if(Run->Dc) {
+            LCD_DC_1;
+        } else {
+            LCD_DC_0;
+        }
+        DEV_SPI_Write_nByte(&List->Buf[Run->Start], Run->Len);
+    }
+    LCD_CmdList_Init(List);
+}
@@ -0,0 +1,50 @@
+/*****************************************************************************
+* | File      	:   LCD_CmdList.h
+* | Function    :   Command stream builder shared by the LCD drivers
+* | Info        :
+*                Records (command, data...) sequences for MIPI DBI style
+*                controllers (ST7789 and friends) and sends them with one
+*                SPI write and one DC change per run of same-DC bytes
+*----------------
+* |	This version:   V1.0
+*
+******************************************************************************/
+#ifndef __LCD_CMDLIST_H
+#define __LCD_CMDLIST_H
+
+#include "DEV_Config.h"
+#include <stdint.h>
+
+#define LCD_CMDLIST_MAX_BYTES 128
+#define LCD_CMDLIST_MAX_RUNS 48
+
+/**
+ * Init tables are a sequence of: command, number of data bytes, data bytes...
+ * e.g. static const UBYTE Table[] = { 0x3A, 1, 0x05,  0x21, 0 };
+**/
+
+typedef struct {
+    UWORD Start;
+    UWORD Len;
+    UBYTE Dc;
+} LCD_CmdRun;
+
+typedef struct {
+    UBYTE Buf[LCD_CMDLIST_MAX_BYTES];
+    UWORD Len;
+    LCD_CmdRun Runs[LCD_CMDLIST_MAX_RUNS];
+    UWORD NumRuns;
+} LCD_CmdList;
+
+/********************************************************************************
+function:
+			Macro definition variable name
+********************************************************************************/
+void LCD_CmdList_Init(LCD_CmdList *List);
+void LCD_CmdList_Command(LCD_CmdList *List, UBYTE Cmd, const UBYTE *Data, UWORD Len);
+void LCD_CmdList_Command_1Byte(LCD_CmdList *List, UBYTE Cmd, UBYTE Data);
+void LCD_CmdList_Command_2Word(LCD_CmdList *List, UBYTE Cmd, UWORD Data1, UWORD Data2);
+void LCD_CmdList_Table(LCD_CmdList *List, const UBYTE *Table, UWORD Len);
+void LCD_CmdList_Flush(LCD_CmdList *List);
+
+#endif
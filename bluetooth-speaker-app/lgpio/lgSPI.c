@@ -33,6 +33,7 @@ For more information, please refer to <http://unlicense.org/>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdio.h>
 
 #include "lgpio.h"
 
@@ -44,6 +45,7 @@ typedef struct
    int speed;
    int fd;
    uint32_t flags;
+   int bufsiz; /* largest message spidev accepts */
 } lgSpiObj_t, *lgSpiObj_p;
 
 static int xSpiXfer(
@@ -67,6 +69,85 @@ static int xSpiXfer(
       return LG_SPI_XFER_FAILED;
 }
 
+static int xSpiFlush(int fd, struct spi_ioc_transfer *xfer, int numXfers)
+{
+   if (ioctl(fd, SPI_IOC_MESSAGE(numXfers), xfer) >= 0)
+      return LG_OKAY;
+   else
+      return LG_SPI_XFER_FAILED;
+}
+
+static int xSpiWriteSegments(
+   int fd, int speed, int bufsiz, const lgSpiSeg_t *segs, int count)
+{
+   struct spi_ioc_transfer xfer[LG_SPI_MAX_MSG_XFERS];
+   int numXfers = 0;
+   int msgBytes = 0;
+   int total = 0;
+   int i, offset, len;
+
+   memset(xfer, 0, sizeof(xfer));
+
+   for (i=0; i<count; i++)
+   {
+      offset = 0;
+
+      while (offset < segs[i].count)
+      {
+         /* spidev rejects messages over bufsiz, start a new one */
+         if ((numXfers == LG_SPI_MAX_MSG_XFERS) || (msgBytes == bufsiz))
+         {
+            if (xSpiFlush(fd, xfer, numXfers) < 0)
+               return LG_SPI_XFER_FAILED;
+
+            memset(xfer, 0, sizeof(xfer[0]) * numXfers);
+            numXfers = 0;
+            msgBytes = 0;
+         }
+
+         len = segs[i].count - offset;
+         if (len > (bufsiz - msgBytes)) len = bufsiz - msgBytes;
+
+         xfer[numXfers].tx_buf        = (uintptr_t)(segs[i].txBuf + offset);
+         xfer[numXfers].len           = len;
+         xfer[numXfers].speed_hz      = speed;
+         xfer[numXfers].bits_per_word = 8;
+         /* cs_change stays 0, chip select is held to the end of the
+            message and released when it is flushed */
+
+         numXfers++;
+         msgBytes += len;
+         offset += len;
+         total += len;
+      }
+   }
+
+   if (numXfers)
+   {
+      if (xSpiFlush(fd, xfer, numXfers) < 0)
+         return LG_SPI_XFER_FAILED;
+   }
+
+   return total;
+}
+
+static int xSpiBufsiz(void)
+{
+   FILE *f;
+   int bufsiz;
+
+   f = fopen("/sys/module/spidev/parameters/bufsiz", "r");
+
+   if (f == NULL) return LG_SPI_DEFAULT_BUFSIZ;
+
+   if ((fscanf(f, "%d", &bufsiz) != 1) || (bufsiz <= 0))
+      bufsiz = LG_SPI_DEFAULT_BUFSIZ;
+
+   fclose(f);
+
+   return bufsiz;
+}
+
 static void _lgSpiClose(lgSpiObj_p spi)
 {
    if (spi) close(spi->fd);
@@ -125,6 +206,7 @@ int lgSpiOpen(
    spi->fd = fd;
    spi->speed = baud;
    spi->flags = spiFlags;
+   spi->bufsiz = xSpiBufsiz();
 
    return handle;
 }
@@ -216,3 +298,40 @@ int lgSpiXfer(int handle, const char *txBuf, char *rxBuf, int count)
    return status;
 }
 
+
+int lgSpiWriteSegments(int handle, const lgSpiSeg_t *segs, int count)
+{
+   int status;
+   int i;
+   lgSpiObj_p spi;
+
+   LG_DBG(LG_DEBUG_TRACE, "handle=%d count=%d", handle, count);
+
+   if (segs == NULL)
+      PARAM_ERROR(LG_BAD_POINTER, "null segments");
+
+   if (count <= 0)
+      PARAM_ERROR(LG_BAD_SPI_COUNT, "bad count (%d)", count);
+
+   for (i=0; i<count; i++)
+   {
+      /* no upper limit, xSpiWriteSegments splits long segments into
+         transfers of at most bufsiz bytes */
+      if ((segs[i].count <= 0) || (segs[i].txBuf == NULL))
+         PARAM_ERROR(LG_BAD_SPI_COUNT, "bad segment %d count (%d)",
+            i, segs[i].count);
+   }
+
+   status = lgHdlGetLockedObj(handle, LG_HDL_TYPE_SPI, (void **)&spi);
+
+   if (status == LG_OKAY)
+   {
+      status = xSpiWriteSegments(
+         spi->fd, spi->speed, spi->bufsiz, segs, count);
+
+      lgHdlUnlock(handle);
+   }
+
+   return status;
+}
+
@@ -176,6 +176,8 @@ lgSpiWrite                   Writes bytes to a SPI device
 
 lgSpiXfer                    Transfers bytes with a SPI device
 
+lgSpiWriteSegments           Writes several buffers in one SPI message
+
 THREADS
 
 lgThreadStart                Start a new thread
@@ -337,6 +339,14 @@ extern "C" {
 
 #define LG_MAX_SPI_DEVICE_COUNT (1<<16)
 
+/* max spi_ioc_transfer per SPI message */
+
+#define LG_SPI_MAX_MSG_XFERS 64
+
+/* spidev's default bufsiz, used if the module parameter can't be read */
+
+#define LG_SPI_DEFAULT_BUFSIZ 4096
+
 /* I2C constants
 */
 
@@ -414,6 +424,12 @@ typedef struct
    uint8_t  *buf;  /* pointer to msg data */
 } lgI2cMsg_t;
 
+typedef struct
+{
+   const char *txBuf; /* data to write */
+   int count;         /* number of bytes to write */
+} lgSpiSeg_t;
+
 
 
 typedef void (*lgGpioAlertsFunc_t)  (int           num_alerts,
@@ -2310,6 +2326,32 @@ If OK returns the count of bytes transferred and updates rxBuf.
 On failure returns a negative error code.
 D*/
 
+/*F*/
+int lgSpiWriteSegments(int handle, const lgSpiSeg_t *segs, int count);
+/*D
+This function writes count buffers to the SPI device.  The buffers
+are packed into as few SPI_IOC_MESSAGE ioctls as possible.  A
+message holds at most [*LG_SPI_MAX_MSG_XFERS*] transfers and at
+most the spidev bufsiz module parameter bytes, larger buffers are
+split.
+
+Chip select is held only within one message (cs_change is left 0).
+It is released between messages, so a long write may see chip
+select drop at any buffer boundary.  Devices that latch state on
+chip select, such as a command/data line, must have it set before
+the call and not rely on one continuous transaction.
+
+. .
+handle: >= 0 (as returned by [*lgSpiOpen*])
+  segs: an array of SPI segments
+ count: >0, the number of SPI segments
+. .
+
+If OK returns the total count of bytes written.
+
+On failure returns a negative error code.
+D*/
+
 
 /* Threads API
 */
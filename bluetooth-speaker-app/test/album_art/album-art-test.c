@@ -0,0 +1,225 @@
+// Feeds local JPEG/PNG files through the album art pipeline the way track changes would. Checks that album_art_get
+// never blocks on a decode, that the ready listener fires, that repeated requests are deduplicated and served from the
+// cache, and that the vector scaler matches the plain C one. Returns 1 if any check fails.
+//
+// usage: album-art-test [--size pixels] [--ppm prefix] image...
+#include "ui/album_art.h"
+#include "hal/image_loader.h"
+#include "hal/image_scale.h"
+#include "hal/time_util.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// anything slower than this for album_art_get means it waited on the worker
+static const long long MAX_GET_US = 2000;
+static const long READY_TIMEOUT_MS = 10000;
+
+static pthread_mutex_t ready_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ready_cond = PTHREAD_COND_INITIALIZER;
+static int ready_count = 0;
+static int failures = 0;
+
+static void on_ready(void)
+{
+    pthread_mutex_lock(&ready_lock);
+    ready_count++;
+    pthread_cond_broadcast(&ready_cond);
+    pthread_mutex_unlock(&ready_lock);
+}
+
+static void check(bool ok, const char* what)
+{
+    if(!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// get key, timing how long the call takes
+static struct album_art* timed_get(const char* key)
+{
+    long long start = time_us();
+    struct album_art* art = album_art_get(key);
+    long long elapsed = time_us() - start;
+    if(elapsed > MAX_GET_US) {
+        printf("FAIL: album_art_get(%s) took %lld us\n", key, elapsed);
+        failures++;
+    }
+    return art;
+}
+
+static void write_ppm(const char* path, const Olivec_Canvas16* image)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == NULL) {
+        perror(path);
+        return;
+    }
+    fprintf(file, "P6\n%zu %zu\n255\n", image->width, image->height);
+    for(size_t y = 0; y < image->height; y++) {
+        for(size_t x = 0; x < image->width; x++) {
+            uint16_t c = OLIVEC_PIXEL16(*image, x, y);
+            uint8_t rgb[3] = {((c >> 11) & 0x1F) * 255 / 31, ((c >> 5) & 0x3F) * 255 / 63, (c & 0x1F) * 255 / 31};
+            fwrite(rgb, 1, sizeof(rgb), file);
+        }
+    }
+    fclose(file);
+}
+
+// scale a gradient with both scalers and compare, covers downscaling, upscaling and odd widths
+static void check_scalers(void)
+{
+    static const int SIZES[][4] = {{37, 53, 16, 16}, {640, 480, 120, 120}, {5, 7, 24, 24}, {300, 300, 300, 300}};
+    for(size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+        int w = SIZES[i][0];
+        int h = SIZES[i][1];
+        uint8_t* rgb = malloc((size_t)w * h * 3);
+        for(int y = 0; y < h; y++) {
+            for(int x = 0; x < w; x++) {
+                uint8_t* p = rgb + ((size_t)y * w + x) * 3;
+                p[0] = x * 255 / w;
+                p[1] = y * 255 / h;
+                p[2] = (x * y) & 0xFF;
+            }
+        }
+        Olivec_Canvas16* fast = image_loader_image16_create(SIZES[i][2], SIZES[i][3], false);
+        Olivec_Canvas16* slow = image_loader_image16_create(SIZES[i][2], SIZES[i][3], false);
+        image_scale_rgb_to16(rgb, w, h, w * 3, *fast);
+        image_scale_rgb_to16_scalar(rgb, w, h, w * 3, *slow);
+        bool same = memcmp(fast->pixels, slow->pixels, sizeof(uint16_t) * fast->width * fast->height) == 0;
+        if(!same) {
+            printf("FAIL: scalers differ for %dx%d -> %dx%d\n", w, h, SIZES[i][2], SIZES[i][3]);
+            failures++;
+        }
+        image_loader_image16_free(&fast);
+        image_loader_image16_free(&slow);
+        free(rgb);
+    }
+}
+
+// wait until at least count art has been decoded
+static bool wait_ready(int count)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += READY_TIMEOUT_MS / 1000;
+    pthread_mutex_lock(&ready_lock);
+    while(ready_count < count) {
+        if(pthread_cond_timedwait(&ready_cond, &ready_lock, &deadline) != 0) {
+            break;
+        }
+    }
+    bool ok = ready_count >= count;
+    pthread_mutex_unlock(&ready_lock);
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    int size = 120;
+    const char* ppm_prefix = NULL;
+    int first_file = 1;
+    while(first_file < argc && strncmp(argv[first_file], "--", 2) == 0) {
+        if(strcmp(argv[first_file], "--size") == 0 && first_file + 1 < argc) {
+            size = atoi(argv[first_file + 1]);
+        } else if(strcmp(argv[first_file], "--ppm") == 0 && first_file + 1 < argc) {
+            ppm_prefix = argv[first_file + 1];
+        } else {
+            break;
+        }
+        first_file += 2;
+    }
+    int num_files = argc - first_file;
+    if(num_files < 1 || size <= 0) {
+        fprintf(stderr, "usage: %s [--size pixels] [--ppm prefix] image...\n", argv[0]);
+        return 2;
+    }
+
+    printf("scaler: %s\n", image_scale_is_vectorized() ? "vectorized" : "scalar only");
+    check_scalers();
+
+    // one entry per file so nothing is evicted before it's checked
+    if(album_art_init(size, num_files) != 0) {
+        return 1;
+    }
+    album_art_set_ready_listener(on_ready);
+
+    // request every file at once like a fast skip through a playlist, the middle ones come from memory
+    for(int i = 0; i < num_files; i++) {
+        const char* path = argv[first_file + i];
+        if(i % 2 == 1) {
+            FILE* file = fopen(path, "rb");
+            if(file == NULL) {
+                perror(path);
+                failures++;
+                continue;
+            }
+            fseek(file, 0, SEEK_END);
+            long length = ftell(file);
+            fseek(file, 0, SEEK_SET);
+            void* data = malloc(length);
+            if(fread(data, 1, length, file) == (size_t)length) {
+                album_art_request_memory(path, data, length);
+            }
+            free(data);
+            fclose(file);
+        } else {
+            album_art_request_file(path, path);
+        }
+        // asking for it again while it's pending must not queue a second decode
+        album_art_request_file(path, path);
+        struct album_art* art = timed_get(path);
+        if(art != NULL) {
+            album_art_release(art);
+        }
+    }
+
+    struct album_art_stats stats;
+    if(!wait_ready(num_files < 4 ? num_files : 4)) {
+        printf("FAIL: art wasn't ready within %ld ms\n", READY_TIMEOUT_MS);
+        failures++;
+    }
+    // give any stragglers a moment, then make sure nothing was decoded twice
+    sleep_ms(100);
+    album_art_get_stats(&stats);
+    check(stats.decoded + stats.failed + stats.dropped == num_files, "every request was decoded once or dropped");
+
+    for(int i = 0; i < num_files; i++) {
+        const char* path = argv[first_file + i];
+        struct album_art* art = timed_get(path);
+        if(art == NULL) {
+            printf("%-40s not decoded (dropped from the queue)\n", path);
+            continue;
+        }
+        if(art->image == NULL) {
+            printf("%-40s failed to decode\n", path);
+        } else {
+            printf("%-40s %zux%zu\n", path, art->image->width, art->image->height);
+            check(art->image->width == (size_t)size && art->image->height == (size_t)size, "art is the requested size");
+            if(ppm_prefix != NULL) {
+                char ppm_path[512];
+                snprintf(ppm_path, sizeof(ppm_path), "%s%d.ppm", ppm_prefix, i);
+                write_ppm(ppm_path, art->image);
+            }
+        }
+        // a second get is a hit on the same art
+        struct album_art* again = album_art_get(path);
+        check(again == art, "cached art is shared");
+        album_art_release(again);
+        album_art_release(art);
+    }
+
+    album_art_get_stats(&stats);
+    printf("decoded %ld, failed %ld, dropped %ld, hits %ld, misses %ld, evictions %ld, last decode %ld us\n",
+           stats.decoded, stats.failed, stats.dropped, stats.hits, stats.misses, stats.evictions,
+           stats.last_decode_us);
+    album_art_cleanup();
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+// Checks every blend kernel this cpu can run against the scalar reference on random rows of every length up to 70,
+// then times each one blending a full screen of pixels with different alpha mixes, straight and premultiplied. Also
+// reports how far the premultiplied blends drift from the straight ones. Returns 1 if any kernel's output differs from
+// the reference.
+//
+// usage: blend-bench [full screens per test]
+#include "hal/blend.h"
+#include "hal/olive.h"
+#include "hal/time_util.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 240
+#define HEIGHT 240
+#define PIXELS (WIDTH * HEIGHT)
+#define MAX_CHECK_LENGTH 70
+
+// how the source alpha is spread, text is mostly fully transparent or opaque with anti-aliased edges
+enum mix {
+    MIX_TEXT,
+    MIX_OPAQUE,
+    MIX_TRANSPARENT,
+    MIX_TRANSLUCENT,
+    NUM_MIXES,
+};
+
+static const char* MIX_NAMES[NUM_MIXES] = {"text", "opaque", "transparent", "translucent"};
+
+static uint32_t rng_state = 12345;
+
+static uint32_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint8_t random_alpha(enum mix mix)
+{
+    switch(mix) {
+    case MIX_TEXT: {
+        // runs of 8 so the fast paths see the spans they would in a text strip
+        static int run = 0;
+        static uint8_t value = 0;
+        if(run-- <= 0) {
+            run = 8;
+            uint32_t r = next_random() % 100;
+            value = r < 60 ? 0 : r < 85 ? 255 : 1 + next_random() % 254;
+        }
+        return value == 0 || value == 255 ? value : 1 + next_random() % 254;
+    }
+    case MIX_OPAQUE:
+        return 255;
+    case MIX_TRANSPARENT:
+        return 0;
+    default:
+        return next_random() % 256;
+    }
+}
+
+// the premultiplied sources are the same colours run through olivec_premultiply_color, and for 16 bits converted the
+// way blend_row32_premul_to16 converts them, so they stay valid (no channel above alpha)
+struct rows {
+    uint32_t* src32;
+    uint16_t* src16;
+    uint8_t* src_alpha;
+    uint32_t* src32_premul;
+    uint16_t* src16_premul;
+    uint32_t* dst32;
+    uint16_t* dst16;
+    uint8_t* dst_alpha;
+};
+
+static void fill(const struct rows* rows, size_t count, enum mix mix)
+{
+    for(size_t i = 0; i < count; i++) {
+        uint8_t a = random_alpha(mix);
+        rows->src32[i] = (next_random() & 0x00FFFFFF) | (uint32_t)a << 24;
+        rows->src16[i] = next_random();
+        rows->src_alpha[i] = a;
+        rows->src32_premul[i] = olivec_premultiply_color(rows->src32[i]);
+        rows->src16_premul[i] = OLIVEC_RGB565(rows->src32_premul[i]);
+        rows->dst32[i] = next_random();
+        rows->dst16[i] = next_random();
+        rows->dst_alpha[i] = next_random();
+    }
+}
+
+static bool check_row32(void (*reference)(uint32_t*, const uint32_t*, size_t),
+                        void (*kernel)(uint32_t*, const uint32_t*, size_t), const uint32_t* dst, const uint32_t* src,
+                        size_t length)
+{
+    uint32_t ref[MAX_CHECK_LENGTH], out[MAX_CHECK_LENGTH];
+    memcpy(ref, dst, sizeof(uint32_t) * length);
+    memcpy(out, dst, sizeof(uint32_t) * length);
+    reference(ref, src, length);
+    kernel(out, src, length);
+    return memcmp(ref, out, sizeof(uint32_t) * length) == 0;
+}
+
+// with_alpha false leaves the destination alpha plane out
+static bool check_row16(void (*reference)(uint16_t*, uint8_t*, const uint16_t*, const uint8_t*, size_t),
+                        void (*kernel)(uint16_t*, uint8_t*, const uint16_t*, const uint8_t*, size_t),
+                        const uint16_t* dst, const uint8_t* dst_alpha, const uint16_t* src, const uint8_t* src_alpha,
+                        size_t length, bool with_alpha)
+{
+    uint16_t ref[MAX_CHECK_LENGTH], out[MAX_CHECK_LENGTH];
+    uint8_t ref_alpha[MAX_CHECK_LENGTH], out_alpha[MAX_CHECK_LENGTH];
+    memcpy(ref, dst, sizeof(uint16_t) * length);
+    memcpy(out, dst, sizeof(uint16_t) * length);
+    memcpy(ref_alpha, dst_alpha, length);
+    memcpy(out_alpha, dst_alpha, length);
+    reference(ref, with_alpha ? ref_alpha : NULL, src, src_alpha, length);
+    kernel(out, with_alpha ? out_alpha : NULL, src, src_alpha, length);
+    return memcmp(ref, out, sizeof(uint16_t) * length) == 0 && memcmp(ref_alpha, out_alpha, length) == 0;
+}
+
+// run every kernel on copies of the same random rows and compare with the reference, which is last
+static int check_kernels(const struct blend_kernels* kernels, int num_kernels)
+{
+    const struct blend_kernels* reference = &kernels[num_kernels - 1];
+    int failures = 0;
+    uint32_t src32[MAX_CHECK_LENGTH], src32_premul[MAX_CHECK_LENGTH], dst32[MAX_CHECK_LENGTH];
+    uint16_t src16[MAX_CHECK_LENGTH], src16_premul[MAX_CHECK_LENGTH], dst16[MAX_CHECK_LENGTH];
+    uint8_t src_alpha[MAX_CHECK_LENGTH], dst_alpha[MAX_CHECK_LENGTH];
+    struct rows rows = {src32, src16, src_alpha, src32_premul, src16_premul, dst32, dst16, dst_alpha};
+
+    for(int k = 0; k < num_kernels - 1; k++) {
+        const struct blend_kernels* kernel = &kernels[k];
+        for(int mix = 0; mix < NUM_MIXES; mix++) {
+            for(size_t length = 0; length <= MAX_CHECK_LENGTH; length++) {
+                fill(&rows, length, mix);
+                struct {
+                    const char* what;
+                    bool same;
+                } checks[] = {
+                    {"row32", check_row32(reference->row32, kernel->row32, dst32, src32, length)},
+                    {"row16", check_row16(reference->row16, kernel->row16, dst16, dst_alpha, src16, src_alpha, length,
+                                          true)},
+                    {"row16 without alpha", check_row16(reference->row16, kernel->row16, dst16, dst_alpha, src16,
+                                                        src_alpha, length, false)},
+                    {"row32_premul",
+                     check_row32(reference->row32_premul, kernel->row32_premul, dst32, src32_premul, length)},
+                    {"row16_premul", check_row16(reference->row16_premul, kernel->row16_premul, dst16, dst_alpha,
+                                                 src16_premul, src_alpha, length, true)},
+                    {"row16_premul without alpha",
+                     check_row16(reference->row16_premul, kernel->row16_premul, dst16, dst_alpha, src16_premul,
+                                 src_alpha, length, false)},
+                };
+                for(size_t c = 0; c < sizeof(checks) / sizeof(checks[0]); c++) {
+                    if(!checks[c].same) {
+                        printf("FAIL: %s %s differs, %s pixels, length %zu\n", kernel->name, checks[c].what,
+                               MIX_NAMES[mix], length);
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+static int channel_difference(uint32_t a, uint32_t b)
+{
+    int most = 0;
+    for(int shift = 0; shift < 32; shift += 8) {
+        int d = abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF));
+        most = d > most ? d : most;
+    }
+    return most;
+}
+
+// blend the same colours straight and premultiplied and compare the unpremultiplied result, which should only be off
+// by rounding. Only the 32 bit path is compared, 16 bit colours are too coarse for the difference to mean anything
+static int premul_drift(void)
+{
+    int most = 0;
+    for(int i = 0; i < 100000; i++) {
+        uint32_t src = next_random();
+        // an opaque destination, like the canvases the UI draws into
+        uint32_t dst = next_random() | 0xFF000000;
+        uint32_t straight = dst;
+        uint32_t premul = dst;
+        olivec_blend_color(&straight, src);
+        olivec_blend_color_premul(&premul, olivec_premultiply_color(src));
+        int d = channel_difference(straight, premul);
+        most = d > most ? d : most;
+    }
+    return most;
+}
+
+static void time_kernels(const char* title, const struct blend_kernels* kernels, int num_kernels,
+                         const struct rows* rows, int screens, bool premul)
+{
+    printf("\n%-12s %-8s %12s %12s %9s\n", title, "kernel", "row32 ns/px", "row16 ns/px", "speedup");
+    for(int mix = 0; mix < NUM_MIXES; mix++) {
+        fill(rows, PIXELS, mix);
+        const uint32_t* src32 = premul ? rows->src32_premul : rows->src32;
+        const uint16_t* src16 = premul ? rows->src16_premul : rows->src16;
+        double reference_ns = 0;
+        // reference first so the speedups can be worked out as the others finish
+        for(int k = num_kernels - 1; k >= 0; k--) {
+            void (*row32)(uint32_t*, const uint32_t*, size_t) = premul ? kernels[k].row32_premul : kernels[k].row32;
+            void (*row16)(uint16_t*, uint8_t*, const uint16_t*, const uint8_t*, size_t) =
+                premul ? kernels[k].row16_premul : kernels[k].row16;
+            long long start = time_us();
+            for(int s = 0; s < screens; s++) {
+                for(int y = 0; y < HEIGHT; y++) {
+                    row32(rows->dst32 + y * WIDTH, src32 + y * WIDTH, WIDTH);
+                }
+            }
+            long long mid = time_us();
+            for(int s = 0; s < screens; s++) {
+                for(int y = 0; y < HEIGHT; y++) {
+                    row16(rows->dst16 + y * WIDTH, rows->dst_alpha + y * WIDTH, src16 + y * WIDTH,
+                          rows->src_alpha + y * WIDTH, WIDTH);
+                }
+            }
+            long long end = time_us();
+            double pixels = (double)screens * PIXELS;
+            double ns32 = (mid - start) * 1000.0 / pixels;
+            double ns16 = (end - mid) * 1000.0 / pixels;
+            if(k == num_kernels - 1) {
+                reference_ns = ns32 + ns16;
+            }
+            printf("%-12s %-8s %12.3f %12.3f %8.2fx\n", MIX_NAMES[mix], kernels[k].name, ns32, ns16,
+                   reference_ns / (ns32 + ns16));
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int screens = argc > 1 ? atoi(argv[1]) : 200;
+    if(screens <= 0) {
+        fprintf(stderr, "usage: %s [full screens per test]\n", argv[0]);
+        return 2;
+    }
+
+    int num_kernels;
+    const struct blend_kernels* kernels = blend_available_kernels(&num_kernels);
+    printf("kernels:");
+    for(int k = 0; k < num_kernels; k++) {
+        printf(" %s", kernels[k].name);
+    }
+    printf(", rows use %s\n", blend_kernel_name());
+
+    int failures = check_kernels(kernels, num_kernels);
+
+    int drift = premul_drift();
+    printf("premultiplied blends are within %d of straight alpha\n", drift);
+    // one step of rounding from premultiplying and one from the blend
+    if(drift > 2) {
+        printf("FAIL: premultiplied blend drifted by %d\n", drift);
+        failures++;
+    }
+
+    struct rows rows = {
+        .src32 = malloc(sizeof(uint32_t) * PIXELS),
+        .src16 = malloc(sizeof(uint16_t) * PIXELS),
+        .src_alpha = malloc(PIXELS),
+        .src32_premul = malloc(sizeof(uint32_t) * PIXELS),
+        .src16_premul = malloc(sizeof(uint16_t) * PIXELS),
+        .dst32 = malloc(sizeof(uint32_t) * PIXELS),
+        .dst16 = malloc(sizeof(uint16_t) * PIXELS),
+        .dst_alpha = malloc(PIXELS),
+    };
+
+    time_kernels("straight", kernels, num_kernels, &rows, screens, false);
+    time_kernels("premul", kernels, num_kernels, &rows, screens, true);
+
+    free(rows.src32);
+    free(rows.src16);
+    free(rows.src_alpha);
+    free(rows.src32_premul);
+    free(rows.src16_premul);
+    free(rows.dst32);
+    free(rows.dst16);
+    free(rows.dst_alpha);
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,449 @@
+// Renders a UI-like scene for a number of frames through draw_stuff on the virtual display and reports the time
+// spent in each stage. Also checks that the virtual panel matches every frame, so it doubles as a regression test
+// for the dirty rectangle code, checks every rgb565_convert rotation against Paint_SetPixel, and checks a faded and a
+// moved widget layer. Returns 1 if any frame, rotation or layer came out wrong.
+//
+// --ui runs the now playing screen's widget tree instead and counts heap calls once it has warmed up, which should
+// stay at 0. It skips back and forth between a few tracks like someone looking for a song, which is where the text
+// cache gets its hits. At the end the panel has to match the tree's screen, which only holds if the damage the tree
+// reported covered every change. Run it from the directory holding assets/.
+//
+// usage: draw-stuff-bench [frames] [--ppm prefix] [--shm name] [--ui]
+#include "hal/draw_stuff.h"
+#include "hal/display_backend.h"
+#include "hal/rgb565.h"
+#include "hal/time_util.h"
+#include "hal/image_loader.h"
+#include "hal/frame_arena.h"
+#include "hal/canvas_pool.h"
+#include "ui/load_image_assets.h"
+#include "ui/text_cache.h"
+#include "ui/widget.h"
+#include "GUI_Paint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// every heap call from the program and its libraries goes through these, see the link options in CMakeLists.txt
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static _Atomic long heap_calls = 0;
+
+void* __wrap_malloc(size_t size)
+{
+    heap_calls++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    heap_calls++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    heap_calls++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr)
+{
+    if(ptr != NULL) {
+        heap_calls++;
+    }
+    __real_free(ptr);
+}
+
+// a white screen with a text-like band that scrolls, a progress bar that fills and a blended triangle
+static void draw_scene16(Olivec_Canvas16 oc, int frame)
+{
+    olivec16_fill(oc, OLIVEC_RGBA(255, 255, 255, 255));
+    for(int i = 0; i < 20; i++) {
+        int x = (i * 14 - frame) % 280;
+        olivec16_rect(oc, x, 60, 10, 20, OLIVEC_RGBA(0, 0, 0, 255));
+    }
+    olivec16_rect(oc, 40, 105, 160, 5, OLIVEC_RGBA(0xD3, 0xD3, 0xD3, 0xFF));
+    olivec16_rect(oc, 40, 105, (frame * 2) % 160, 5, OLIVEC_RGBA(255, 0, 0, 255));
+    olivec16_triangle(oc, 112, 185, 128, 201, 112, 201, OLIVEC_RGBA(255, 0, 0, frame % 256));
+}
+
+static void draw_scene32(Olivec_Canvas oc, int frame)
+{
+    olivec_fill(oc, OLIVEC_RGBA(255, 255, 255, 255));
+    for(int i = 0; i < 20; i++) {
+        int x = (i * 14 - frame) % 280;
+        olivec_rect(oc, x, 60, 10, 20, OLIVEC_RGBA(0, 0, 0, 255));
+    }
+    olivec_rect(oc, 40, 105, 160, 5, OLIVEC_RGBA(0xD3, 0xD3, 0xD3, 0xFF));
+    olivec_rect(oc, 40, 105, (frame * 2) % 160, 5, OLIVEC_RGBA(255, 0, 0, 255));
+    olivec_triangle(oc, 112, 185, 128, 201, 112, 201, OLIVEC_RGBA(255, 0, 0, frame % 256));
+}
+
+// what the panel should hold for a 32 bit frame, packed by hand rather than with the rgb565 code being tested
+static void expected_from32(uint16_t* expected, Olivec_Canvas screen)
+{
+    for(int y = 0; y < LCD_HEIGHT; y++) {
+        for(int x = 0; x < LCD_WIDTH; x++) {
+            uint32_t colour = OLIVEC_PIXEL(screen, x, y);
+            uint16_t native = (uint16_t)((OLIVEC_RED(colour) >> 3) << 11 | (OLIVEC_GREEN(colour) >> 2) << 5 |
+                                         OLIVEC_BLUE(colour) >> 3);
+            // the panel takes the high byte first
+            expected[y * LCD_WIDTH + x] = (uint16_t)(native >> 8 | native << 8);
+        }
+    }
+}
+
+// rgb565_convert with each rotation against what Paint_SetPixel, which it replaced, does a pixel at a time. One source
+// fits inside the panel so the rest is filled, the other hangs off both edges so it's cut off
+static long check_rotations(void)
+{
+    static const int sizes[][2] = {{200, 160}, {300, 250}};
+    static const struct {
+        enum rgb565_rotation rotation;
+        UWORD paint_rotate;
+    } rotations[] = {
+        {RGB565_ROTATE_0, ROTATE_0},
+        {RGB565_ROTATE_90, ROTATE_90},
+        {RGB565_ROTATE_180, ROTATE_180},
+        {RGB565_ROTATE_270, ROTATE_270},
+    };
+    uint16_t* converted = malloc(LCD_WIDTH * LCD_HEIGHT * sizeof(uint16_t));
+    uint16_t* painted = malloc(LCD_WIDTH * LCD_HEIGHT * sizeof(uint16_t));
+    long bad = 0;
+
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        Olivec_Canvas* src = image_loader_image_create(sizes[s][0], sizes[s][1]);
+        for(size_t y = 0; y < src->height; y++) {
+            for(size_t x = 0; x < src->width; x++) {
+                OLIVEC_PIXEL(*src, x, y) = OLIVEC_RGBA(x * 7, y * 5, (x ^ y) * 3, 255);
+            }
+        }
+        for(size_t r = 0; r < sizeof(rotations) / sizeof(rotations[0]); r++) {
+            rgb565_convert(converted, LCD_WIDTH, LCD_HEIGHT, *src, rotations[r].rotation, WHITE);
+
+            Paint_NewImage(painted, LCD_WIDTH, LCD_HEIGHT, rotations[r].paint_rotate, WHITE, 16);
+            for(int i = 0; i < LCD_WIDTH * LCD_HEIGHT; i++) {
+                // the byte order Paint_SetPixel stores, Paint_Clear doesn't swap
+                painted[i] = (uint16_t)(WHITE >> 8 | WHITE << 8);
+            }
+            for(size_t y = 0; y < src->height && y < Paint.Height; y++) {
+                for(size_t x = 0; x < src->width && x < Paint.Width; x++) {
+                    uint32_t colour = OLIVEC_PIXEL(*src, x, y);
+                    UWORD native = (UWORD)((OLIVEC_RED(colour) >> 3) << 11 | (OLIVEC_GREEN(colour) >> 2) << 5 |
+                                           OLIVEC_BLUE(colour) >> 3);
+                    Paint_SetPixel(x, y, native);
+                }
+            }
+
+            if(memcmp(converted, painted, LCD_WIDTH * LCD_HEIGHT * sizeof(uint16_t)) != 0) {
+                fprintf(stderr, "%zux%zu rotated %d differs from Paint_SetPixel\n", src->width, src->height,
+                        rotations[r].paint_rotate);
+                bad++;
+            }
+        }
+        image_loader_image_free(&src);
+    }
+    free(converted);
+    free(painted);
+    return bad;
+}
+
+static long count_mismatches(const uint16_t* expected)
+{
+    const uint16_t* panel = display_backend_virtual_pixels();
+    long mismatches = 0;
+    for(int i = 0; i < LCD_WIDTH * LCD_HEIGHT; i++) {
+        if(panel[i] != expected[i]) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// render the tree and send only its damage, then the panel has to match the tree's screen
+static long render_to_panel(struct widget_tree* tree, struct draw_stuff_rect damage[WIDGET_MAX_DAMAGE], int* num_damage)
+{
+    *num_damage = widget_tree_render(tree, 0, damage);
+    if(*num_damage > 0) {
+        draw_stuff_screen16(widget_tree_screen(tree), damage, *num_damage);
+    }
+    draw_stuff_flush();
+    return count_mismatches(widget_tree_screen(tree)->pixels);
+}
+
+static bool damage_covers(const struct draw_stuff_rect* damage, int num_damage, const struct draw_stuff_rect* area)
+{
+    for(int y = area->y1; y < area->y2; y++) {
+        for(int x = area->x1; x < area->x2; x++) {
+            bool covered = false;
+            for(int i = 0; i < num_damage && !covered; i++) {
+                covered = x >= damage[i].x1 && x < damage[i].x2 && y >= damage[i].y1 && y < damage[i].y2;
+            }
+            if(!covered) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static long check_pixel(const Olivec_Canvas16* screen, int x, int y, uint16_t expected, const char* what)
+{
+    if(OLIVEC_PIXEL16(*screen, x, y) == expected) {
+        return 0;
+    }
+    fprintf(stderr, "%s: (%d, %d) is %04x, expected %04x\n", what, x, y, OLIVEC_PIXEL16(*screen, x, y), expected);
+    return 1;
+}
+
+// Two overlapping bars on one layer. Faded, the layer is mixed in as one picture so the red bar doesn't show through
+// the blue one. Moved, the damage has to cover where the bars were as well as where they are now.
+static long check_layers(void)
+{
+    const uint32_t white32 = OLIVEC_RGBA(255u, 255u, 255u, 255u);
+    const uint32_t red32 = OLIVEC_RGBA(255u, 0u, 0u, 255u);
+    const uint32_t blue32 = OLIVEC_RGBA(0u, 0u, 255u, 255u);
+    const uint16_t white = OLIVEC_RGB565(white32);
+    const uint16_t red = OLIVEC_RGB565(red32);
+    const uint16_t blue = OLIVEC_RGB565(blue32);
+    struct widget_tree* tree = widget_tree_create(LCD_WIDTH, LCD_HEIGHT, white32);
+    if(tree == NULL) {
+        return 1;
+    }
+    struct widget_layer* layer = widget_tree_add_layer(tree, false);
+    struct widget* red_bar = widget_tree_add_progress_bar(tree, 40, 50, 80, 20, red32);
+    struct widget* blue_bar = widget_tree_add_progress_bar(tree, 80, 50, 80, 20, blue32);
+    widget_progress_bar_set(red_bar, 1.0f);
+    widget_progress_bar_set(blue_bar, 1.0f);
+    const Olivec_Canvas16* screen = widget_tree_screen(tree);
+    struct draw_stuff_rect damage[WIDGET_MAX_DAMAGE];
+    int num_damage;
+    long bad = render_to_panel(tree, damage, &num_damage);
+
+    widget_layer_set_opacity(layer, 128);
+    bad += render_to_panel(tree, damage, &num_damage);
+    bad += check_pixel(screen, 60, 60, olivec16_mix(white, red, 128), "faded red");
+    bad += check_pixel(screen, 100, 60, olivec16_mix(white, blue, 128), "faded overlap");
+    bad += check_pixel(screen, 20, 60, white, "beside the faded layer");
+
+    widget_layer_set_opacity(layer, 255);
+    widget_layer_set_offset(layer, 0, 100);
+    bad += render_to_panel(tree, damage, &num_damage);
+    struct draw_stuff_rect old_area = {40, 50, 160, 70};
+    struct draw_stuff_rect new_area = {40, 150, 160, 170};
+    if(!damage_covers(damage, num_damage, &old_area) || !damage_covers(damage, num_damage, &new_area)) {
+        fprintf(stderr, "moving a layer left its old or new area out of the damage\n");
+        bad++;
+    }
+    bad += check_pixel(screen, 60, 60, white, "where the layer was");
+    bad += check_pixel(screen, 60, 160, red, "moved red");
+    bad += check_pixel(screen, 100, 160, blue, "moved overlap");
+
+    widget_tree_free(&tree);
+    return bad;
+}
+
+struct bench_track {
+    const char* album;
+    const char* title;
+    const char* artist;
+    int length_s;
+};
+
+// two from the same album, so skipping between them keeps the album label
+static const struct bench_track TRACKS[] = {
+    {"Album Name", "A track title that is far too long to fit on the screen", "By: Artist", 210},
+    {"Album Name", "Short title", "By: Artist", 185},
+    {"Another Album", "Another title that scrolls because it is long", "By: Someone Else", 242},
+};
+#define NUM_TRACKS (int)(sizeof(TRACKS) / sizeof(TRACKS[0]))
+// how long each track plays before the next skip
+#define FRAMES_PER_TRACK 150
+
+// skips forward through the tracks then back again, 0 1 2 1 0 1 2 ...
+static const struct bench_track* track_at(int frame)
+{
+    int skips = frame / FRAMES_PER_TRACK;
+    int step = skips % (2 * (NUM_TRACKS - 1));
+    return &TRACKS[step < NUM_TRACKS ? step : 2 * (NUM_TRACKS - 1) - step];
+}
+
+// the now playing screen as run_ui builds it, with a clock that advances 1/30 s per frame and a scrolling title
+static int run_ui_loop(int frames)
+{
+    // long enough for every cache and pool to fill and to have skipped through every track both ways
+    const int warmup_frames = 900;
+
+    if(load_image_assets_init() != 0 || text_cache_init(16) != 0 || frame_arena_init(16 * 1024) != 0) {
+        fprintf(stderr, "failed to init the UI, run from the directory holding assets/\n");
+        return 1;
+    }
+
+    struct widget_tree* tree = widget_tree_create(LCD_WIDTH, LCD_HEIGHT, OLIVEC_RGBA(255, 255, 255, 255));
+    if(tree == NULL) {
+        return 1;
+    }
+    widget_tree_add_layer(tree, true);
+    widget_tree_add_icon(tree, 35, 213, load_image_assets_get_volume_icon());
+    widget_tree_add_layer(tree, false);
+    struct widget* album = widget_tree_add_label(tree, WIDGET_CENTER_X, 10);
+    struct widget* title = widget_tree_add_marquee(tree, 60, LCD_WIDTH);
+    struct widget* artist = widget_tree_add_label(tree, WIDGET_CENTER_X, 80);
+    struct widget* time_bar = widget_tree_add_progress_bar(tree, 40, 105, 160, 5, OLIVEC_RGBA(255, 0, 0, 255));
+    struct widget* time_label = widget_tree_add_label(tree, WIDGET_CENTER_X, 110);
+    widget_tree_add_icon(tree, WIDGET_CENTER_X, 140, load_image_assets_get_pause_icon());
+    struct widget* volume_bar = widget_tree_add_progress_bar(tree, 60, 220, 120, 5, OLIVEC_RGBA(0, 0, 255, 255));
+    struct draw_stuff_rect damage[WIDGET_MAX_DAMAGE];
+
+    long heap_calls_at_warmup = 0;
+    long long render_us = 0;
+    long updates = 0;
+    for(int frame = 0; frame < warmup_frames + frames; frame++) {
+        if(frame == warmup_frames) {
+            draw_stuff_flush();
+            heap_calls_at_warmup = heap_calls;
+        }
+        long long start = time_us();
+        frame_arena_reset();
+        const struct bench_track* track = track_at(frame);
+        int seconds = frame % FRAMES_PER_TRACK / 30;
+        char* time_str = frame_arena_alloc(32);
+        snprintf(time_str, 32, "%02d:%02d / %02d:%02d", seconds / 60, seconds % 60, track->length_s / 60,
+                 track->length_s % 60);
+        widget_label_set_text(album, track->album);
+        widget_label_set_text(title, track->title);
+        widget_label_set_text(artist, track->artist);
+        widget_label_set_text(time_label, time_str);
+        widget_progress_bar_set(time_bar, seconds / (float)track->length_s);
+        widget_progress_bar_set(volume_bar, 0.8f);
+        int num_damage = widget_tree_render(tree, frame * 1000L / 30, damage);
+        if(num_damage > 0) {
+            draw_stuff_screen16(widget_tree_screen(tree), damage, num_damage);
+        }
+        if(frame >= warmup_frames) {
+            render_us += time_us() - start;
+            updates += num_damage > 0;
+        }
+    }
+    draw_stuff_flush();
+    long steady_heap_calls = heap_calls - heap_calls_at_warmup;
+    // draw_stuff_screen16 only copied the damage, so this checks the damage covered every change
+    long mismatches = count_mismatches(widget_tree_screen(tree)->pixels);
+
+    struct text_cache_stats text_stats;
+    text_cache_get_stats(&text_stats);
+    struct canvas_pool_stats pool_stats;
+    canvas_pool_get_stats(&pool_stats);
+    int n = frames > 0 ? frames : 1;
+    printf("ui frames:       %d after %d warmup, %ld with damage\n", frames, warmup_frames, updates);
+    printf("render+submit:   %8.1f us/frame\n", render_us / (double)n);
+    printf("text cache:      %ld hits, %ld misses, %ld evictions\n", text_stats.hits, text_stats.misses, text_stats.evictions);
+    printf("canvas pool:     %ld mallocs, %ld reused\n", pool_stats.heap_allocs, pool_stats.reused);
+    printf("heap calls:      %ld during warmup, %ld in the steady state\n", heap_calls_at_warmup, steady_heap_calls);
+    printf("panel mismatches: %ld\n", mismatches);
+
+    widget_tree_free(&tree);
+    frame_arena_cleanup();
+    text_cache_cleanup();
+    load_image_assets_cleanup();
+    draw_stuff_cleanup();
+    return steady_heap_calls != 0 || mismatches != 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int frames = 300;
+    const char* ppm_prefix = NULL;
+    const char* shm_name = NULL;
+    bool ui = false;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+            ppm_prefix = argv[++i];
+        } else if(strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_name = argv[++i];
+        } else if(strcmp(argv[i], "--ui") == 0) {
+            ui = true;
+        } else {
+            char* end;
+            long value = strtol(argv[i], &end, 10);
+            if(argv[i][0] == '\0' || *end != '\0' || value <= 0 || value > 1000000) {
+                fprintf(stderr, "usage: %s [frames] [--ppm prefix] [--shm name] [--ui]\n", argv[0]);
+                return 2;
+            }
+            frames = (int)value;
+        }
+    }
+
+    display_backend_virtual_set_output(shm_name, ppm_prefix);
+    draw_stuff_init_backend(&display_backend_virtual);
+    if(ui) {
+        return run_ui_loop(frames);
+    }
+
+    Olivec_Canvas16* expected = image_loader_image16_create(LCD_WIDTH, LCD_HEIGHT, false);
+    Olivec_Canvas16* screen16 = image_loader_image16_create(LCD_WIDTH, LCD_HEIGHT, false);
+    Olivec_Canvas* screen32 = image_loader_image_create(LCD_WIDTH, LCD_HEIGHT);
+    long long render16_us = 0;
+    long long render32_us = 0;
+    long long convert_us = 0;
+    long long display_us = 0;
+    long bad_frames = 0;
+
+    for(int frame = 0; frame < frames; frame++) {
+        // 16 bit path, composed in the panel's format and copied by draw_stuff_screen16
+        long long start = time_us();
+        draw_scene16(*screen16, frame);
+        render16_us += time_us() - start;
+        draw_stuff_screen16(screen16, NULL, 0);
+        draw_stuff_flush();
+        if(count_mismatches(screen16->pixels) != 0) {
+            fprintf(stderr, "frame %d (16 bit) differs from the panel\n", frame);
+            bad_frames++;
+        }
+        struct draw_stuff_stats stats;
+        draw_stuff_get_stats(&stats);
+        display_us += stats.last_latency_us;
+
+        // 32 bit path, converted by draw_stuff_screen
+        start = time_us();
+        draw_scene32(*screen32, frame);
+        long long rendered = time_us();
+        draw_stuff_screen(screen32);
+        convert_us += time_us() - rendered;
+        render32_us += rendered - start;
+        draw_stuff_flush();
+        expected_from32(expected->pixels, *screen32);
+        if(count_mismatches(expected->pixels) != 0) {
+            fprintf(stderr, "frame %d (32 bit) differs from the panel\n", frame);
+            bad_frames++;
+        }
+        draw_stuff_get_stats(&stats);
+        display_us += stats.last_latency_us;
+    }
+
+    struct draw_stuff_stats stats;
+    draw_stuff_get_stats(&stats);
+    int n = frames > 0 ? frames : 1;
+    printf("frames: %d x 2, rgb565 kernel: %s\n", frames, rgb565_kernel_name());
+    printf("render 16 bit:   %8.1f us/frame\n", render16_us / (double)n);
+    printf("render 32 bit:   %8.1f us/frame\n", render32_us / (double)n);
+    printf("convert+submit:  %8.1f us/frame\n", convert_us / (double)n);
+    printf("diff+send:       %8.1f us/frame\n", display_us / (2.0 * n));
+    printf("bytes sent:      %8.1f per frame\n", stats.bytes_total / (double)stats.frames_displayed);
+    printf("bad frames:      %ld\n", bad_frames);
+    long bad_rotations = check_rotations();
+    printf("bad rotations:   %ld of 8\n", bad_rotations);
+    long bad_layers = check_layers();
+    printf("bad layers:      %ld\n", bad_layers);
+
+    image_loader_image16_free(&expected);
+    image_loader_image16_free(&screen16);
+    image_loader_image_free(&screen32);
+    draw_stuff_cleanup();
+    return bad_frames != 0 || bad_rotations != 0 || bad_layers != 0;
+}
@@ -15,8 +15,8 @@ int main()
     Olivec_Canvas* screen = image_loader_image_create(240, 240);
 
     olivec_fill(*screen, OLIVEC_RGBA(255, 255, 255, 255));
-    olivec_sprite_blend(*screen, 50, 50, tux->width, tux->height, *tux);
-    olivec_sprite_blend(*screen, 0, 0, red_c->width / 2, red_c->height / 2, *red_c);
+    olivec_sprite_blend_premul(*screen, 50, 50, tux->width, tux->height, *tux);
+    olivec_sprite_blend_premul(*screen, 0, 0, red_c->width / 2, red_c->height / 2, *red_c);
 
     draw_stuff_init();
     // draw_stuff_update_screen("hello world\nhello world\n");
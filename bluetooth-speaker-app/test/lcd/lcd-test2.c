@@ -12,12 +12,13 @@ int main()
     // Olivec_Canvas* screen = draw
 
     Olivec_Canvas* screen = image_loader_image_create(240, 240);
-    Olivec_Canvas* album = draw_ui_text("Album Name");
-    Olivec_Canvas* track = draw_ui_text("Track Name");
-    Olivec_Canvas* time_txt = draw_ui_text("0:11 / 2:11");
+    Olivec_Canvas* album = draw_ui_text("Album Name", OLIVEC_RGBA(0, 0, 0, 255));
+    Olivec_Canvas* track = draw_ui_text("Track Name", OLIVEC_RGBA(0, 0, 0, 255));
+    Olivec_Canvas* time_txt = draw_ui_text("0:11 / 2:11", OLIVEC_RGBA(0, 0, 0, 255));
     Olivec_Canvas* time_bar = draw_ui_progress_bar(120, 5, 0.89f, OLIVEC_RGBA(255, 0, 0, 255));
     Olivec_Canvas* volume_bar = draw_ui_progress_bar(120, 5, 0.5f, OLIVEC_RGBA(0, 0, 255, 255));
-    Olivec_Canvas* volume_icon = load_image_assets_get_volume_icon();
+    // the loaded icons are encoded for 16 bit canvases, this screen is RGBA
+    Olivec_Canvas* volume_icon = image_loader_load("./assets/img/icon/volume_icon.png");
 
     olivec_fill(*screen, OLIVEC_RGBA(255, 255, 255, 255));
     draw_ui_blend_centered(*screen, *album, 10);
@@ -26,7 +27,7 @@ int main()
     draw_ui_blend_centered(*screen, *time_txt, 115);
  
     int vol_bar_x = draw_ui_blend_centered(*screen, *volume_bar, 150);
-    olivec_sprite_blend(*screen, vol_bar_x, 160, volume_icon->width, volume_icon->height, *volume_icon);
+    olivec_sprite_blend_premul(*screen, vol_bar_x, 160, volume_icon->width, volume_icon->height, *volume_icon);
 
     draw_stuff_init();
     // draw_stuff_update_screen("hello world\nhello world\n");
@@ -34,6 +35,6 @@ int main()
     sleep(10);
     draw_stuff_cleanup();
 
-
+    image_loader_image_free(&volume_icon);
     load_image_assets_cleanup();
 }
\ No newline at end of file
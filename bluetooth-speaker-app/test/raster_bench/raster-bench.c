@@ -0,0 +1,255 @@
+// Checks that olivec16_triangle, now a scanline fill, draws exactly what the barycentric test over the bounding box
+// drew for random triangles, clipped and degenerate ones included, and that antialiased shapes cover as much of the
+// canvas as their area. Then times the old per pixel test against the scanline fills for the shapes the UI draws.
+// Returns 1 if any check fails.
+//
+// usage: raster-bench [repetitions of each shape]
+#include "hal/image_loader.h"
+#include "hal/raster.h"
+#include "hal/time_util.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 240
+#define HEIGHT 240
+#define NUM_TRIANGLES 100000
+
+static uint32_t rng_state = 12345;
+
+static uint32_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// olivec16_triangle as it was, a barycentric test of every pixel in the bounding box
+static void barycentric_triangle(Olivec_Canvas16 oc, int x1, int y1, int x2, int y2, int x3, int y3, uint32_t color)
+{
+    int lx, hx, ly, hy;
+    uint16_t c = OLIVEC_RGB565(color);
+    uint32_t a = OLIVEC_ALPHA(color);
+    if(!olivec_normalize_triangle(oc.width, oc.height, x1, y1, x2, y2, x3, y3, &lx, &hx, &ly, &hy)) {
+        return;
+    }
+    for(int y = ly; y <= hy; y++) {
+        for(int x = lx; x <= hx; x++) {
+            int u1, u2, det;
+            if(olivec_barycentric(x1, y1, x2, y2, x3, y3, x, y, &u1, &u2, &det)) {
+                uint16_t* p = &OLIVEC_PIXEL16(oc, x, y);
+                *p = olivec16_mix(*p, c, a);
+                if(oc.alpha != NULL) {
+                    uint8_t* pa = &OLIVEC_PIXEL16_ALPHA(oc, x, y);
+                    *pa = a + (*pa) * (255 - a) / 255;
+                }
+            }
+        }
+    }
+}
+
+static void fill_random(Olivec_Canvas16 canvas)
+{
+    for(size_t i = 0; i < canvas.width * canvas.height; i++) {
+        canvas.pixels[i] = next_random();
+        canvas.alpha[i] = next_random();
+    }
+}
+
+// small canvases so many triangles hang off the edges, every third has a horizontal edge and some have no area
+static int check_triangles(void)
+{
+    Olivec_Canvas16* expected = image_loader_image16_create(64, 48, true);
+    Olivec_Canvas16* actual = image_loader_image16_create(64, 48, true);
+    int failures = 0;
+    for(int i = 0; i < NUM_TRIANGLES; i++) {
+        int p[6];
+        for(int k = 0; k < 6; k++) {
+            p[k] = (int)(next_random() % 90) - 13;
+        }
+        if(i % 3 == 0) {
+            p[1] = p[3];
+        }
+        if(i % 101 == 0) {
+            p[4] = p[2] + (p[2] - p[0]);
+            p[5] = p[3] + (p[3] - p[1]);
+        }
+        uint32_t colour = next_random() | (i % 2 == 0 ? 0xFF000000 : 0);
+        fill_random(*expected);
+        memcpy(actual->pixels, expected->pixels, sizeof(uint16_t) * 64 * 48);
+        memcpy(actual->alpha, expected->alpha, 64 * 48);
+        barycentric_triangle(*expected, p[0], p[1], p[2], p[3], p[4], p[5], colour);
+        olivec16_triangle(*actual, p[0], p[1], p[2], p[3], p[4], p[5], colour);
+        if(memcmp(expected->pixels, actual->pixels, sizeof(uint16_t) * 64 * 48) != 0 ||
+           memcmp(expected->alpha, actual->alpha, 64 * 48) != 0) {
+            if(failures < 5) {
+                printf("FAIL: triangle (%d, %d) (%d, %d) (%d, %d) differs\n", p[0], p[1], p[2], p[3], p[4], p[5]);
+            }
+            failures++;
+        }
+    }
+    image_loader_image16_free(&expected);
+    image_loader_image16_free(&actual);
+    printf("%d triangles checked against the barycentric test, %d differ\n", NUM_TRIANGLES, failures);
+    return failures;
+}
+
+// how many pixels' worth the last shape drew onto a transparent canvas, which is then cleared again
+static double covered(Olivec_Canvas16 canvas)
+{
+    double sum = 0;
+    for(size_t i = 0; i < canvas.width * canvas.height; i++) {
+        sum += canvas.alpha[i] / 255.0;
+    }
+    memset(canvas.alpha, 0, canvas.width * canvas.height);
+    return sum;
+}
+
+static int check_area(Olivec_Canvas16 canvas, const char* name, double expected)
+{
+    double actual = covered(canvas);
+    // edge pixels round to the nearest 1/255, a fraction of a pixel over the whole outline
+    bool ok = fabs(actual - expected) < 0.5;
+    printf("%s %-16s covers %9.2f pixels, area %9.2f\n", ok ? "    " : "FAIL", name, actual, expected);
+    return ok ? 0 : 1;
+}
+
+static int check_antialiasing(void)
+{
+    Olivec_Canvas16* canvas = image_loader_image16_create(WIDTH, HEIGHT, true);
+    memset(canvas->alpha, 0, WIDTH * HEIGHT);
+    uint32_t colour = OLIVEC_RGBA(0, 0, 0, 255);
+    int failures = 0;
+
+    raster_triangle(*canvas, 3.3f, 4.1f, 50.7f, 20.2f, 10.5f, 60.9f, colour, true);
+    failures += check_area(*canvas, "triangle", fabs((50.7 - 3.3) * (60.9 - 4.1) - (10.5 - 3.3) * (20.2 - 4.1)) / 2);
+    raster_line(*canvas, 4, 4, 20, 20, 4, colour, true);
+    failures += check_area(*canvas, "diagonal line", 4 * sqrt(16 * 16 * 2));
+    raster_line(*canvas, 2, 30.3f, 200, 33, 1.5f, colour, true);
+    failures += check_area(*canvas, "shallow line", 1.5 * sqrt(198 * 198 + 2.7 * 2.7));
+    raster_round_rect(*canvas, 5.5f, 6, 40, 30, 8, colour, true);
+    failures += check_area(*canvas, "rounded rect", 40 * 30 - (4 - 3.14159265358979) * 8 * 8);
+    raster_round_rect(*canvas, -20, HEIGHT - 10, WIDTH + 40, 30, 8, colour, true);
+    failures += check_area(*canvas, "clipped", WIDTH * 10);
+
+    image_loader_image16_free(&canvas);
+    return failures;
+}
+
+struct shape {
+    const char* name;
+    // drawn with the barycentric test, NULL if there was no way to draw the shape before
+    void (*barycentric)(Olivec_Canvas16 canvas);
+    void (*scanline)(Olivec_Canvas16 canvas, bool antialias);
+};
+
+// a thick line as user_interface.c used to draw it, two triangles t wide
+static void line_barycentric(Olivec_Canvas16 oc, int x1, int y1, int x2, int y2, int t, uint32_t color)
+{
+    int d_x = x2 - x1;
+    int d_y = y2 - y1;
+    double len = 2 * sqrt(d_x * d_x + d_y * d_y);
+    int ax = x1 + d_y * t / len;
+    int ay = y1 - d_x * t / len;
+    int bx = x1 - d_y * t / len;
+    int by = y1 + d_x * t / len;
+    int cx = x2 + d_y * t / len;
+    int cy = y2 - d_x * t / len;
+    int dx = x2 - d_y * t / len;
+    int dy = y2 + d_x * t / len;
+    barycentric_triangle(oc, ax, ay, cx, cy, bx, by, color);
+    barycentric_triangle(oc, dx, dy, bx, by, cx, cy, color);
+}
+
+// the error X where the now playing screen shows it
+static void error_x_barycentric(Olivec_Canvas16 canvas)
+{
+    line_barycentric(canvas, 112, 185, 128, 201, 4, OLIVEC_RGBA(255, 0, 0, 255));
+    line_barycentric(canvas, 128, 185, 112, 201, 4, OLIVEC_RGBA(255, 0, 0, 255));
+}
+
+static void error_x_scanline(Olivec_Canvas16 canvas, bool antialias)
+{
+    raster_line(canvas, 112, 185, 128, 201, 4, OLIVEC_RGBA(255, 0, 0, 255), antialias);
+    raster_line(canvas, 128, 185, 112, 201, 4, OLIVEC_RGBA(255, 0, 0, 255), antialias);
+}
+
+static void big_triangle_barycentric(Olivec_Canvas16 canvas)
+{
+    barycentric_triangle(canvas, 20, 30, 220, 60, 60, 210, OLIVEC_RGBA(0, 0, 255, 0x80));
+}
+
+static void big_triangle_scanline(Olivec_Canvas16 canvas, bool antialias)
+{
+    raster_triangle(canvas, 20.5f, 30.5f, 220.5f, 60.5f, 60.5f, 210.5f, OLIVEC_RGBA(0, 0, 255, 0x80), antialias);
+}
+
+// a thin diagonal's bounding box is almost all outside it
+static void long_line_barycentric(Olivec_Canvas16 canvas)
+{
+    line_barycentric(canvas, 10, 10, 230, 230, 3, OLIVEC_RGBA(0, 0, 0, 255));
+}
+
+static void long_line_scanline(Olivec_Canvas16 canvas, bool antialias)
+{
+    raster_line(canvas, 10, 10, 230, 230, 3, OLIVEC_RGBA(0, 0, 0, 255), antialias);
+}
+
+static void button_scanline(Olivec_Canvas16 canvas, bool antialias)
+{
+    raster_round_rect(canvas, 40, 150, 160, 40, 12, OLIVEC_RGBA(0x30, 0x30, 0x30, 255), antialias);
+}
+
+static double time_ns(Olivec_Canvas16 canvas, const struct shape* shape, int repetitions, int mode)
+{
+    long long start = time_us();
+    for(int i = 0; i < repetitions; i++) {
+        if(mode == 0) {
+            shape->barycentric(canvas);
+        } else {
+            shape->scanline(canvas, mode == 2);
+        }
+    }
+    return (time_us() - start) * 1000.0 / repetitions;
+}
+
+int main(int argc, char* argv[])
+{
+    int repetitions = argc > 1 ? atoi(argv[1]) : 2000;
+    if(repetitions <= 0) {
+        fprintf(stderr, "usage: %s [repetitions of each shape]\n", argv[0]);
+        return 2;
+    }
+
+    int failures = check_triangles() + check_antialiasing();
+
+    static const struct shape SHAPES[] = {
+        {"error x", error_x_barycentric, error_x_scanline},
+        {"triangle", big_triangle_barycentric, big_triangle_scanline},
+        {"long line", long_line_barycentric, long_line_scanline},
+        {"button", NULL, button_scanline},
+    };
+    Olivec_Canvas16* canvas = image_loader_image16_create(WIDTH, HEIGHT, true);
+    fill_random(*canvas);
+    printf("\n%-10s %14s %14s %14s %9s\n", "shape", "barycentric ns", "scanline ns", "antialias ns", "speedup");
+    for(size_t i = 0; i < sizeof(SHAPES) / sizeof(SHAPES[0]); i++) {
+        const struct shape* shape = &SHAPES[i];
+        double scanline = time_ns(*canvas, shape, repetitions, 1);
+        double antialias = time_ns(*canvas, shape, repetitions, 2);
+        if(shape->barycentric != NULL) {
+            double barycentric = time_ns(*canvas, shape, repetitions, 0);
+            printf("%-10s %14.0f %14.0f %14.0f %8.2fx\n", shape->name, barycentric, scanline, antialias,
+                   barycentric / scanline);
+        } else {
+            printf("%-10s %14s %14.0f %14.0f %9s\n", shape->name, "-", scanline, antialias, "-");
+        }
+    }
+    image_loader_image16_free(&canvas);
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+// Encodes every character image and icon in assets/ and a few labels laid out from the characters, checks that
+// blitting the encoded sprites gives exactly what the plain sprite blends give, then times both drawing the whole set
+// over and over. Only the icons are encoded in the UI, the glyph and label rows show why text isn't. Returns 1 if any
+// blit differs.
+//
+// usage: rle-bench [passes over the images]    (run from the directory holding assets/)
+#include "hal/image_loader.h"
+#include "hal/rle_sprite.h"
+#include "hal/time_util.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 240
+#define HEIGHT 240
+#define MAX_IMAGES 128
+
+static const char characters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789~`!@#$%^&*()[{]}\\|;:\"\',<.>/? ";
+static const char* ICONS[] = {
+    "volume_icon", "shuffle", "repeat", "replay", "play", "pause",
+};
+
+// glyphs and labels are blended from 16 bit straight images like the text cache holds, icons from the premultiplied
+// RGBA images
+struct image {
+    Olivec_Canvas* rgba;
+    Olivec_Canvas16* image16;
+    struct rle_sprite* sprite;
+};
+
+struct image_set {
+    const char* name;
+    struct image images[MAX_IMAGES];
+    int count;
+    bool premultiplied;
+};
+
+// a line of text laid out from the glyph images the way the text cache renders labels, the glyphs are copied so the
+// strip is transparent between them
+static void add_strip(struct image_set* set, const struct image_set* glyphs, const char* text)
+{
+    size_t length = strlen(text);
+    int glyph_width = glyphs->images[0].image16->width;
+    int glyph_height = glyphs->images[0].image16->height;
+    struct image* image = &set->images[set->count++];
+    image->rgba = NULL;
+    image->image16 = image_loader_image16_create(glyph_width * length, glyph_height, true);
+    olivec16_fill(*image->image16, OLIVEC_RGBA(0, 0, 0, 0));
+    for(size_t i = 0; i < length; i++) {
+        const char* c = strchr(characters, text[i]);
+        const Olivec_Canvas16* glyph = glyphs->images[c != NULL ? c - characters : 0].image16;
+        olivec16_sprite_copy(*image->image16, i * glyph_width, 0, glyph->width, glyph->height, *glyph);
+    }
+    image->sprite = rle_sprite_from16(*image->image16);
+}
+
+static bool add_image(struct image_set* set, const char* path)
+{
+    Olivec_Canvas* rgba = image_loader_load(path);
+    if(rgba == NULL) {
+        return false;
+    }
+    struct image* image = &set->images[set->count++];
+    image->rgba = rgba;
+    image->image16 = image_loader_image16_from(rgba);
+    image->sprite = set->premultiplied ? rle_sprite_from_premul(*rgba) : rle_sprite_from16(*image->image16);
+    return true;
+}
+
+static void plain_blend(const struct image_set* set, const struct image* image, Olivec_Canvas16 canvas, int x, int y)
+{
+    if(set->premultiplied) {
+        olivec16_sprite_blend32_premul(canvas, x, y, image->rgba->width, image->rgba->height, *image->rgba);
+    } else {
+        olivec16_sprite_blend(canvas, x, y, image->image16->width, image->image16->height, *image->image16);
+    }
+}
+
+static void fill_canvas(Olivec_Canvas16 canvas)
+{
+    for(size_t i = 0; i < canvas.width * canvas.height; i++) {
+        canvas.pixels[i] = rand();
+        canvas.alpha[i] = rand();
+    }
+}
+
+// every image at positions that clip it on each side as well as fully inside the canvas
+static int check(const struct image_set* set, Olivec_Canvas16 expected, Olivec_Canvas16 actual)
+{
+    static const int POSITIONS[][2] = {{5, 7}, {-3, 10}, {10, -4}, {WIDTH - 6, 20}, {30, HEIGHT - 5}, {-50, -50}};
+    int failures = 0;
+    for(int i = 0; i < set->count; i++) {
+        for(size_t p = 0; p < sizeof(POSITIONS) / sizeof(POSITIONS[0]); p++) {
+            fill_canvas(expected);
+            memcpy(actual.pixels, expected.pixels, sizeof(uint16_t) * WIDTH * HEIGHT);
+            memcpy(actual.alpha, expected.alpha, WIDTH * HEIGHT);
+            plain_blend(set, &set->images[i], expected, POSITIONS[p][0], POSITIONS[p][1]);
+            rle_sprite_blit(actual, POSITIONS[p][0], POSITIONS[p][1], set->images[i].sprite);
+            if(memcmp(expected.pixels, actual.pixels, sizeof(uint16_t) * WIDTH * HEIGHT) != 0 ||
+               memcmp(expected.alpha, actual.alpha, WIDTH * HEIGHT) != 0) {
+                printf("FAIL: %s image %d differs at (%d, %d)\n", set->name, i, POSITIONS[p][0], POSITIONS[p][1]);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+static void report(const struct image_set* set, Olivec_Canvas16 canvas, int passes)
+{
+    long pixels = 0;
+    long encoded = 0;
+    long opaque = 0;
+    int spans = 0;
+    for(int i = 0; i < set->count; i++) {
+        const struct rle_sprite* sprite = set->images[i].sprite;
+        pixels += (long)sprite->width * sprite->height;
+        spans += sprite->num_spans;
+        for(int s = 0; s < sprite->num_spans; s++) {
+            encoded += sprite->spans[s].length;
+            opaque += sprite->spans[s].opaque ? sprite->spans[s].length : 0;
+        }
+    }
+
+    // lay the images out in a grid like a screen of text so the destination isn't always the same few pixels
+    long long start = time_us();
+    for(int pass = 0; pass < passes; pass++) {
+        for(int i = 0; i < set->count; i++) {
+            plain_blend(set, &set->images[i], canvas, (i * 23) % (WIDTH - 20), (i * 7) % (HEIGHT - 20));
+        }
+    }
+    long long mid = time_us();
+    for(int pass = 0; pass < passes; pass++) {
+        for(int i = 0; i < set->count; i++) {
+            rle_sprite_blit(canvas, (i * 23) % (WIDTH - 20), (i * 7) % (HEIGHT - 20), set->images[i].sprite);
+        }
+    }
+    long long end = time_us();
+
+    double blits = (double)passes * set->count;
+    double plain_ns = (mid - start) * 1000.0 / blits;
+    double rle_ns = (end - mid) * 1000.0 / blits;
+    printf("%-8s %6d %7.1f%% %7.1f%% %6.1f %12.0f %12.0f %8.2fx\n", set->name, set->count,
+           100.0 * (pixels - encoded) / pixels, 100.0 * opaque / pixels, (double)spans / set->count, plain_ns, rle_ns,
+           plain_ns / rle_ns);
+}
+
+static void free_set(struct image_set* set)
+{
+    for(int i = 0; i < set->count; i++) {
+        image_loader_image_free(&set->images[i].rgba);
+        image_loader_image16_free(&set->images[i].image16);
+        rle_sprite_free(&set->images[i].sprite);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int passes = argc > 1 ? atoi(argv[1]) : 2000;
+    if(passes <= 0) {
+        fprintf(stderr, "usage: %s [passes over the images]\n", argv[0]);
+        return 2;
+    }
+
+    static struct image_set glyphs = {.name = "glyphs", .premultiplied = false};
+    static struct image_set icons = {.name = "icons", .premultiplied = true};
+    static struct image_set strips = {.name = "labels", .premultiplied = false};
+    char path[256];
+    for(size_t i = 0; i < sizeof(characters); i++) {
+        snprintf(path, sizeof(path), "./assets/img/characters/char_%d.png", characters[i]);
+        if(!add_image(&glyphs, path)) {
+            fprintf(stderr, "run from the directory holding assets/\n");
+            return 2;
+        }
+    }
+    for(size_t i = 0; i < sizeof(ICONS) / sizeof(ICONS[0]); i++) {
+        snprintf(path, sizeof(path), "./assets/img/icon/%s.png", ICONS[i]);
+        if(!add_image(&icons, path)) {
+            fprintf(stderr, "run from the directory holding assets/\n");
+            return 2;
+        }
+    }
+
+    add_strip(&strips, &glyphs, "Album Name");
+    add_strip(&strips, &glyphs, "Track Name");
+    add_strip(&strips, &glyphs, "0:11 / 2:11");
+    add_strip(&strips, &glyphs, "Artist");
+
+    Olivec_Canvas16* expected = image_loader_image16_create(WIDTH, HEIGHT, true);
+    Olivec_Canvas16* actual = image_loader_image16_create(WIDTH, HEIGHT, true);
+    int failures = check(&glyphs, *expected, *actual) + check(&icons, *expected, *actual) +
+                   check(&strips, *expected, *actual);
+
+    printf("%-8s %6s %8s %8s %6s %12s %12s %9s\n", "images", "count", "skipped", "copied", "spans", "plain ns", "rle ns",
+           "speedup");
+    report(&glyphs, *actual, passes);
+    report(&icons, *actual, passes);
+    report(&strips, *actual, passes);
+
+    free_set(&glyphs);
+    free_set(&icons);
+    free_set(&strips);
+    image_loader_image16_free(&expected);
+    image_loader_image16_free(&actual);
+
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,356 @@
+// Checks UTF-8 decoding and truncation, the glyph cache (accented letters built from the atlas, glyphs from a .hex
+// font, code points with no glyph, least recently used eviction under the budget) and cutting labels to a width in
+// pixels. Runs on a made up atlas and a small .hex font written to /tmp, then checks that every glyph in the shipped
+// assets/fonts/fallback.hex can be looked up. Then times glyph cache hits and misses and measuring a label. Returns 1
+// if any check fails.
+//
+// usage: text-bench [repetitions]    (run from the directory holding assets/)
+#define _POSIX_C_SOURCE 200809L
+#include "hal/image_loader.h"
+#include "hal/time_util.h"
+#include "ui/glyph_atlas.h"
+#include "ui/glyph_cache.h"
+#include "ui/utf8.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ADVANCE 10
+#define LINE_HEIGHT 20
+#define MAX_CODE_POINTS 16
+
+static const char* FONT_PATH = "/tmp/text-bench.hex";
+static const char* SHIPPED_FONT_PATH = "./assets/fonts/fallback.hex";
+// sorted like unifont.hex. U+00A9 is 8 wide, U+3042 and U+30A2 16 wide, the bitmap of U+3042 is a box outline
+static const char* FONT =
+    "00A9:00003C4299A1A1A1A199423C00000000\n"
+    "3042:0000FFFF800180018001800180018001800180018001800180018001FFFF0000\n"
+    "30A2:00000000000000000000000000000000000000000000000000000000000000FF\n";
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+    if(!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+struct decode_case {
+    const char* name;
+    const char* text;
+    uint32_t expected[MAX_CODE_POINTS];
+};
+
+static const struct decode_case DECODE_CASES[] = {
+    {"ascii", "Ab~", {'A', 'b', '~'}},
+    {"2 byte", "\xC3\xA9t\xC3\xA9", {0xE9, 't', 0xE9}},
+    {"3 byte", "\xE3\x81\x82\xE2\x82\xAC", {0x3042, 0x20AC}},
+    {"4 byte", "\xF0\x9F\x8E\xB5!", {0x1F3B5, '!'}},
+    {"overlong", "\xC0\x80x", {UTF8_REPLACEMENT, 'x'}},
+    {"surrogate", "\xED\xA0\x80", {UTF8_REPLACEMENT}},
+    {"past U+10FFFF", "\xF4\x90\x80\x80", {UTF8_REPLACEMENT}},
+    // a bad sequence is replaced one byte at a time, its continuation bytes each count as another
+    {"stray continuations", "\x80\xBFz", {UTF8_REPLACEMENT, UTF8_REPLACEMENT, 'z'}},
+    {"bad lead byte", "\xFFq", {UTF8_REPLACEMENT, 'q'}},
+    {"cut off at the end", "a\xE3\x81", {'a', UTF8_REPLACEMENT, UTF8_REPLACEMENT}},
+    {"cut off by a new sequence", "\xE3\x81\xC3\xA9", {UTF8_REPLACEMENT, UTF8_REPLACEMENT, 0xE9}},
+};
+
+static void check_utf8(void)
+{
+    for(size_t i = 0; i < sizeof(DECODE_CASES) / sizeof(DECODE_CASES[0]); i++) {
+        const struct decode_case* test = &DECODE_CASES[i];
+        const char* p = test->text;
+        bool ok = true;
+        for(int k = 0; k < MAX_CODE_POINTS; k++) {
+            const char* before = p;
+            uint32_t c = utf8_next(&p);
+            ok = ok && c == test->expected[k];
+            if(c == 0) {
+                // the end doesn't move the pointer, so calling again is safe
+                ok = ok && p == before && *p == '\0';
+                break;
+            }
+        }
+        char what[64];
+        snprintf(what, sizeof(what), "utf8_next %s", test->name);
+        check(ok, what);
+    }
+
+    char buf[32];
+    strcpy(buf, "h\xC3\xA9llo");
+    utf8_truncate(buf, 2);
+    check(strcmp(buf, "h\xC3\xA9") == 0, "utf8_truncate keeps whole code points");
+    strcpy(buf, "h\xC3\xA9llo");
+    utf8_truncate(buf, 0);
+    check(buf[0] == '\0', "utf8_truncate to 0");
+    strcpy(buf, "\xF0\x9F\x8E\xB5\xF0\x9F\x8E\xB5");
+    utf8_truncate(buf, 1);
+    check(strcmp(buf, "\xF0\x9F\x8E\xB5") == 0, "utf8_truncate 4 byte code points");
+    strcpy(buf, "short");
+    utf8_truncate(buf, 10);
+    check(strcmp(buf, "short") == 0, "utf8_truncate shorter than max_chars");
+}
+
+// a glyph for every printable ASCII character, a bar whose height depends on the character so they differ
+static int init_atlas(void)
+{
+    Olivec_Canvas* images[GLYPH_ATLAS_NUM_CHARS] = {0};
+    for(int c = 0; c < GLYPH_ATLAS_NUM_CHARS; c++) {
+        if(c != 0 && (c < ' ' || c > '~')) {
+            continue;
+        }
+        images[c] = image_loader_image_create(ADVANCE, LINE_HEIGHT);
+        olivec_fill(*images[c], OLIVEC_RGBA(0, 0, 0, 0));
+        if(c != ' ') {
+            int height = 6 + c % 8;
+            olivec_rect(*images[c], 2, LINE_HEIGHT - 4 - height, 6, height, OLIVEC_RGBA(0, 0, 0, 255));
+        }
+    }
+    int code = glyph_atlas_init(images, ADVANCE, LINE_HEIGHT);
+    for(int c = 0; c < GLYPH_ATLAS_NUM_CHARS; c++) {
+        if(images[c] != NULL) {
+            image_loader_image_free(&images[c]);
+        }
+    }
+    return code;
+}
+
+static int write_font(void)
+{
+    FILE* file = fopen(FONT_PATH, "w");
+    if(file == NULL) {
+        return 1;
+    }
+    fputs(FONT, file);
+    fclose(file);
+    return 0;
+}
+
+static bool has_ink(Olivec_Mask image, int x, int y)
+{
+    return OLIVEC_COVERAGE(image, x, y) != 0;
+}
+
+static void check_glyph_cache(void)
+{
+    Olivec_Mask image;
+    struct glyph_cache_stats stats;
+
+    // é is e from the atlas with an acute accent above it
+    const struct glyph* e_acute = glyph_cache_get(0xE9, &image);
+    check(e_acute != NULL && e_acute->advance == ADVANCE && e_acute->height == LINE_HEIGHT, "composed glyph size");
+    if(e_acute != NULL) {
+        const struct glyph* e = glyph_atlas_get('e');
+        Olivec_Mask e_mask = glyph_atlas_get_mask('e');
+        bool same_base = true;
+        bool mark_above = false;
+        for(int y = 0; y < e->height; y++) {
+            for(int x = 0; x < e->width; x++) {
+                same_base = same_base && has_ink(image, e->offset_x + x, e->offset_y + y) == has_ink(e_mask, x, y);
+            }
+        }
+        for(int y = 0; y < e->offset_y; y++) {
+            for(int x = 0; x < e_acute->width; x++) {
+                mark_above = mark_above || has_ink(image, x, y);
+            }
+        }
+        check(same_base && mark_above, "composed glyph is the base letter with a mark above");
+    }
+
+    const struct glyph* box = glyph_cache_get(0x3042, &image);
+    check(box != NULL && box->width == 16 && box->height == 16 && box->advance == 18, "wide .hex glyph size");
+    if(box != NULL) {
+        // the outline from the bitmap: full rows at the top and bottom, only the ends in between
+        bool ok = true;
+        for(int x = 0; x < 16; x++) {
+            ok = ok && !has_ink(image, x, 0) && has_ink(image, x, 1) && has_ink(image, x, 14) && !has_ink(image, x, 15);
+            ok = ok && has_ink(image, x, 7) == (x == 0 || x == 15);
+        }
+        check(ok, "wide .hex glyph bitmap");
+    }
+    const struct glyph* narrow = glyph_cache_get(0xA9, &image);
+    check(narrow != NULL && narrow->width == 8 && narrow->advance == 10, "narrow .hex glyph size");
+
+    glyph_cache_get_stats(&stats);
+    long misses = stats.misses;
+    check(glyph_cache_get(0x4E00, &image) == NULL, "code point missing from the font");
+    check(glyph_cache_get(0x4E00, &image) == NULL, "code point missing from the font, again");
+    glyph_cache_get_stats(&stats);
+    check(stats.misses == misses + 1, "a missing glyph is remembered instead of searched for again");
+
+    check(glyph_cache_get(0xE9, &image) == e_acute, "hit returns the same glyph");
+}
+
+// U+3042 then U+30A2 then U+00A9 fill a budget that only holds two of them, touching a glyph keeps it
+static void check_eviction(void)
+{
+    Olivec_Mask image;
+    struct glyph_cache_stats stats;
+    glyph_cache_cleanup();
+    glyph_cache_init(64 * 1024, FONT_PATH);
+    glyph_cache_get(0x3042, &image);
+    glyph_cache_get(0x30A2, &image);
+    glyph_cache_get_stats(&stats);
+    size_t budget = stats.bytes;
+    glyph_cache_cleanup();
+    glyph_cache_init(budget, FONT_PATH);
+
+    glyph_cache_get(0x3042, &image);
+    glyph_cache_get(0x30A2, &image);
+    glyph_cache_get(0x3042, &image);
+    glyph_cache_get(0xA9, &image);
+    glyph_cache_get_stats(&stats);
+    check(stats.evictions == 1 && stats.entries == 2 && stats.bytes <= budget, "eviction keeps the cache in budget");
+    long misses = stats.misses;
+    glyph_cache_get(0x3042, &image);
+    glyph_cache_get_stats(&stats);
+    check(stats.misses == misses, "the recently used glyph survives");
+    glyph_cache_get(0x30A2, &image);
+    glyph_cache_get_stats(&stats);
+    check(stats.misses == misses + 1, "the least recently used glyph is the one evicted");
+}
+
+static void check_truncate(void)
+{
+    char buf[256];
+    check(glyph_atlas_text_width("ab") == 2 * ADVANCE, "atlas text width");
+    check(glyph_atlas_text_width("a\xE3\x81\x82") == ADVANCE + 18, "text width with a .hex glyph");
+
+    // 24 wide glyphs are 432 pixels, as many characters as 240 pixels of atlas glyphs hold
+    buf[0] = '\0';
+    for(int i = 0; i < 24; i++) {
+        strcat(buf, "\xE3\x81\x82");
+    }
+    glyph_atlas_truncate(buf, 240);
+    check(strlen(buf) == 13 * 3 && glyph_atlas_text_width(buf) == 13 * 18, "wide glyphs cut to the width");
+
+    strcpy(buf, "abcdefghij");
+    glyph_atlas_truncate(buf, 5 * ADVANCE);
+    check(strcmp(buf, "abcde") == 0, "a glyph that fits exactly is kept");
+    strcpy(buf, "ab\xC3\xA9\xE3\x81\x82");
+    glyph_atlas_truncate(buf, 3 * ADVANCE + 17);
+    check(strcmp(buf, "ab\xC3\xA9") == 0, "cut before the glyph that doesn't fit, never inside it");
+    strcpy(buf, "ab");
+    glyph_atlas_truncate(buf, 240);
+    check(strcmp(buf, "ab") == 0, "text that fits is unchanged");
+}
+
+// every line of the shipped font is found by the binary search with the size its bitmap has, so the file is sorted and
+// well formed. Accented Latin letters the cache builds from the atlas come back composed instead
+static void check_shipped_font(void)
+{
+    FILE* file = fopen(SHIPPED_FONT_PATH, "r");
+    check(file != NULL, "the shipped font is there (run from the directory holding assets/)");
+    if(file == NULL) {
+        return;
+    }
+    glyph_cache_cleanup();
+    check(glyph_cache_init(64 * 1024, SHIPPED_FONT_PATH) == 0, "glyph cache init with the shipped font");
+
+    char line[128];
+    int lines = 0;
+    int found = 0;
+    int composed = 0;
+    while(fgets(line, sizeof(line), file) != NULL) {
+        char* colon = strchr(line, ':');
+        if(colon == NULL) {
+            continue;
+        }
+        lines++;
+        uint32_t code_point = strtoul(line, NULL, 16);
+        int width = (int)strcspn(colon + 1, "\n") * 4 / 16;
+        Olivec_Mask image;
+        const struct glyph* glyph = glyph_cache_get(code_point, &image);
+        if(glyph != NULL && glyph->height != 16) {
+            composed++;
+        } else if(glyph != NULL && glyph->width == width) {
+            found++;
+        }
+    }
+    fclose(file);
+    check(lines > 10000 && found + composed == lines, "every glyph in the shipped font");
+
+    // a letter from each script the font is there for, all drawn with some ink
+    static const uint32_t SAMPLES[] = {0x03A9, 0x0416, 0x05D0, 0x20AC, 0x2665, 0x1EA1, 0xD55C, 0xAC00};
+    bool ink = true;
+    for(size_t i = 0; i < sizeof(SAMPLES) / sizeof(SAMPLES[0]); i++) {
+        Olivec_Mask image;
+        const struct glyph* glyph = glyph_cache_get(SAMPLES[i], &image);
+        bool any = false;
+        for(int y = 0; glyph != NULL && y < glyph->height; y++) {
+            for(int x = 0; x < glyph->width; x++) {
+                any = any || has_ink(image, glyph->atlas_x + x, glyph->atlas_y + y);
+            }
+        }
+        ink = ink && any;
+    }
+    check(ink, "Greek, Cyrillic, Hebrew, symbols, Vietnamese and Hangul from the shipped font");
+    printf("%s: %d glyphs, %d of them composed from the atlas instead\n", SHIPPED_FONT_PATH, lines, composed);
+}
+
+static void time_lookups(int repetitions)
+{
+    Olivec_Mask image;
+    glyph_cache_cleanup();
+    glyph_cache_init(64 * 1024, FONT_PATH);
+    long long start = time_us();
+    for(int i = 0; i < repetitions; i++) {
+        glyph_cache_get(0xE9 + i % 4, &image);
+    }
+    double hit_ns = (time_us() - start) * 1000.0 / repetitions;
+
+    const char* label = "By: Caf\xC3\xA9 Tacvba \xE3\x81\x82\xE3\x82\xA2";
+    start = time_us();
+    long width = 0;
+    for(int i = 0; i < repetitions; i++) {
+        width += glyph_atlas_text_width(label);
+    }
+    double width_ns = (time_us() - start) * 1000.0 / repetitions;
+
+    // every lookup of a code point the cache dropped composes or searches the font again
+    glyph_cache_cleanup();
+    glyph_cache_init(1, FONT_PATH);
+    static const uint32_t CYCLE[] = {0xE9, 0x3042, 0xA9, 0x4E00};
+    start = time_us();
+    for(int i = 0; i < repetitions; i++) {
+        glyph_cache_get(CYCLE[i % 4], &image);
+    }
+    double miss_ns = (time_us() - start) * 1000.0 / repetitions;
+
+    printf("\nglyph cache hit       %8.1f ns\n", hit_ns);
+    printf("glyph cache miss      %8.1f ns\n", miss_ns);
+    printf("label width           %8.1f ns (%ld px)\n", width_ns, width / repetitions);
+}
+
+int main(int argc, char* argv[])
+{
+    int repetitions = argc > 1 ? atoi(argv[1]) : 100000;
+    if(repetitions <= 0) {
+        fprintf(stderr, "usage: %s [repetitions]\n", argv[0]);
+        return 2;
+    }
+
+    check_utf8();
+    if(init_atlas() != 0 || write_font() != 0 || glyph_cache_init(64 * 1024, FONT_PATH) != 0) {
+        fprintf(stderr, "failed to set up the atlas and the font\n");
+        return 1;
+    }
+    check_glyph_cache();
+    check_truncate();
+    check_eviction();
+    check_shipped_font();
+    time_lookups(repetitions);
+
+    glyph_cache_cleanup();
+    glyph_atlas_cleanup();
+    unlink(FONT_PATH);
+
+    printf("\n%s, %d checks failed\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
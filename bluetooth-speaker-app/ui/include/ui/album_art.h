@@ -0,0 +1,61 @@
+// Album art decoded and scaled on a worker thread and cached by key, which can be a track id or an AVRCP image handle.
+// Requests return straight away and album_art_get never waits for a decode, it just returns NULL until the art is
+// ready, so the UI thread keeps its frame rate while a large JPEG is being decoded. Art is reference counted like
+// text_cache strips and only unreferenced art is evicted.
+// Request and get from any thread, the listener is called from the worker
+#ifndef _ALBUM_ART_H_
+#define _ALBUM_ART_H_
+
+#include "hal/olive.h"
+#include "ui/lru.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct album_art {
+    // size x size, centre cropped from the source. NULL if the source couldn't be decoded. Shared, don't draw into it
+    Olivec_Canvas16* image;
+
+    // the rest is the cache's bookkeeping
+    uint32_t hash;
+    char* key;
+    int refs;
+    struct lru_node lru;
+};
+
+struct album_art_stats {
+    long decoded;
+    long failed;
+    long hits;
+    // album_art_get calls for art that wasn't ready
+    long misses;
+    long evictions;
+    // requests dropped because the queue was full
+    long dropped;
+    int entries;
+    // time the worker spent on the last decode and scale
+    long last_decode_us;
+};
+
+// decode art to size x size pixels and cache at most max_entries of them. Starts the worker. Returns 0 if successful
+int album_art_init(int size, int max_entries);
+
+// called from the worker every time new art is ready, pass frame_pacer_wake to redraw when it arrives
+void album_art_set_ready_listener(void (*listener)(void));
+
+// queue a JPEG/PNG/BMP file or an in memory copy of one to be decoded as key. The data is copied. Does nothing if key
+// is already cached or queued. If the queue is full the oldest request is dropped, it's the least likely to be on
+// screen
+void album_art_request_file(const char* key, const char* path);
+void album_art_request_memory(const char* key, const void* data, size_t size);
+
+// the art for key, or NULL if it hasn't been requested or isn't decoded yet. Holds a reference until
+// album_art_release. The art's image is NULL if decoding failed
+struct album_art* album_art_get(const char* key);
+void album_art_release(struct album_art* art);
+
+void album_art_get_stats(struct album_art_stats* stats);
+
+// stops the worker, every art has to be released first
+void album_art_cleanup(void);
+
+#endif
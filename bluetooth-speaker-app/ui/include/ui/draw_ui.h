@@ -4,8 +4,15 @@
 
 #include "hal/olive.h"
 
-Olivec_Canvas* draw_ui_text(char* str);
+// render str in the OLIVEC_RGBA colour into a new image, NULL if out of memory. Prefer drawing straight into the
+// destination with draw_ui_text_centered16
+Olivec_Canvas* draw_ui_text(const char* str, uint32_t colour);
+// draw str centered horizontally at y without allocating anything, returns the x it was drawn at
+int draw_ui_text_centered16(Olivec_Canvas16 canvas, const char* str, int y, uint32_t colour);
+// a new image of the bar, NULL if out of memory
 Olivec_Canvas* draw_ui_progress_bar(int width, int height, float progress, uint32_t primary_colour);
+// sprites are premultiplied like everything from image_loader_load and draw_ui_text
 int draw_ui_blend_centered(Olivec_Canvas canvas, Olivec_Canvas sprite, int y);
+int draw_ui_blend_centered16(Olivec_Canvas16 canvas, Olivec_Canvas sprite, int y);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+// Text drawing from one packed atlas of the character images. Glyphs are kept trimmed to their visible pixels as 8 bit
+// coverage, a quarter of the RGBA images they come from, and tinted with the text colour as a string is blended glyph
+// by glyph straight from the atlas into the destination canvas. Strings are UTF-8, code points without an image in
+// the atlas come from the glyph cache when it's initialized
+#ifndef _GLYPH_ATLAS_H
+#define _GLYPH_ATLAS_H
+
+#include "hal/olive.h"
+
+#define GLYPH_ATLAS_NUM_CHARS 256
+
+struct glyph {
+    // visible pixels of the glyph in the atlas, width and height are 0 for blank glyphs like space
+    int atlas_x;
+    int atlas_y;
+    int width;
+    int height;
+    // where those pixels go relative to the pen, which is the top left corner of the character cell
+    int offset_x;
+    int offset_y;
+    // how far the pen moves right after this glyph
+    int advance;
+};
+
+// Pack images, indexed by character, into the atlas. Only their alpha is kept, the ink colour is ignored. Characters
+// without an image use the glyph of character 0. Every glyph advances the pen by advance pixels, lines are
+// line_height tall. Returns 0 if successful
+int glyph_atlas_init(Olivec_Canvas* const images[GLYPH_ATLAS_NUM_CHARS], int advance, int line_height);
+
+// the atlas glyph of a character that has an image, or the fallback
+const struct glyph* glyph_atlas_get(char c);
+// the coverage of that glyph, glyph->width by glyph->height
+Olivec_Mask glyph_atlas_get_mask(char c);
+
+// width of str in pixels, nothing is drawn or allocated
+int glyph_atlas_text_width(const char* str);
+// cut str after the characters that fit in max_width pixels, never in the middle of one
+void glyph_atlas_truncate(char* str, int max_width);
+int glyph_atlas_line_height(void);
+
+// blend str in the OLIVEC_RGBA colour into canvas with the top left corner of the text at (x, y), anything outside
+// canvas is clipped. The colour's alpha fades the whole string
+void glyph_atlas_draw16(Olivec_Canvas16 canvas, int x, int y, const char* str, uint32_t colour);
+// copy the glyphs of str, coverage as alpha, into canvas instead of blending them. For building text images that get
+// blended later, so the glyph edges are only blended once. Glyphs don't overlap, so nothing is lost
+void glyph_atlas_copy16(Olivec_Canvas16 canvas, int x, int y, const char* str, uint32_t colour);
+// same as glyph_atlas_draw16 for a premultiplied RGBA canvas
+void glyph_atlas_draw(Olivec_Canvas canvas, int x, int y, const char* str, uint32_t colour);
+
+void glyph_atlas_cleanup(void);
+
+#endif
@@ -0,0 +1,34 @@
+// Glyphs for code points the glyph atlas doesn't have, rasterized the first time they are drawn and kept in an LRU
+// cache under a fixed memory budget. Accented Latin letters are built from the atlas glyph of the base letter plus a
+// mark, anything else comes from an optional bitmap font in the GNU Unifont .hex format. The font file is mapped, not
+// loaded, and looked up with a binary search, so its size costs nothing until a glyph from it is shown
+#ifndef _GLYPH_CACHE_H
+#define _GLYPH_CACHE_H
+
+#include "hal/olive.h"
+#include "ui/glyph_atlas.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct glyph_cache_stats {
+    long hits;
+    long misses;
+    long evictions;
+    int entries;
+    size_t bytes;
+};
+
+// Needs glyph_atlas_init() first. Cached glyphs are dropped least recently used first once they take more than
+// budget_bytes. hex_font_path can be NULL or a file that doesn't exist, then only accented Latin letters are
+// available. Returns 0 if successful
+int glyph_cache_init(size_t budget_bytes, const char* hex_font_path);
+
+// The glyph for code_point with its coverage in *image at glyph->atlas_x, atlas_y, or NULL if there is no glyph for it
+// or the cache isn't initialized. Valid until the next glyph_cache_get
+const struct glyph* glyph_cache_get(uint32_t code_point, Olivec_Mask* image);
+
+void glyph_cache_get_stats(struct glyph_cache_stats* stats);
+
+void glyph_cache_cleanup(void);
+
+#endif
@@ -2,18 +2,20 @@
 #ifndef _LOAD_IMAGE_ASSETS_H
 #define _LOAD_IMAGE_ASSETS_H
 
+#include "hal/olive.h"
+#include "hal/rle_sprite.h"
+
 #define LOAD_IMAGE_ASSETS_CHAR_WIDTH 10
 #define LOAD_IMAGE_ASSETS_CHAR_HEIGHT 20
 
 int load_image_assets_init();
-// returns NULL if no image for a character exists
-Olivec_Canvas* load_image_assets_get_char(char c);
-Olivec_Canvas* load_image_assets_get_volume_icon();
-Olivec_Canvas* load_image_assets_get_shuffle_icon();
-Olivec_Canvas* load_image_assets_get_repeat_icon();
-Olivec_Canvas* load_image_assets_get_replay_icon();
-Olivec_Canvas* load_image_assets_get_play_icon();
-Olivec_Canvas* load_image_assets_get_pause_icon();
+// the icons are run length encoded for blending into 16 bit canvases with rle_sprite_blit
+const struct rle_sprite* load_image_assets_get_volume_icon();
+const struct rle_sprite* load_image_assets_get_shuffle_icon();
+const struct rle_sprite* load_image_assets_get_repeat_icon();
+const struct rle_sprite* load_image_assets_get_replay_icon();
+const struct rle_sprite* load_image_assets_get_play_icon();
+const struct rle_sprite* load_image_assets_get_pause_icon();
 void load_image_assets_cleanup();
 int draw_ui_blend_centered(Olivec_Canvas canvas, Olivec_Canvas sprite, int y);
 
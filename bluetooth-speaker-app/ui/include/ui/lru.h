@@ -0,0 +1,36 @@
+// The bookkeeping the UI caches share: an intrusive most recently used list and the hash they key strings on. An
+// entry embeds a struct lru_node and LRU_ENTRY gets back from the node to the entry, so nothing is allocated here
+#ifndef _LRU_H
+#define _LRU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct lru_node {
+    struct lru_node* newer;
+    struct lru_node* older;
+};
+
+struct lru_list {
+    struct lru_node* newest;
+    struct lru_node* oldest;
+};
+
+// the entry of type that holds node as member, NULL for a NULL node
+#define LRU_ENTRY(node, type, member) ((node) != NULL ? (type*)((char*)(node) - offsetof(type, member)) : NULL)
+
+void lru_init(struct lru_list* list);
+
+// add node as the most recently used
+void lru_push_newest(struct lru_list* list, struct lru_node* node);
+
+// take node out of the list
+void lru_unlink(struct lru_list* list, struct lru_node* node);
+
+// make node, which is in the list, the most recently used
+void lru_touch(struct lru_list* list, struct lru_node* node);
+
+// FNV-1a, cheap and spreads short strings well enough to skip most strcmp calls
+uint32_t lru_hash(const char* text);
+
+#endif
@@ -0,0 +1,41 @@
+// Scrolls text that is too wide for its box. The text is rendered once into a strip and each frame blits a window of
+// it, so a scroll step only changes the pixels of one text band instead of needing a redraw of the text
+#ifndef _MARQUEE_H
+#define _MARQUEE_H
+
+#include "hal/olive.h"
+#include "ui/text_cache.h"
+#include <stdbool.h>
+
+struct marquee {
+    // visible width in pixels
+    int width;
+    // the text from the text cache, scrolling draws a window of it and wraps around to its start after a gap
+    struct text_strip* strip;
+    // width of the text plus the gap, one full scroll
+    int period;
+    long start_ms;
+    // how far the text was scrolled the last time it was drawn
+    int drawn_offset;
+};
+
+// create a heap allocated marquee that shows at most width pixels of text. Needs text_cache_init() first
+struct marquee* marquee_create(int width);
+
+// set the text to show, nothing changes if text is the same as the last call
+void marquee_set_text(struct marquee* marquee, const char* text);
+
+// draw the text in the box whose left edge is at x, centered if it fits. Text that doesn't fit holds still for a moment
+// then scrolls. now_ms is on the time_mono_ms clock, like every other time here
+// Returns true if the text is scrolling and needs to be drawn again next frame
+bool marquee_draw_at(struct marquee* marquee, Olivec_Canvas16 canvas, int x, int y, long now_ms);
+
+// true if the text has scrolled since it was last drawn, false while it holds still at the start
+bool marquee_needs_redraw(const struct marquee* marquee, long now_ms);
+
+// ms until the text starts moving, 0 while it scrolls and -1 if it never will (it fits, or hasn't been drawn yet)
+long marquee_ms_until_change(const struct marquee* marquee, long now_ms);
+
+void marquee_free(struct marquee** marquee);
+
+#endif
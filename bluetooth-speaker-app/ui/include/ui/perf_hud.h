@@ -0,0 +1,46 @@
+// Performance overlay for diagnosing units in the field. Shows the frame rate, the 50th and 95th percentile time in
+// ms of each stage of the render loop over the last 64 frames, bytes sent per frame and dropped frames in a small box
+// in the corner. Its text only changes twice a second, so drawing it adds one small damage rect to a few frames.
+// Timing only runs while it's shown. Use it from the UI thread, except perf_hud_toggle
+#ifndef _PERF_HUD_H_
+#define _PERF_HUD_H_
+
+#include "ui/widget.h"
+#include <stdbool.h>
+
+enum perf_hud_stage {
+    // reading the app model
+    PERF_HUD_MODEL,
+    // setting widgets and rendering the tree
+    PERF_HUD_COMPOSE,
+    // copying the damaged areas into a frame buffer in the panel's format
+    PERF_HUD_CONVERT,
+    // sending the frame over SPI, timed on the display thread
+    PERF_HUD_SEND,
+    PERF_HUD_NUM_STAGES,
+};
+
+// add the hidden overlay to tree with its top left corner at (x, y), add it last so it's on top.
+// Returns 0 if successful
+int perf_hud_init(struct widget_tree* tree, int x, int y);
+
+// show or hide the overlay from the next perf_hud_update. Safe to call from any thread, e.g. an input listener
+void perf_hud_toggle(void);
+
+// start timing a stage
+void perf_hud_mark(void);
+// the stage that started at the last mark is done, the next one starts now
+void perf_hud_stage_done(enum perf_hud_stage stage);
+
+// apply perf_hud_toggle and refresh the text when it's due, call before rendering the tree. now_ms is time_mono_ms
+void perf_hud_update(long now_ms);
+
+// call at the end of every loop, submitted is true if a frame was sent to the display
+void perf_hud_frame_done(bool submitted);
+
+// how long until the text should be refreshed, so an idle loop can wake up for it. -1 if hidden
+long perf_hud_ms_until_refresh(long now_ms);
+
+void perf_hud_cleanup(void);
+
+#endif
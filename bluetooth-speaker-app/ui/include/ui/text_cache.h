@@ -0,0 +1,53 @@
+// Bounded LRU cache of rendered text strips keyed by (text, font, colour), so a string is rasterized once and shared
+// by every label and screen showing it. Strips are reference counted, only unreferenced strips are evicted.
+// Not thread safe, use it from the UI thread
+#ifndef _TEXT_CACHE_H
+#define _TEXT_CACHE_H
+
+#include "hal/olive.h"
+#include "ui/lru.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// glyph sets strips can be rendered in, the character images are the only one so far
+enum text_font {
+    TEXT_FONT_DEFAULT,
+};
+
+struct text_strip {
+    // the text in colour on a transparent background, one line tall. Shared, don't draw into it
+    Olivec_Canvas16* image;
+
+    // the rest is the cache's bookkeeping
+    uint32_t hash;
+    char* text;
+    enum text_font font;
+    uint32_t colour;
+    int refs;
+    struct lru_node lru;
+};
+
+struct text_cache_stats {
+    long hits;
+    long misses;
+    long evictions;
+    int entries;
+    // pixel and alpha bytes held by the cached strips
+    size_t bytes;
+};
+
+// cache at most max_entries strips, more are only kept while they are all referenced. Needs load_image_assets_init()
+// first. Returns 0 if successful
+int text_cache_init(int max_entries);
+
+// a strip of text, rendered if it isn't cached. Holds a reference until text_cache_release. NULL if out of memory,
+// callers draw nothing then
+struct text_strip* text_cache_get(const char* text, enum text_font font, uint32_t colour);
+void text_cache_release(struct text_strip* strip);
+
+void text_cache_get_stats(struct text_cache_stats* stats);
+
+// every strip has to be released first
+void text_cache_cleanup(void);
+
+#endif
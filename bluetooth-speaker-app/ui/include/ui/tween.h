@@ -0,0 +1,40 @@
+// Tweens a float from one value to another over a stretch of monotonic time (time_mono_ms). The value is a function of
+// the time it's sampled at, not of how many frames have run, so animations take the same time at any frame rate
+#ifndef _TWEEN_H
+#define _TWEEN_H
+
+#include <stdbool.h>
+
+enum tween_ease {
+    TWEEN_LINEAR,
+    // cubic curves, slow start, slow end or both
+    TWEEN_EASE_IN,
+    TWEEN_EASE_OUT,
+    TWEEN_EASE_IN_OUT,
+};
+
+struct tween {
+    float from;
+    float to;
+    long start_ms;
+    long duration_ms;
+    enum tween_ease ease;
+    // the value at the last tween_update
+    float value;
+    bool running;
+};
+
+// maps t from 0.0 to 1.0 onto the curve, also from 0.0 to 1.0
+float tween_ease(enum tween_ease ease, float t);
+
+// start going from from to to at now_ms. Pass tween->value as from to carry on smoothly from wherever it is
+void tween_start(struct tween* tween, float from, float to, long now_ms, long duration_ms, enum tween_ease ease);
+
+// jump to value and stop
+void tween_set(struct tween* tween, float value);
+
+// sample the tween at now_ms into tween->value. The update that reaches to also stops the tween, so returns true
+// for every update that changed the value including the last one
+bool tween_update(struct tween* tween, long now_ms);
+
+#endif
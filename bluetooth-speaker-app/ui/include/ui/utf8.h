@@ -0,0 +1,17 @@
+// Decoding of UTF-8 text, track metadata from the phone comes in as UTF-8
+#ifndef _UTF8_H
+#define _UTF8_H
+
+#include <stdint.h>
+
+// stands in for bytes that aren't valid UTF-8
+#define UTF8_REPLACEMENT 0xFFFD
+
+// returns the code point *str starts with and moves *str past it, or 0 without moving at the end of the string.
+// Invalid or cut off sequences come back as UTF8_REPLACEMENT one byte at a time
+uint32_t utf8_next(const char** str);
+
+// cut str after max_chars code points, never in the middle of one
+void utf8_truncate(char* str, int max_chars);
+
+#endif
@@ -0,0 +1,122 @@
+// Retained widgets for a screen. Each widget remembers what it drew and where, setters only mark a widget dirty when
+// its input actually changes, and widget_tree_render redraws just the areas dirty widgets covered or now cover.
+// Widgets sit on layers. Cached layers are rendered once, together with the background, into a base canvas that
+// damaged areas are restored from, dynamic layers are drawn over it with their own opacity and offset.
+#ifndef _WIDGET_H
+#define _WIDGET_H
+
+#include "hal/olive.h"
+#include "hal/draw_stuff.h"
+#include "hal/rle_sprite.h"
+#include "ui/text_cache.h"
+#include "ui/tween.h"
+#include <stdbool.h>
+
+// pass as x to centre a widget horizontally on the screen
+#define WIDGET_CENTER_X (-1)
+
+// damage rects widget_tree_render reports at most, more than this get merged
+#define WIDGET_MAX_DAMAGE 8
+
+enum widget_type {
+    WIDGET_LABEL,
+    WIDGET_MARQUEE,
+    WIDGET_ICON,
+    WIDGET_PROGRESS_BAR,
+    WIDGET_OVERLAY,
+};
+
+struct marquee;
+struct widget_layer;
+
+struct widget {
+    enum widget_type type;
+    struct widget_layer* layer;
+    int x;
+    int y;
+    bool visible;
+    bool dirty;
+    // area drawn last time, empty if nothing was drawn
+    struct draw_stuff_rect drawn;
+    union {
+        struct {
+            // rendered text from the text cache, which also keeps the text itself. NULL for empty text
+            struct text_strip* strip;
+        } label;
+        struct {
+            struct marquee* marquee;
+            int width;
+            int height;
+        } marquee;
+        struct {
+            const struct rle_sprite* image;
+        } icon;
+        struct {
+            int width;
+            int height;
+            uint32_t colour;
+            // filled pixels, so progress changes smaller than a pixel don't cause a redraw
+            int filled;
+        } bar;
+        struct {
+            int width;
+            int height;
+            // draw into canvas with the overlay's top left corner at (x, y)
+            void (*draw)(Olivec_Canvas16 canvas, int x, int y, void* data);
+            void* data;
+        } overlay;
+    };
+};
+
+struct widget_tree;
+
+// create a heap allocated tree for a width x height screen filled with background. NULL if out of memory
+struct widget_tree* widget_tree_create(int width, int height, uint32_t background);
+void widget_tree_free(struct widget_tree** tree);
+
+// Start a new layer on top of the others, widgets added after this go on it. Cached layers are for things that don't
+// change (icons, chrome), changing anything on one renders the base canvas again. They have to come before any
+// dynamic layer, and widgets added before the first widget_tree_add_layer go on a dynamic layer. The tree owns it
+struct widget_layer* widget_tree_add_layer(struct widget_tree* tree, bool cached);
+// opacity of the whole layer from 0 to 255, what's under it shows through
+void widget_layer_set_opacity(struct widget_layer* layer, uint8_t opacity);
+// move everything on the layer by (x, y) pixels, e.g. to slide a screen in
+void widget_layer_set_offset(struct widget_layer* layer, int x, int y);
+
+// widgets are drawn in the order they are added, later ones on top. The tree owns them
+struct widget* widget_tree_add_label(struct widget_tree* tree, int x, int y);
+// a label that scrolls when its text is wider than width
+struct widget* widget_tree_add_marquee(struct widget_tree* tree, int y, int width);
+// icon isn't copied and has to outlive the widget
+struct widget* widget_tree_add_icon(struct widget_tree* tree, int x, int y, const struct rle_sprite* icon);
+struct widget* widget_tree_add_progress_bar(struct widget_tree* tree, int x, int y, int width, int height, uint32_t colour);
+// custom drawing inside a fixed box, call widget_mark_dirty whenever it should be drawn again
+struct widget* widget_tree_add_overlay(struct widget_tree* tree, int x, int y, int width, int height,
+                                       void (*draw)(Olivec_Canvas16 canvas, int x, int y, void* data), void* data);
+
+// An animation on the tree. Start it with tween_start, every widget_tree_render while it runs samples it and calls
+// apply(target, value), or just redraws target if apply is NULL (e.g. an overlay that reads the tween's value when it
+// draws). Only target's area is redrawn, and the tree counts as animating until the tween ends. The tree owns it
+struct tween* widget_tree_add_tween(struct widget_tree* tree, struct widget* target,
+                                    void (*apply)(struct widget* target, float value));
+
+// for labels and marquees, nothing is rendered again if text is the same as before
+void widget_label_set_text(struct widget* widget, const char* text);
+void widget_icon_set(struct widget* widget, const struct rle_sprite* icon);
+// progress from 0.0 to 1.0
+void widget_progress_bar_set(struct widget* widget, float progress);
+void widget_set_visible(struct widget* widget, bool visible);
+void widget_mark_dirty(struct widget* widget);
+
+// Redraw dirty widgets into the tree's screen. Writes the areas that changed to damage and returns how many,
+// 0 means the screen is the same as after the last call. now_ms is on the time_mono_ms clock, for tweens and marquees
+int widget_tree_render(struct widget_tree* tree, long now_ms, struct draw_stuff_rect damage[WIDGET_MAX_DAMAGE]);
+
+// ms until a widget changes on its own, 0 while a marquee scrolls or a tween runs and -1 if nothing will. A marquee
+// holding still before it scrolls counts the time until it starts moving
+long widget_tree_ms_until_change(const struct widget_tree* tree, long now_ms);
+
+// the screen the tree draws into
+Olivec_Canvas16* widget_tree_screen(struct widget_tree* tree);
+
+#endif
@@ -0,0 +1,331 @@
+#include "ui/album_art.h"
+#include "hal/image_loader.h"
+#include "hal/image_scale.h"
+#include "hal/canvas_pool.h"
+#include "hal/stb_image.h"
+#include "hal/time_util.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// pending decodes, a skip through a playlist only needs the last few
+#define MAX_JOBS 4
+
+struct job {
+    char* key;
+    uint32_t hash;
+    // either a file to load or a copy of the encoded image
+    char* path;
+    void* data;
+    size_t size;
+};
+
+static bool initialized = false;
+static int art_size = 0;
+static int capacity = 0;
+static void (*ready_listener)(void) = NULL;
+
+// guards everything below, never held while decoding
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_ready = PTHREAD_COND_INITIALIZER;
+static pthread_t worker;
+static bool stopping = false;
+static struct job jobs[MAX_JOBS];
+static int first_job = 0;
+static int num_jobs = 0;
+// the key being decoded right now, so it isn't queued again meanwhile
+static struct job* decoding = NULL;
+// most recently used first
+static struct lru_list cache;
+static struct album_art_stats stats;
+
+static void free_art(struct album_art* art)
+{
+    stats.entries--;
+    if(art->image != NULL) {
+        image_loader_image16_free(&art->image);
+    }
+    canvas_pool_free(art);
+}
+
+// drop unreferenced art, least recently used first, until the cache is back within capacity. Call with the lock held
+static void evict(void)
+{
+    struct lru_node* node = cache.oldest;
+    while(stats.entries > capacity && node != NULL) {
+        struct lru_node* newer = node->newer;
+        struct album_art* art = LRU_ENTRY(node, struct album_art, lru);
+        if(art->refs == 0) {
+            lru_unlink(&cache, node);
+            free_art(art);
+            stats.evictions++;
+        }
+        node = newer;
+    }
+}
+
+// call with the lock held
+static struct album_art* find(const char* key, uint32_t hash)
+{
+    for(struct lru_node* node = cache.newest; node != NULL; node = node->older) {
+        struct album_art* art = LRU_ENTRY(node, struct album_art, lru);
+        if(art->hash == hash && strcmp(art->key, key) == 0) {
+            return art;
+        }
+    }
+    return NULL;
+}
+
+static struct job* queued_job(int i)
+{
+    return &jobs[(first_job + i) % MAX_JOBS];
+}
+
+static void free_job(struct job* job)
+{
+    free(job->key);
+    free(job->path);
+    free(job->data);
+    memset(job, 0, sizeof(*job));
+}
+
+// call with the lock held
+static bool is_pending(const char* key, uint32_t hash)
+{
+    if(decoding != NULL && decoding->hash == hash && strcmp(decoding->key, key) == 0) {
+        return true;
+    }
+    for(int i = 0; i < num_jobs; i++) {
+        struct job* job = queued_job(i);
+        if(job->hash == hash && strcmp(job->key, key) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// decode the job and scale the middle square of it to art_size, NULL if it couldn't be decoded
+static Olivec_Canvas16* decode(const struct job* job)
+{
+    int width, height, n_channels;
+    stbi_uc* rgb;
+    if(job->path != NULL) {
+        rgb = stbi_load(job->path, &width, &height, &n_channels, 3);
+    } else {
+        rgb = stbi_load_from_memory(job->data, (int)job->size, &width, &height, &n_channels, 3);
+    }
+    if(rgb == NULL) {
+        fprintf(stderr, "album_art: failed to decode %s: %s\n", job->path != NULL ? job->path : job->key,
+                stbi_failure_reason());
+        return NULL;
+    }
+
+    int side = width < height ? width : height;
+    const uint8_t* middle = rgb + (size_t)((height - side) / 2) * width * 3 + (size_t)((width - side) / 2) * 3;
+    Olivec_Canvas16* image = image_loader_image16_create(art_size, art_size, false);
+    if(image != NULL) {
+        image_scale_rgb_to16(middle, side, side, width * 3, *image);
+    }
+    stbi_image_free(rgb);
+    return image;
+}
+
+static void* worker_loop(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    while(true) {
+        while(num_jobs == 0 && !stopping) {
+            pthread_cond_wait(&job_ready, &lock);
+        }
+        if(stopping) {
+            break;
+        }
+        struct job job = *queued_job(0);
+        first_job = (first_job + 1) % MAX_JOBS;
+        num_jobs--;
+        decoding = &job;
+        pthread_mutex_unlock(&lock);
+
+        long long start = time_us();
+        Olivec_Canvas16* image = decode(&job);
+        long long elapsed = time_us() - start;
+
+        // the key is kept right after the struct, like text_cache
+        size_t key_size = strlen(job.key) + 1;
+        struct album_art* art = canvas_pool_alloc(sizeof(*art) + key_size);
+
+        pthread_mutex_lock(&lock);
+        decoding = NULL;
+        if(art == NULL) {
+            if(image != NULL) {
+                image_loader_image16_free(&image);
+            }
+        } else {
+            memset(art, 0, sizeof(*art));
+            art->image = image;
+            art->hash = job.hash;
+            art->key = (char*)(art + 1);
+            memcpy(art->key, job.key, key_size);
+            lru_push_newest(&cache, &art->lru);
+            stats.entries++;
+            evict();
+        }
+        if(image != NULL) {
+            stats.decoded++;
+        } else {
+            stats.failed++;
+        }
+        stats.last_decode_us = (long)elapsed;
+        void (*listener)(void) = ready_listener;
+        pthread_mutex_unlock(&lock);
+
+        free_job(&job);
+        if(listener != NULL) {
+            listener();
+        }
+        pthread_mutex_lock(&lock);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+int album_art_init(int size, int max_entries)
+{
+    assert(!initialized);
+    assert(size > 0);
+    assert(max_entries > 0);
+    art_size = size;
+    capacity = max_entries;
+    ready_listener = NULL;
+    stopping = false;
+    first_job = 0;
+    num_jobs = 0;
+    decoding = NULL;
+    lru_init(&cache);
+    memset(&stats, 0, sizeof(stats));
+    if(pthread_create(&worker, NULL, worker_loop, NULL) != 0) {
+        fprintf(stderr, "album_art: failed to start the decode thread\n");
+        return 1;
+    }
+    initialized = true;
+    return 0;
+}
+
+void album_art_set_ready_listener(void (*listener)(void))
+{
+    assert(initialized);
+    pthread_mutex_lock(&lock);
+    ready_listener = listener;
+    pthread_mutex_unlock(&lock);
+}
+
+// takes ownership of path and data
+static void request(const char* key, char* path, void* data, size_t size)
+{
+    assert(initialized);
+    uint32_t hash = lru_hash(key);
+    pthread_mutex_lock(&lock);
+    if(find(key, hash) != NULL || is_pending(key, hash)) {
+        pthread_mutex_unlock(&lock);
+        free(path);
+        free(data);
+        return;
+    }
+    if(num_jobs == MAX_JOBS) {
+        free_job(queued_job(0));
+        first_job = (first_job + 1) % MAX_JOBS;
+        num_jobs--;
+        stats.dropped++;
+    }
+    struct job* job = queued_job(num_jobs);
+    job->key = strdup(key);
+    job->hash = hash;
+    job->path = path;
+    job->data = data;
+    job->size = size;
+    num_jobs++;
+    pthread_cond_signal(&job_ready);
+    pthread_mutex_unlock(&lock);
+}
+
+void album_art_request_file(const char* key, const char* path)
+{
+    request(key, strdup(path), NULL, 0);
+}
+
+void album_art_request_memory(const char* key, const void* data, size_t size)
+{
+    void* copy = malloc(size);
+    if(copy == NULL) {
+        fprintf(stderr, "album_art: no memory for %zu bytes of %s\n", size, key);
+        return;
+    }
+    memcpy(copy, data, size);
+    request(key, NULL, copy, size);
+}
+
+struct album_art* album_art_get(const char* key)
+{
+    assert(initialized);
+    uint32_t hash = lru_hash(key);
+    pthread_mutex_lock(&lock);
+    struct album_art* art = find(key, hash);
+    if(art != NULL) {
+        stats.hits++;
+        art->refs++;
+        lru_touch(&cache, &art->lru);
+    } else {
+        stats.misses++;
+    }
+    pthread_mutex_unlock(&lock);
+    return art;
+}
+
+void album_art_release(struct album_art* art)
+{
+    assert(initialized);
+    pthread_mutex_lock(&lock);
+    assert(art->refs > 0);
+    art->refs--;
+    if(art->refs == 0) {
+        evict();
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void album_art_get_stats(struct album_art_stats* result)
+{
+    assert(initialized);
+    pthread_mutex_lock(&lock);
+    *result = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+void album_art_cleanup(void)
+{
+    assert(initialized);
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_signal(&job_ready);
+    pthread_mutex_unlock(&lock);
+    pthread_join(worker, NULL);
+
+    for(int i = 0; i < num_jobs; i++) {
+        free_job(queued_job(i));
+    }
+    num_jobs = 0;
+    while(cache.oldest != NULL) {
+        struct album_art* art = LRU_ENTRY(cache.oldest, struct album_art, lru);
+        if(art->refs != 0) {
+            fprintf(stderr, "album_art_cleanup: \"%s\" still has %d references\n", art->key, art->refs);
+        }
+        lru_unlink(&cache, &art->lru);
+        free_art(art);
+    }
+    initialized = false;
+}
@@ -1,27 +1,35 @@
 #include "hal/olive.h"
 #include "hal/image_loader.h"
-#include "ui/load_image_assets.h"
+#include "ui/glyph_atlas.h"
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 
-Olivec_Canvas* draw_ui_text(char* str)
+Olivec_Canvas* draw_ui_text(const char* str, uint32_t colour)
 {
-    
-    size_t str_len = strlen(str);
-    Olivec_Canvas* text_img = image_loader_image_create(LOAD_IMAGE_ASSETS_CHAR_WIDTH * str_len, LOAD_IMAGE_ASSETS_CHAR_HEIGHT);
-    olivec_fill(*text_img, OLIVEC_RGBA(0xFF, 0xFF, 0xFF, 0));
-    for(size_t i = 0; i < str_len; i++) {
-        Olivec_Canvas* char_img = load_image_assets_get_char(str[i]);
-        olivec_sprite_blend(*text_img, LOAD_IMAGE_ASSETS_CHAR_WIDTH * i, 0, char_img->width, char_img->height, *char_img);
+    Olivec_Canvas* text_img = image_loader_image_create(glyph_atlas_text_width(str), glyph_atlas_line_height());
+    if(text_img == NULL) {
+        return NULL;
     }
+    olivec_fill(*text_img, OLIVEC_RGBA(0, 0, 0, 0));
+    glyph_atlas_draw(*text_img, 0, 0, str, colour);
     return text_img;
 }
 
+int draw_ui_text_centered16(Olivec_Canvas16 canvas, const char* str, int y, uint32_t colour)
+{
+    int x = ((int)canvas.width - glyph_atlas_text_width(str)) / 2;
+    glyph_atlas_draw16(canvas, x, y, str, colour);
+    return x;
+}
+
 Olivec_Canvas* draw_ui_progress_bar(int width, int height, float progress, uint32_t primary_colour)
 {
     int progress_length = round(progress * width);
     Olivec_Canvas* bar_img = image_loader_image_create(width, height);
+    if(bar_img == NULL) {
+        return NULL;
+    }
     olivec_fill(*bar_img, OLIVEC_RGBA(0xD3, 0xD3, 0xD3, 0xFF));
     olivec_rect(*bar_img, 0, 0, progress_length, height, primary_colour);
     return bar_img;
@@ -30,6 +38,13 @@ Olivec_Canvas* draw_ui_progress_bar(int width, int height, float progress, uint3
 int draw_ui_blend_centered(Olivec_Canvas canvas, Olivec_Canvas sprite, int y)
 {
     int x = (canvas.width - sprite.width) / 2;
-    olivec_sprite_blend(canvas, x, y, sprite.width, sprite.height, sprite);
+    olivec_sprite_blend_premul(canvas, x, y, sprite.width, sprite.height, sprite);
     return x;
-}
\ No newline at end of file
+}
+
+int draw_ui_blend_centered16(Olivec_Canvas16 canvas, Olivec_Canvas sprite, int y)
+{
+    int x = (canvas.width - sprite.width) / 2;
+    olivec16_sprite_blend32_premul(canvas, x, y, sprite.width, sprite.height, sprite);
+    return x;
+}
@@ -0,0 +1,254 @@
+#include "ui/glyph_atlas.h"
+#include "ui/glyph_cache.h"
+#include "ui/utf8.h"
+#include "hal/canvas_pool.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// wide enough for a dozen trimmed glyphs per shelf, the height is whatever the glyphs need
+#define ATLAS_WIDTH 128
+
+static bool initialized = false;
+static struct glyph glyphs[GLYPH_ATLAS_NUM_CHARS];
+// characters that had an image, the others are copies of the fallback glyph
+static bool in_atlas[GLYPH_ATLAS_NUM_CHARS];
+// coverage only, the colour is picked when the text is drawn
+static Olivec_Mask atlas = {0};
+static int glyph_line_height = 0;
+
+// the smallest box holding the pixels of image that aren't fully transparent
+static void trim(Olivec_Canvas* image, struct glyph* glyph)
+{
+    int x1 = image->width;
+    int y1 = image->height;
+    int x2 = -1;
+    int y2 = -1;
+    for(size_t y = 0; y < image->height; y++) {
+        for(size_t x = 0; x < image->width; x++) {
+            if(OLIVEC_ALPHA(OLIVEC_PIXEL(*image, x, y)) == 0) {
+                continue;
+            }
+            x1 = (int)x < x1 ? (int)x : x1;
+            y1 = (int)y < y1 ? (int)y : y1;
+            x2 = (int)x > x2 ? (int)x : x2;
+            y2 = (int)y > y2 ? (int)y : y2;
+        }
+    }
+    if(x2 < 0) {
+        glyph->offset_x = 0;
+        glyph->offset_y = 0;
+        glyph->width = 0;
+        glyph->height = 0;
+        return;
+    }
+    glyph->offset_x = x1;
+    glyph->offset_y = y1;
+    glyph->width = x2 - x1 + 1;
+    glyph->height = y2 - y1 + 1;
+}
+
+static int compare_height(const void* a, const void* b)
+{
+    const struct glyph* ga = &glyphs[*(const int*)a];
+    const struct glyph* gb = &glyphs[*(const int*)b];
+    return gb->height - ga->height;
+}
+
+int glyph_atlas_init(Olivec_Canvas* const images[GLYPH_ATLAS_NUM_CHARS], int advance, int line_height)
+{
+    assert(!initialized);
+    if(images[0] == NULL) {
+        fprintf(stderr, "glyph_atlas_init: no glyph for character 0 to fall back to\n");
+        return 1;
+    }
+
+    int order[GLYPH_ATLAS_NUM_CHARS];
+    int num_glyphs = 0;
+    for(int c = 0; c < GLYPH_ATLAS_NUM_CHARS; c++) {
+        in_atlas[c] = false;
+        if(images[c] == NULL) {
+            continue;
+        }
+        in_atlas[c] = true;
+        trim(images[c], &glyphs[c]);
+        glyphs[c].advance = advance;
+        if(glyphs[c].width > ATLAS_WIDTH) {
+            fprintf(stderr, "glyph_atlas_init: glyph %d is wider than the atlas\n", c);
+            return 2;
+        }
+        order[num_glyphs++] = c;
+    }
+
+    // shelf packing, tallest first so each shelf wastes little height
+    qsort(order, num_glyphs, sizeof(order[0]), compare_height);
+    int x = 0;
+    int y = 0;
+    int shelf_height = 0;
+    for(int i = 0; i < num_glyphs; i++) {
+        struct glyph* glyph = &glyphs[order[i]];
+        if(x + glyph->width > ATLAS_WIDTH) {
+            x = 0;
+            y += shelf_height;
+            shelf_height = 0;
+        }
+        glyph->atlas_x = x;
+        glyph->atlas_y = y;
+        x += glyph->width;
+        shelf_height = glyph->height > shelf_height ? glyph->height : shelf_height;
+    }
+
+    int atlas_height = y + shelf_height;
+    uint8_t* coverage = canvas_pool_alloc(ATLAS_WIDTH * atlas_height);
+    if(coverage == NULL) {
+        fprintf(stderr, "glyph_atlas_init: failed to allocate the atlas\n");
+        return 3;
+    }
+    memset(coverage, 0, ATLAS_WIDTH * atlas_height);
+    atlas = olivec_mask(coverage, ATLAS_WIDTH, atlas_height, ATLAS_WIDTH);
+    for(int i = 0; i < num_glyphs; i++) {
+        int c = order[i];
+        struct glyph* glyph = &glyphs[c];
+        if(glyph->width == 0) {
+            continue;
+        }
+        Olivec_Canvas src = olivec_subcanvas(*images[c], glyph->offset_x, glyph->offset_y, glyph->width, glyph->height);
+        Olivec_Mask dst = olivec_mask_subcanvas(atlas, glyph->atlas_x, glyph->atlas_y, glyph->width, glyph->height);
+        olivec_mask_from_canvas(dst, src);
+    }
+
+    for(int c = 0; c < GLYPH_ATLAS_NUM_CHARS; c++) {
+        if(images[c] == NULL) {
+            glyphs[c] = glyphs[0];
+        }
+    }
+    glyph_line_height = line_height;
+    initialized = true;
+    return 0;
+}
+
+const struct glyph* glyph_atlas_get(char c)
+{
+    assert(initialized);
+    return &glyphs[(unsigned char)c];
+}
+
+Olivec_Mask glyph_atlas_get_mask(char c)
+{
+    assert(initialized);
+    const struct glyph* glyph = &glyphs[(unsigned char)c];
+    return olivec_mask_subcanvas(atlas, glyph->atlas_x, glyph->atlas_y, glyph->width, glyph->height);
+}
+
+// the glyph for code_point and the mask its coverage is in, the atlas or the glyph cache
+static const struct glyph* lookup(uint32_t code_point, Olivec_Mask* source)
+{
+    if(code_point < GLYPH_ATLAS_NUM_CHARS && in_atlas[code_point]) {
+        *source = atlas;
+        return &glyphs[code_point];
+    }
+    const struct glyph* glyph = glyph_cache_get(code_point, source);
+    if(glyph != NULL) {
+        return glyph;
+    }
+    *source = atlas;
+    return &glyphs[0];
+}
+
+int glyph_atlas_text_width(const char* str)
+{
+    assert(initialized);
+    int width = 0;
+    Olivec_Mask source;
+    const char* p = str;
+    for(uint32_t c = utf8_next(&p); c != 0; c = utf8_next(&p)) {
+        width += lookup(c, &source)->advance;
+    }
+    return width;
+}
+
+void glyph_atlas_truncate(char* str, int max_width)
+{
+    assert(initialized);
+    int width = 0;
+    Olivec_Mask source;
+    const char* p = str;
+    const char* fits = str;
+    for(uint32_t c = utf8_next(&p); c != 0; c = utf8_next(&p)) {
+        width += lookup(c, &source)->advance;
+        if(width > max_width) {
+            str[fits - str] = '\0';
+            return;
+        }
+        fits = p;
+    }
+}
+
+int glyph_atlas_line_height(void)
+{
+    assert(initialized);
+    return glyph_line_height;
+}
+
+static void draw16(Olivec_Canvas16 canvas, int x, int y, const char* str, uint32_t colour, bool blend)
+{
+    assert(initialized);
+    int pen = x;
+    Olivec_Mask source;
+    const char* p = str;
+    for(uint32_t c = utf8_next(&p); c != 0; c = utf8_next(&p)) {
+        const struct glyph* glyph = lookup(c, &source);
+        if(glyph->width > 0) {
+            Olivec_Mask src = olivec_mask_subcanvas(source, glyph->atlas_x, glyph->atlas_y, glyph->width, glyph->height);
+            if(blend) {
+                olivec16_mask_blend(canvas, pen + glyph->offset_x, y + glyph->offset_y, src, colour);
+            } else {
+                olivec16_mask_copy(canvas, pen + glyph->offset_x, y + glyph->offset_y, src, colour);
+            }
+        }
+        pen += glyph->advance;
+        if(pen >= (int)canvas.width) {
+            break;
+        }
+    }
+}
+
+void glyph_atlas_draw16(Olivec_Canvas16 canvas, int x, int y, const char* str, uint32_t colour)
+{
+    draw16(canvas, x, y, str, colour, true);
+}
+
+void glyph_atlas_copy16(Olivec_Canvas16 canvas, int x, int y, const char* str, uint32_t colour)
+{
+    draw16(canvas, x, y, str, colour, false);
+}
+
+void glyph_atlas_draw(Olivec_Canvas canvas, int x, int y, const char* str, uint32_t colour)
+{
+    assert(initialized);
+    int pen = x;
+    Olivec_Mask source;
+    const char* p = str;
+    for(uint32_t c = utf8_next(&p); c != 0; c = utf8_next(&p)) {
+        const struct glyph* glyph = lookup(c, &source);
+        if(glyph->width > 0) {
+            Olivec_Mask src = olivec_mask_subcanvas(source, glyph->atlas_x, glyph->atlas_y, glyph->width, glyph->height);
+            olivec_mask_blend_premul(canvas, pen + glyph->offset_x, y + glyph->offset_y, src, colour);
+        }
+        pen += glyph->advance;
+        if(pen >= (int)canvas.width) {
+            break;
+        }
+    }
+}
+
+void glyph_atlas_cleanup(void)
+{
+    assert(initialized);
+    canvas_pool_free(atlas.coverage);
+    atlas = OLIVEC_MASK_NULL;
+    initialized = false;
+}
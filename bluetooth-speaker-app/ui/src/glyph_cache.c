@@ -0,0 +1,425 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ui/glyph_cache.h"
+#include "hal/canvas_pool.h"
+#include "ui/lru.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// code points are spread over the buckets by their low bits, glyphs shown together tend to be close to each other
+#define NUM_BUCKETS 64
+// .hex glyphs are 8 or 16 pixels wide and always 16 tall
+#define HEX_GLYPH_HEIGHT 16
+
+struct cached_glyph {
+    uint32_t code_point;
+    // false if nothing has a glyph for the code point, kept so the font isn't searched again every frame
+    bool found;
+    struct glyph glyph;
+    Olivec_Mask image;
+    size_t bytes;
+    struct lru_node lru;
+    struct cached_glyph* next_in_bucket;
+};
+
+enum mark {
+    MARK_GRAVE,
+    MARK_ACUTE,
+    MARK_CIRCUMFLEX,
+    MARK_TILDE,
+    MARK_DIAERESIS,
+    MARK_RING,
+    MARK_CARON,
+    MARK_MACRON,
+    MARK_DOT,
+    MARK_CEDILLA,
+};
+
+// 2 pixel strokes to match the weight of the atlas glyphs, '#' is ink
+static const char* const mark_rows[][3] = {
+    [MARK_GRAVE] = {"##...", ".##..", "..##."},
+    [MARK_ACUTE] = {"...##", "..##.", ".##.."},
+    [MARK_CIRCUMFLEX] = {"..##..", ".####.", "##..##"},
+    [MARK_TILDE] = {".###..#", "#..###.", NULL},
+    [MARK_DIAERESIS] = {"##..##", "##..##", NULL},
+    [MARK_RING] = {".##.", "#..#", ".##."},
+    [MARK_CARON] = {"##..##", ".####.", "..##.."},
+    [MARK_MACRON] = {"######", "######", NULL},
+    [MARK_DOT] = {"##", "##", NULL},
+    [MARK_CEDILLA] = {"..##", "...#", ".##."},
+};
+
+struct composition {
+    uint32_t code_point;
+    char base;
+    enum mark mark;
+};
+
+// Latin-1 Supplement and the common part of Latin Extended-A, sorted by code point
+static const struct composition compositions[] = {
+    {0xC0, 'A', MARK_GRAVE}, {0xC1, 'A', MARK_ACUTE}, {0xC2, 'A', MARK_CIRCUMFLEX}, {0xC3, 'A', MARK_TILDE},
+    {0xC4, 'A', MARK_DIAERESIS}, {0xC5, 'A', MARK_RING}, {0xC7, 'C', MARK_CEDILLA}, {0xC8, 'E', MARK_GRAVE},
+    {0xC9, 'E', MARK_ACUTE}, {0xCA, 'E', MARK_CIRCUMFLEX}, {0xCB, 'E', MARK_DIAERESIS}, {0xCC, 'I', MARK_GRAVE},
+    {0xCD, 'I', MARK_ACUTE}, {0xCE, 'I', MARK_CIRCUMFLEX}, {0xCF, 'I', MARK_DIAERESIS}, {0xD1, 'N', MARK_TILDE},
+    {0xD2, 'O', MARK_GRAVE}, {0xD3, 'O', MARK_ACUTE}, {0xD4, 'O', MARK_CIRCUMFLEX}, {0xD5, 'O', MARK_TILDE},
+    {0xD6, 'O', MARK_DIAERESIS}, {0xD9, 'U', MARK_GRAVE}, {0xDA, 'U', MARK_ACUTE}, {0xDB, 'U', MARK_CIRCUMFLEX},
+    {0xDC, 'U', MARK_DIAERESIS}, {0xDD, 'Y', MARK_ACUTE}, {0xE0, 'a', MARK_GRAVE}, {0xE1, 'a', MARK_ACUTE},
+    {0xE2, 'a', MARK_CIRCUMFLEX}, {0xE3, 'a', MARK_TILDE}, {0xE4, 'a', MARK_DIAERESIS}, {0xE5, 'a', MARK_RING},
+    {0xE7, 'c', MARK_CEDILLA}, {0xE8, 'e', MARK_GRAVE}, {0xE9, 'e', MARK_ACUTE}, {0xEA, 'e', MARK_CIRCUMFLEX},
+    {0xEB, 'e', MARK_DIAERESIS}, {0xEC, 'i', MARK_GRAVE}, {0xED, 'i', MARK_ACUTE}, {0xEE, 'i', MARK_CIRCUMFLEX},
+    {0xEF, 'i', MARK_DIAERESIS}, {0xF1, 'n', MARK_TILDE}, {0xF2, 'o', MARK_GRAVE}, {0xF3, 'o', MARK_ACUTE},
+    {0xF4, 'o', MARK_CIRCUMFLEX}, {0xF5, 'o', MARK_TILDE}, {0xF6, 'o', MARK_DIAERESIS}, {0xF9, 'u', MARK_GRAVE},
+    {0xFA, 'u', MARK_ACUTE}, {0xFB, 'u', MARK_CIRCUMFLEX}, {0xFC, 'u', MARK_DIAERESIS}, {0xFD, 'y', MARK_ACUTE},
+    {0xFF, 'y', MARK_DIAERESIS}, {0x100, 'A', MARK_MACRON}, {0x101, 'a', MARK_MACRON}, {0x106, 'C', MARK_ACUTE},
+    {0x107, 'c', MARK_ACUTE}, {0x10C, 'C', MARK_CARON}, {0x10D, 'c', MARK_CARON}, {0x10E, 'D', MARK_CARON},
+    {0x112, 'E', MARK_MACRON}, {0x113, 'e', MARK_MACRON}, {0x116, 'E', MARK_DOT}, {0x117, 'e', MARK_DOT},
+    {0x11A, 'E', MARK_CARON}, {0x11B, 'e', MARK_CARON}, {0x12A, 'I', MARK_MACRON}, {0x12B, 'i', MARK_MACRON},
+    {0x143, 'N', MARK_ACUTE}, {0x144, 'n', MARK_ACUTE}, {0x147, 'N', MARK_CARON}, {0x148, 'n', MARK_CARON},
+    {0x14C, 'O', MARK_MACRON}, {0x14D, 'o', MARK_MACRON}, {0x158, 'R', MARK_CARON}, {0x159, 'r', MARK_CARON},
+    {0x15A, 'S', MARK_ACUTE}, {0x15B, 's', MARK_ACUTE}, {0x15E, 'S', MARK_CEDILLA}, {0x15F, 's', MARK_CEDILLA},
+    {0x160, 'S', MARK_CARON}, {0x161, 's', MARK_CARON}, {0x162, 'T', MARK_CEDILLA}, {0x163, 't', MARK_CEDILLA},
+    {0x164, 'T', MARK_CARON}, {0x16A, 'U', MARK_MACRON}, {0x16B, 'u', MARK_MACRON}, {0x16E, 'U', MARK_RING},
+    {0x16F, 'u', MARK_RING}, {0x178, 'Y', MARK_DIAERESIS}, {0x179, 'Z', MARK_ACUTE}, {0x17A, 'z', MARK_ACUTE},
+    {0x17B, 'Z', MARK_DOT}, {0x17C, 'z', MARK_DOT}, {0x17D, 'Z', MARK_CARON}, {0x17E, 'z', MARK_CARON},
+};
+
+static bool initialized = false;
+static size_t budget = 0;
+static struct cached_glyph* buckets[NUM_BUCKETS];
+// most recently used first
+static struct lru_list recent;
+static struct glyph_cache_stats stats;
+
+// the mapped .hex font, NULL if there is none
+static const char* font_data = NULL;
+static size_t font_size = 0;
+
+static void remove_entry(struct cached_glyph* entry)
+{
+    struct cached_glyph** link = &buckets[entry->code_point % NUM_BUCKETS];
+    while(*link != entry) {
+        link = &(*link)->next_in_bucket;
+    }
+    *link = entry->next_in_bucket;
+    lru_unlink(&recent, &entry->lru);
+    stats.entries--;
+    stats.bytes -= entry->bytes;
+    canvas_pool_free(entry);
+}
+
+// the entry and its coverage in one pool block, like image_loader canvases
+static struct cached_glyph* new_entry(uint32_t code_point, int width, int height)
+{
+    size_t coverage_bytes = sizeof(uint8_t) * width * height;
+    size_t bytes = sizeof(struct cached_glyph) + coverage_bytes;
+    struct cached_glyph* entry = canvas_pool_alloc(bytes);
+    if(entry == NULL) {
+        return NULL;
+    }
+    memset(entry, 0, bytes);
+    entry->code_point = code_point;
+    entry->bytes = bytes;
+    entry->image = olivec_mask((uint8_t*)(entry + 1), width, height, width);
+    return entry;
+}
+
+static const struct composition* find_composition(uint32_t code_point)
+{
+    int lo = 0;
+    int hi = sizeof(compositions) / sizeof(compositions[0]);
+    while(lo < hi) {
+        int mid = (lo + hi) / 2;
+        if(compositions[mid].code_point == code_point) {
+            return &compositions[mid];
+        }
+        if(compositions[mid].code_point < code_point) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+static void draw_mark(Olivec_Mask image, enum mark mark, int center_x, int y)
+{
+    const char* const* rows = mark_rows[mark];
+    int x = center_x - (int)strlen(rows[0]) / 2;
+    for(int row = 0; row < 3 && rows[row] != NULL; row++) {
+        for(int col = 0; rows[row][col] != '\0'; col++) {
+            int px = x + col;
+            int py = y + row;
+            if(rows[row][col] == '#' && px >= 0 && py >= 0 && px < (int)image.width && py < (int)image.height) {
+                OLIVEC_COVERAGE(image, px, py) = 255;
+            }
+        }
+    }
+}
+
+static int mark_height(enum mark mark)
+{
+    return mark_rows[mark][2] != NULL ? 3 : 2;
+}
+
+// the base letter from the atlas with the mark above it, or below for a cedilla
+static struct cached_glyph* compose(uint32_t code_point, const struct composition* composition)
+{
+    const struct glyph* base = glyph_atlas_get(composition->base);
+    int width = base->advance;
+    int height = glyph_atlas_line_height();
+    struct cached_glyph* entry = new_entry(code_point, width, height);
+    if(entry == NULL) {
+        return NULL;
+    }
+    Olivec_Mask base_mask = glyph_atlas_get_mask(composition->base);
+    for(size_t y = 0; y < base_mask.height; y++) {
+        memcpy(&OLIVEC_COVERAGE(entry->image, base->offset_x, base->offset_y + y), &OLIVEC_COVERAGE(base_mask, 0, y),
+               base_mask.width);
+    }
+
+    int top = base->offset_y;
+    if(composition->base == 'i' || composition->base == 'j') {
+        // the mark takes the place of the dot
+        top = glyph_atlas_get('x')->offset_y;
+        for(int y = 0; y < top; y++) {
+            memset(&OLIVEC_COVERAGE(entry->image, 0, y), 0, width);
+        }
+    }
+    int center_x = base->offset_x + base->width / 2;
+    if(composition->mark == MARK_CEDILLA) {
+        draw_mark(entry->image, composition->mark, center_x, base->offset_y + base->height);
+    } else {
+        draw_mark(entry->image, composition->mark, center_x, top - 1 - mark_height(composition->mark));
+    }
+
+    entry->found = true;
+    entry->glyph = (struct glyph){
+        .atlas_x = 0,
+        .atlas_y = 0,
+        .width = width,
+        .height = height,
+        .offset_x = 0,
+        .offset_y = 0,
+        .advance = base->advance,
+    };
+    return entry;
+}
+
+static int hex_digit(char c)
+{
+    if(c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if(c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if(c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static const char* line_start(const char* p)
+{
+    while(p > font_data && p[-1] != '\n') {
+        p--;
+    }
+    return p;
+}
+
+static const char* next_line(const char* p, const char* end)
+{
+    while(p < end && *p != '\n') {
+        p++;
+    }
+    return p < end ? p + 1 : end;
+}
+
+// binary search of the lines of the font, which are "CODEPOINT:BITMAP" sorted by code point. Returns the bitmap and
+// how many hex digits it has, or NULL
+static const char* find_hex(uint32_t code_point, int* num_digits)
+{
+    const char* end = font_data + font_size;
+    const char* lo = font_data;
+    const char* hi = end;
+    while(lo < hi) {
+        const char* line = line_start(lo + (hi - lo) / 2);
+        uint32_t line_code_point = 0;
+        const char* p = line;
+        int digit;
+        while(p < end && (digit = hex_digit(*p)) >= 0) {
+            line_code_point = line_code_point * 16 + digit;
+            p++;
+        }
+        if(line_code_point == code_point && p < end && *p == ':') {
+            const char* bitmap = p + 1;
+            *num_digits = 0;
+            while(bitmap + *num_digits < end && hex_digit(bitmap[*num_digits]) >= 0) {
+                (*num_digits)++;
+            }
+            return bitmap;
+        }
+        if(line_code_point < code_point) {
+            lo = next_line(line, end);
+        } else {
+            hi = line;
+        }
+    }
+    return NULL;
+}
+
+static struct cached_glyph* rasterize_hex(uint32_t code_point, const char* bitmap, int num_digits)
+{
+    // 2 or 4 hex digits per row
+    int width = num_digits * 4 / HEX_GLYPH_HEIGHT;
+    if(num_digits * 4 != width * HEX_GLYPH_HEIGHT || (width != 8 && width != 16)) {
+        fprintf(stderr, "glyph_cache: bad bitmap for U+%04X in the font\n", (unsigned)code_point);
+        return NULL;
+    }
+    struct cached_glyph* entry = new_entry(code_point, width, HEX_GLYPH_HEIGHT);
+    if(entry == NULL) {
+        return NULL;
+    }
+    int digits_per_row = width / 4;
+    for(int y = 0; y < HEX_GLYPH_HEIGHT; y++) {
+        for(int d = 0; d < digits_per_row; d++) {
+            int bits = hex_digit(bitmap[y * digits_per_row + d]);
+            for(int b = 0; b < 4; b++) {
+                if(bits & (8 >> b)) {
+                    OLIVEC_COVERAGE(entry->image, d * 4 + b, y) = 255;
+                }
+            }
+        }
+    }
+    entry->found = true;
+    entry->glyph = (struct glyph){
+        .atlas_x = 0,
+        .atlas_y = 0,
+        .width = width,
+        .height = HEX_GLYPH_HEIGHT,
+        .offset_x = 1,
+        .offset_y = (glyph_atlas_line_height() - HEX_GLYPH_HEIGHT) / 2,
+        .advance = width + 2,
+    };
+    return entry;
+}
+
+static struct cached_glyph* rasterize(uint32_t code_point)
+{
+    const struct composition* composition = find_composition(code_point);
+    if(composition != NULL) {
+        return compose(code_point, composition);
+    }
+    if(font_data != NULL) {
+        int num_digits = 0;
+        const char* bitmap = find_hex(code_point, &num_digits);
+        struct cached_glyph* entry = bitmap != NULL ? rasterize_hex(code_point, bitmap, num_digits) : NULL;
+        if(entry != NULL) {
+            return entry;
+        }
+    }
+    // remember that there's nothing, so the next lookup doesn't search the font again
+    struct cached_glyph* entry = new_entry(code_point, 0, 0);
+    if(entry != NULL) {
+        entry->found = false;
+    }
+    return entry;
+}
+
+static void load_font(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED) {
+            font_data = data;
+            font_size = st.st_size;
+        } else {
+            fprintf(stderr, "glyph_cache: failed to map %s\n", path);
+        }
+    }
+    close(fd);
+}
+
+int glyph_cache_init(size_t budget_bytes, const char* hex_font_path)
+{
+    assert(!initialized);
+    budget = budget_bytes;
+    memset(buckets, 0, sizeof(buckets));
+    lru_init(&recent);
+    memset(&stats, 0, sizeof(stats));
+    font_data = NULL;
+    font_size = 0;
+    if(hex_font_path != NULL) {
+        load_font(hex_font_path);
+    }
+    initialized = true;
+    return 0;
+}
+
+const struct glyph* glyph_cache_get(uint32_t code_point, Olivec_Mask* image)
+{
+    if(!initialized) {
+        return NULL;
+    }
+    struct cached_glyph* entry = buckets[code_point % NUM_BUCKETS];
+    while(entry != NULL && entry->code_point != code_point) {
+        entry = entry->next_in_bucket;
+    }
+
+    if(entry != NULL) {
+        stats.hits++;
+        lru_touch(&recent, &entry->lru);
+    } else {
+        stats.misses++;
+        entry = rasterize(code_point);
+        if(entry == NULL) {
+            return NULL;
+        }
+        entry->next_in_bucket = buckets[code_point % NUM_BUCKETS];
+        buckets[code_point % NUM_BUCKETS] = entry;
+        lru_push_newest(&recent, &entry->lru);
+        stats.entries++;
+        stats.bytes += entry->bytes;
+        // the glyph just added is never evicted, even if it alone is over budget
+        while(stats.bytes > budget && recent.oldest != &entry->lru) {
+            remove_entry(LRU_ENTRY(recent.oldest, struct cached_glyph, lru));
+            stats.evictions++;
+        }
+    }
+
+    if(!entry->found) {
+        return NULL;
+    }
+    *image = entry->image;
+    return &entry->glyph;
+}
+
+void glyph_cache_get_stats(struct glyph_cache_stats* result)
+{
+    assert(initialized);
+    *result = stats;
+}
+
+void glyph_cache_cleanup(void)
+{
+    assert(initialized);
+    while(recent.oldest != NULL) {
+        remove_entry(LRU_ENTRY(recent.oldest, struct cached_glyph, lru));
+    }
+    if(font_data != NULL) {
+        munmap((void*)font_data, font_size);
+        font_data = NULL;
+    }
+    initialized = false;
+}
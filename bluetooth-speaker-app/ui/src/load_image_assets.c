@@ -1,19 +1,42 @@
 #include "hal/image_loader.h"
+#include "hal/rle_sprite.h"
+#include "ui/glyph_atlas.h"
+#include "ui/glyph_cache.h"
+#include "ui/load_image_assets.h"
 #include <string.h>
 #include <stdio.h>
 
 #define NUM_CHARS 256
 #define BUF_SIZE 256
 
+// glyphs rasterized for characters outside the atlas, about 50 accented letters or 30 CJK characters
+#define GLYPH_CACHE_BYTES (32 * 1024)
+// Greek, Cyrillic, Hangul, symbols and more, see assets/fonts/README.md. Without it only accented Latin letters are
+// drawn beyond ASCII
+#define HEX_FONT_PATH "./assets/fonts/fallback.hex"
+
 static const char characters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789~`!@#$%^&*()[{]}\\|;:\"\',<.>/? ";
 
 static Olivec_Canvas *char_images[NUM_CHARS];
-static Olivec_Canvas *volume_icon = NULL;
-static Olivec_Canvas *shuffle_icon = NULL;
-static Olivec_Canvas *replay_icon = NULL;
-static Olivec_Canvas *repeat_icon = NULL;
-static Olivec_Canvas *play_icon = NULL;
-static Olivec_Canvas *pause_icon = NULL;
+static struct rle_sprite *volume_icon = NULL;
+static struct rle_sprite *shuffle_icon = NULL;
+static struct rle_sprite *replay_icon = NULL;
+static struct rle_sprite *repeat_icon = NULL;
+static struct rle_sprite *play_icon = NULL;
+static struct rle_sprite *pause_icon = NULL;
+
+// icons are only ever blended whole, so just the encoded copy is kept
+static struct rle_sprite *load_icon(const char *path)
+{
+    Olivec_Canvas *image = image_loader_load(path);
+    if (image == NULL)
+    {
+        return NULL;
+    }
+    struct rle_sprite *sprite = rle_sprite_from_premul(*image);
+    image_loader_image_free(&image);
+    return sprite;
+}
 
 int load_image_assets_init()
 {
@@ -36,42 +59,65 @@ int load_image_assets_init()
         }
     }
 
-    volume_icon = image_loader_load("./assets/img/icon/volume_icon.png");
+    // text is drawn from the atlas, the separate images aren't needed after packing
+    int code = glyph_atlas_init(char_images, LOAD_IMAGE_ASSETS_CHAR_WIDTH, LOAD_IMAGE_ASSETS_CHAR_HEIGHT);
+    for (size_t i = 0; i < sizeof(characters); i++)
+    {
+        int c = characters[i];
+        if (char_images[c] != NULL)
+        {
+            image_loader_image_free(&char_images[c]);
+        }
+    }
+    if (code)
+    {
+        fprintf(stderr, "load_image_assets_init failed to build the glyph atlas %d\n", code);
+        return 3;
+    }
+
+    code = glyph_cache_init(GLYPH_CACHE_BYTES, HEX_FONT_PATH);
+    if (code)
+    {
+        fprintf(stderr, "load_image_assets_init failed to init the glyph cache %d\n", code);
+        return 3;
+    }
+
+    volume_icon = load_icon("./assets/img/icon/volume_icon.png");
     if (volume_icon == NULL)
     {
         fprintf(stderr, "load_image_assets_init failed to load %s\n", "./assets/img/icon/volume_icon.png");
         return 2;
     }
 
-    shuffle_icon = image_loader_load("./assets/img/icon/shuffle.png");
+    shuffle_icon = load_icon("./assets/img/icon/shuffle.png");
     if (shuffle_icon == NULL)
     {
         fprintf(stderr, "load_image_assets_init failed to load %s\n", "./assets/img/icon/shuffle.png");
         return 2;
     }
 
-    repeat_icon = image_loader_load("./assets/img/icon/repeat.png");
+    repeat_icon = load_icon("./assets/img/icon/repeat.png");
     if (repeat_icon == NULL)
     {
         fprintf(stderr, "load_image_assets_init failed to load %s\n", "./assets/img/icon/repeat.png");
         return 2;
     }
 
-    replay_icon = image_loader_load("./assets/img/icon/replay.png");
+    replay_icon = load_icon("./assets/img/icon/replay.png");
     if (replay_icon == NULL)
     {
         fprintf(stderr, "load_image_assets_init failed to load %s\n", "./assets/img/icon/replay.png");
         return 2;
     }
 
-    play_icon = image_loader_load("./assets/img/icon/play.png");
+    play_icon = load_icon("./assets/img/icon/play.png");
     if (play_icon == NULL)
     {
         fprintf(stderr, "load_image_assets_init failed to load %s\n", "./assets/img/icon/play.png");
         return 2;
     }
 
-    pause_icon = image_loader_load("./assets/img/icon/pause.png");
+    pause_icon = load_icon("./assets/img/icon/pause.png");
     if (pause_icon == NULL)
     {
         fprintf(stderr, "load_image_assets_init failed to load %s\n", "./assets/img/icon/pause.png");
@@ -81,59 +127,44 @@ int load_image_assets_init()
     return 0;
 }
 
-Olivec_Canvas *load_image_assets_get_char(char c)
-{
-    if (char_images[(int)c] != NULL)
-    {
-        return char_images[(int)c];
-    }
-    else
-    {
-        return char_images[0];
-    }
-}
-
-Olivec_Canvas *load_image_assets_get_volume_icon()
+const struct rle_sprite *load_image_assets_get_volume_icon()
 {
     return volume_icon;
 }
 
-Olivec_Canvas *load_image_assets_get_shuffle_icon()
+const struct rle_sprite *load_image_assets_get_shuffle_icon()
 {
     return shuffle_icon;
 }
 
-Olivec_Canvas *load_image_assets_get_repeat_icon()
+const struct rle_sprite *load_image_assets_get_repeat_icon()
 {
     return repeat_icon;
 }
 
-Olivec_Canvas *load_image_assets_get_replay_icon()
+const struct rle_sprite *load_image_assets_get_replay_icon()
 {
     return replay_icon;
 }
 
-Olivec_Canvas *load_image_assets_get_play_icon()
+const struct rle_sprite *load_image_assets_get_play_icon()
 {
     return play_icon;
 }
 
-Olivec_Canvas *load_image_assets_get_pause_icon()
+const struct rle_sprite *load_image_assets_get_pause_icon()
 {
     return pause_icon;
 }
 
 void load_image_assets_cleanup()
 {
-    for (size_t i = 0; i < strlen(characters); i++)
-    {
-        int c = characters[i];
-        image_loader_image_free(&char_images[c]);
-    }
-    image_loader_image_free(&volume_icon);
-    image_loader_image_free(&shuffle_icon);
-    image_loader_image_free(&replay_icon);
-    image_loader_image_free(&repeat_icon);
-    image_loader_image_free(&play_icon);
-    image_loader_image_free(&pause_icon);
+    glyph_cache_cleanup();
+    glyph_atlas_cleanup();
+    rle_sprite_free(&volume_icon);
+    rle_sprite_free(&shuffle_icon);
+    rle_sprite_free(&replay_icon);
+    rle_sprite_free(&repeat_icon);
+    rle_sprite_free(&play_icon);
+    rle_sprite_free(&pause_icon);
 }
\ No newline at end of file
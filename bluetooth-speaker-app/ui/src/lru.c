@@ -0,0 +1,53 @@
+#include "ui/lru.h"
+
+void lru_init(struct lru_list* list)
+{
+    list->newest = NULL;
+    list->oldest = NULL;
+}
+
+void lru_push_newest(struct lru_list* list, struct lru_node* node)
+{
+    node->newer = NULL;
+    node->older = list->newest;
+    if(list->newest != NULL) {
+        list->newest->newer = node;
+    } else {
+        list->oldest = node;
+    }
+    list->newest = node;
+}
+
+void lru_unlink(struct lru_list* list, struct lru_node* node)
+{
+    if(node->newer != NULL) {
+        node->newer->older = node->older;
+    } else {
+        list->newest = node->older;
+    }
+    if(node->older != NULL) {
+        node->older->newer = node->newer;
+    } else {
+        list->oldest = node->newer;
+    }
+    node->newer = NULL;
+    node->older = NULL;
+}
+
+void lru_touch(struct lru_list* list, struct lru_node* node)
+{
+    if(list->newest != node) {
+        lru_unlink(list, node);
+        lru_push_newest(list, node);
+    }
+}
+
+uint32_t lru_hash(const char* text)
+{
+    uint32_t hash = 2166136261u;
+    for(const char* p = text; *p != '\0'; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,128 @@
+#include "ui/marquee.h"
+#include "ui/text_cache.h"
+#include "ui/load_image_assets.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXT_COLOUR OLIVEC_RGBA(0, 0, 0, 255)
+
+// pixels per second, one pixel per frame at 30 fps
+static const long SCROLL_SPEED = 30;
+// how long the start of the text is shown before each scroll
+static const long HOLD_MS = 2000;
+static const int GAP_CHARS = 4;
+
+struct marquee* marquee_create(int width)
+{
+    struct marquee* marquee = malloc(sizeof(*marquee));
+    marquee->width = width;
+    marquee->strip = NULL;
+    marquee->period = 0;
+    marquee->start_ms = 0;
+    marquee->drawn_offset = 0;
+    return marquee;
+}
+
+static void update_strip(struct marquee* marquee, const char* text)
+{
+    if(marquee->strip != NULL) {
+        text_cache_release(marquee->strip);
+    }
+    marquee->strip = text_cache_get(text, TEXT_FONT_DEFAULT, TEXT_COLOUR);
+    if(marquee->strip == NULL) {
+        // marquee_draw_at draws nothing without a strip, and the next set_text tries again
+        marquee->period = 0;
+        return;
+    }
+
+    int text_width = marquee->strip->image->width;
+    if(text_width <= marquee->width) {
+        marquee->period = 0;
+    } else {
+        marquee->period = text_width + GAP_CHARS * LOAD_IMAGE_ASSETS_CHAR_WIDTH;
+    }
+}
+
+void marquee_set_text(struct marquee* marquee, const char* text)
+{
+    if(marquee->strip != NULL && strcmp(marquee->strip->text, text) == 0) {
+        return;
+    }
+    // restart the scroll on the next draw
+    marquee->start_ms = -1;
+    update_strip(marquee, text);
+}
+
+// where in the hold and scroll cycle the text is, in ms since the last hold started
+static long cycle_time(const struct marquee* marquee, long now_ms)
+{
+    long cycle_ms = HOLD_MS + marquee->period * 1000 / SCROLL_SPEED;
+    return (now_ms - marquee->start_ms) % cycle_ms;
+}
+
+// how far the text has scrolled to the left
+static int scroll_offset(const struct marquee* marquee, long now_ms)
+{
+    long t = cycle_time(marquee, now_ms);
+    return t < HOLD_MS ? 0 : (t - HOLD_MS) * SCROLL_SPEED / 1000;
+}
+
+bool marquee_draw_at(struct marquee* marquee, Olivec_Canvas16 canvas, int x, int y, long now_ms)
+{
+    if(marquee->strip == NULL) {
+        return false;
+    }
+
+    Olivec_Canvas16 strip = *marquee->strip->image;
+    if(marquee->period == 0) {
+        int text_x = x + (marquee->width - (int)strip.width) / 2;
+        olivec16_sprite_blend(canvas, text_x, y, strip.width, strip.height, strip);
+        return false;
+    }
+
+    if(marquee->start_ms < 0) {
+        marquee->start_ms = now_ms;
+    }
+    int offset = scroll_offset(marquee, now_ms);
+    marquee->drawn_offset = offset;
+
+    // the end of the text, then after the gap its start again as the box wraps around
+    int visible = (int)strip.width - offset;
+    if(visible > 0) {
+        Olivec_Canvas16 window = olivec16_subcanvas(strip, offset, 0, visible < marquee->width ? visible : marquee->width, strip.height);
+        olivec16_sprite_blend(canvas, x, y, window.width, window.height, window);
+    }
+    int wrap_x = marquee->period - offset;
+    if(wrap_x < marquee->width) {
+        Olivec_Canvas16 window = olivec16_subcanvas(strip, 0, 0, marquee->width - wrap_x, strip.height);
+        olivec16_sprite_blend(canvas, x + wrap_x, y, window.width, window.height, window);
+    }
+    return true;
+}
+
+bool marquee_needs_redraw(const struct marquee* marquee, long now_ms)
+{
+    // not drawn since the text was set, that marks the widget dirty anyway
+    if(marquee->period == 0 || marquee->start_ms < 0) {
+        return false;
+    }
+    return scroll_offset(marquee, now_ms) != marquee->drawn_offset;
+}
+
+long marquee_ms_until_change(const struct marquee* marquee, long now_ms)
+{
+    if(marquee->period == 0 || marquee->start_ms < 0) {
+        return -1;
+    }
+    long t = cycle_time(marquee, now_ms);
+    return t < HOLD_MS ? HOLD_MS - t : 0;
+}
+
+void marquee_free(struct marquee** marquee)
+{
+    if((*marquee)->strip != NULL) {
+        text_cache_release((*marquee)->strip);
+    }
+    free(*marquee);
+    *marquee = NULL;
+}
@@ -0,0 +1,289 @@
+#include "ui/perf_hud.h"
+#include "hal/draw_stuff.h"
+#include "hal/frame_pacer.h"
+#include "hal/time_util.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// frames the percentiles are taken over
+#define WINDOW 64
+#define LINES 7
+#define LINE_CHARS 15
+// 3x5 glyphs in 4x6 cells
+#define GLYPH_WIDTH 3
+#define GLYPH_HEIGHT 5
+#define CELL_WIDTH 4
+#define CELL_HEIGHT 6
+#define HUD_WIDTH (LINE_CHARS * CELL_WIDTH + 1)
+#define HUD_HEIGHT (LINES * CELL_HEIGHT + 1)
+
+static const long REFRESH_MS = 500;
+// OLIVEC_RGBA isn't a constant expression
+#define HUD_BACKGROUND 0xFF000000
+#define HUD_TEXT 0xFFFFFFFF
+
+// five rows of three pixels, 4 is the left column
+#define GLYPH(r0, r1, r2, r3, r4) ((r0) << 12 | (r1) << 9 | (r2) << 6 | (r3) << 3 | (r4))
+
+static const uint16_t DIGITS[10] = {
+    GLYPH(7, 5, 5, 5, 7), GLYPH(2, 6, 2, 2, 7), GLYPH(7, 1, 7, 4, 7), GLYPH(7, 1, 3, 1, 7), GLYPH(5, 5, 7, 1, 1),
+    GLYPH(7, 4, 7, 1, 7), GLYPH(7, 4, 7, 5, 7), GLYPH(7, 1, 1, 2, 2), GLYPH(7, 5, 7, 5, 7), GLYPH(7, 5, 7, 1, 7),
+};
+
+static const uint16_t LETTERS[26] = {
+    GLYPH(2, 5, 7, 5, 5), GLYPH(6, 5, 6, 5, 6), GLYPH(3, 4, 4, 4, 3), GLYPH(6, 5, 5, 5, 6), GLYPH(7, 4, 6, 4, 7),
+    GLYPH(7, 4, 6, 4, 4), GLYPH(3, 4, 5, 5, 3), GLYPH(5, 5, 7, 5, 5), GLYPH(7, 2, 2, 2, 7), GLYPH(1, 1, 1, 5, 2),
+    GLYPH(5, 5, 6, 5, 5), GLYPH(4, 4, 4, 4, 7), GLYPH(5, 7, 7, 5, 5), GLYPH(6, 5, 5, 5, 5), GLYPH(2, 5, 5, 5, 2),
+    GLYPH(6, 5, 6, 4, 4), GLYPH(2, 5, 5, 6, 3), GLYPH(6, 5, 6, 5, 5), GLYPH(3, 4, 2, 1, 6), GLYPH(7, 2, 2, 2, 2),
+    GLYPH(5, 5, 5, 5, 7), GLYPH(5, 5, 5, 5, 2), GLYPH(5, 5, 7, 7, 5), GLYPH(5, 5, 2, 5, 5), GLYPH(5, 5, 2, 2, 2),
+    GLYPH(7, 1, 2, 4, 7),
+};
+
+static const char* STAGE_NAMES[PERF_HUD_NUM_STAGES] = {"MDL", "CMP", "CNV", "SPI"};
+
+// stage times of the last WINDOW frames in us
+struct samples {
+    int32_t us[WINDOW];
+    int count;
+    int next;
+};
+
+static bool initialized = false;
+static _Atomic bool want_visible = false;
+static bool visible = false;
+static struct widget* hud = NULL;
+static char text[LINES][LINE_CHARS + 1];
+
+static long long mark_us = 0;
+static struct samples stages[PERF_HUD_NUM_STAGES];
+static long next_refresh_ms = 0;
+// counters at the last refresh, the HUD shows what happened since
+static long last_refresh_ms = 0;
+static long frames = 0;
+static long last_displayed = 0;
+static long long last_bytes_total = 0;
+// counters when the HUD was shown
+static long dropped_base = 0;
+static long overruns_base = 0;
+// frames_displayed when the last SPI time was sampled
+static long send_sampled = 0;
+
+static uint16_t glyph_for(char c)
+{
+    if(c >= '0' && c <= '9') {
+        return DIGITS[c - '0'];
+    } else if(c >= 'A' && c <= 'Z') {
+        return LETTERS[c - 'A'];
+    } else if(c >= 'a' && c <= 'z') {
+        return LETTERS[c - 'a'];
+    }
+    switch(c) {
+    case '.':
+        return GLYPH(0, 0, 0, 0, 2);
+    case '/':
+        return GLYPH(1, 1, 2, 4, 4);
+    case '-':
+        return GLYPH(0, 0, 7, 0, 0);
+    case ':':
+        return GLYPH(0, 2, 0, 2, 0);
+    default:
+        return 0;
+    }
+}
+
+static void draw_hud(Olivec_Canvas16 canvas, int x, int y, void* data)
+{
+    (void)data;
+    olivec16_rect(canvas, x, y, HUD_WIDTH, HUD_HEIGHT, HUD_BACKGROUND);
+    for(int line = 0; line < LINES; line++) {
+        for(int i = 0; text[line][i] != '\0'; i++) {
+            uint16_t glyph = glyph_for(text[line][i]);
+            int gx = x + 1 + i * CELL_WIDTH;
+            int gy = y + 1 + line * CELL_HEIGHT;
+            for(int row = 0; row < GLYPH_HEIGHT; row++) {
+                for(int col = 0; col < GLYPH_WIDTH; col++) {
+                    int bit = (GLYPH_HEIGHT - 1 - row) * GLYPH_WIDTH + (GLYPH_WIDTH - 1 - col);
+                    if(glyph & (1 << bit)) {
+                        olivec16_rect(canvas, gx + col, gy + row, 1, 1, HUD_TEXT);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void add_sample(struct samples* samples, long long us)
+{
+    samples->us[samples->next] = us > INT32_MAX ? INT32_MAX : (int32_t)us;
+    samples->next = (samples->next + 1) % WINDOW;
+    if(samples->count < WINDOW) {
+        samples->count++;
+    }
+}
+
+static int compare_int32(const void* a, const void* b)
+{
+    int32_t x = *(const int32_t*)a;
+    int32_t y = *(const int32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// p50 and p95 in ms, capped so they fit their columns
+static void percentiles(const struct samples* samples, double* p50, double* p95)
+{
+    if(samples->count == 0) {
+        *p50 = 0;
+        *p95 = 0;
+        return;
+    }
+    int32_t sorted[WINDOW];
+    memcpy(sorted, samples->us, sizeof(int32_t) * samples->count);
+    qsort(sorted, samples->count, sizeof(int32_t), compare_int32);
+    *p50 = sorted[samples->count / 2] / 1000.0;
+    *p95 = sorted[(samples->count * 95) / 100] / 1000.0;
+    if(*p50 > 99.9) {
+        *p50 = 99.9;
+    }
+    if(*p95 > 99.9) {
+        *p95 = 99.9;
+    }
+}
+
+static void reset_counters(long now_ms)
+{
+    struct draw_stuff_stats draw_stats;
+    struct frame_pacer_stats pacer_stats;
+    draw_stuff_get_stats(&draw_stats);
+    frame_pacer_get_stats(&pacer_stats);
+    memset(stages, 0, sizeof(stages));
+    frames = 0;
+    last_refresh_ms = now_ms;
+    last_displayed = draw_stats.frames_displayed;
+    last_bytes_total = draw_stats.bytes_total;
+    send_sampled = draw_stats.frames_displayed;
+    dropped_base = draw_stats.frames_dropped;
+    overruns_base = pacer_stats.overruns;
+}
+
+// format the counters since the last refresh into text
+static void refresh(long now_ms)
+{
+    struct draw_stuff_stats draw_stats;
+    struct frame_pacer_stats pacer_stats;
+    draw_stuff_get_stats(&draw_stats);
+    frame_pacer_get_stats(&pacer_stats);
+
+    long elapsed_ms = now_ms - last_refresh_ms;
+    double fps = elapsed_ms > 0 ? frames * 1000.0 / elapsed_ms : 0;
+    long displayed = draw_stats.frames_displayed - last_displayed;
+    long long bytes_per_frame = displayed > 0 ? (draw_stats.bytes_total - last_bytes_total) / displayed : 0;
+
+    snprintf(text[0], sizeof(text[0]), "FPS %5.1f", fps);
+    snprintf(text[1], sizeof(text[1]), "DRP %ld OVR %ld", draw_stats.frames_dropped - dropped_base,
+             pacer_stats.overruns - overruns_base);
+    snprintf(text[2], sizeof(text[2]), "B/F %lld", bytes_per_frame);
+    for(int stage = 0; stage < PERF_HUD_NUM_STAGES; stage++) {
+        double p50, p95;
+        percentiles(&stages[stage], &p50, &p95);
+        snprintf(text[3 + stage], sizeof(text[3 + stage]), "%s %4.1f %4.1f", STAGE_NAMES[stage], p50, p95);
+    }
+
+    frames = 0;
+    last_refresh_ms = now_ms;
+    last_displayed = draw_stats.frames_displayed;
+    last_bytes_total = draw_stats.bytes_total;
+    next_refresh_ms = now_ms + REFRESH_MS;
+    widget_mark_dirty(hud);
+}
+
+int perf_hud_init(struct widget_tree* tree, int x, int y)
+{
+    assert(!initialized);
+    hud = widget_tree_add_overlay(tree, x, y, HUD_WIDTH, HUD_HEIGHT, draw_hud, NULL);
+    if(hud == NULL) {
+        return 1;
+    }
+    widget_set_visible(hud, false);
+    memset(text, 0, sizeof(text));
+    visible = false;
+    want_visible = false;
+    initialized = true;
+    return 0;
+}
+
+void perf_hud_toggle(void)
+{
+    want_visible = !want_visible;
+}
+
+void perf_hud_mark(void)
+{
+    assert(initialized);
+    if(visible) {
+        mark_us = time_us();
+    }
+}
+
+void perf_hud_stage_done(enum perf_hud_stage stage)
+{
+    assert(initialized);
+    if(visible) {
+        long long now = time_us();
+        add_sample(&stages[stage], now - mark_us);
+        mark_us = now;
+    }
+}
+
+void perf_hud_update(long now_ms)
+{
+    assert(initialized);
+    bool show = want_visible;
+    if(show != visible) {
+        visible = show;
+        widget_set_visible(hud, show);
+        if(show) {
+            reset_counters(now_ms);
+            refresh(now_ms);
+        }
+    } else if(visible && now_ms >= next_refresh_ms) {
+        refresh(now_ms);
+    }
+}
+
+void perf_hud_frame_done(bool submitted)
+{
+    assert(initialized);
+    if(!visible) {
+        return;
+    }
+    if(submitted) {
+        frames++;
+    }
+    // the display thread sends frames after this loop moves on, pick up the ones it finished since
+    struct draw_stuff_stats draw_stats;
+    draw_stuff_get_stats(&draw_stats);
+    if(draw_stats.frames_displayed != send_sampled) {
+        send_sampled = draw_stats.frames_displayed;
+        add_sample(&stages[PERF_HUD_SEND], draw_stats.last_send_us);
+    }
+}
+
+long perf_hud_ms_until_refresh(long now_ms)
+{
+    assert(initialized);
+    if(!visible) {
+        return -1;
+    }
+    return next_refresh_ms > now_ms ? next_refresh_ms - now_ms : 0;
+}
+
+void perf_hud_cleanup(void)
+{
+    assert(initialized);
+    hud = NULL;
+    initialized = false;
+}
@@ -0,0 +1,138 @@
+#include "ui/text_cache.h"
+#include "ui/glyph_atlas.h"
+#include "hal/image_loader.h"
+#include "hal/canvas_pool.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool initialized = false;
+static int capacity = 0;
+// most recently used first
+static struct lru_list strips;
+static struct text_cache_stats stats;
+
+static size_t strip_bytes(const struct text_strip* strip)
+{
+    return strip->image->width * strip->image->height * (sizeof(uint16_t) + sizeof(uint8_t));
+}
+
+static void free_strip(struct text_strip* strip)
+{
+    stats.entries--;
+    stats.bytes -= strip_bytes(strip);
+    image_loader_image16_free(&strip->image);
+    canvas_pool_free(strip);
+}
+
+// drop unreferenced strips, least recently used first, until the cache is back within capacity
+static void evict(void)
+{
+    struct lru_node* node = strips.oldest;
+    while(stats.entries > capacity && node != NULL) {
+        struct lru_node* newer = node->newer;
+        struct text_strip* strip = LRU_ENTRY(node, struct text_strip, lru);
+        if(strip->refs == 0) {
+            lru_unlink(&strips, node);
+            free_strip(strip);
+            stats.evictions++;
+        }
+        node = newer;
+    }
+}
+
+static Olivec_Canvas16* render(const char* text, uint32_t colour)
+{
+    Olivec_Canvas16* image = image_loader_image16_create(glyph_atlas_text_width(text), glyph_atlas_line_height(), true);
+    if(image == NULL) {
+        return NULL;
+    }
+    // the colour between the glyphs too, so the strip's edges blend like its insides
+    olivec16_fill(*image, colour & 0x00FFFFFF);
+    glyph_atlas_copy16(*image, 0, 0, text, colour);
+    return image;
+}
+
+int text_cache_init(int max_entries)
+{
+    assert(!initialized);
+    assert(max_entries > 0);
+    capacity = max_entries;
+    lru_init(&strips);
+    memset(&stats, 0, sizeof(stats));
+    initialized = true;
+    return 0;
+}
+
+struct text_strip* text_cache_get(const char* text, enum text_font font, uint32_t colour)
+{
+    assert(initialized);
+    uint32_t hash = lru_hash(text);
+    for(struct lru_node* node = strips.newest; node != NULL; node = node->older) {
+        struct text_strip* strip = LRU_ENTRY(node, struct text_strip, lru);
+        if(strip->hash == hash && strip->font == font && strip->colour == colour && strcmp(strip->text, text) == 0) {
+            stats.hits++;
+            strip->refs++;
+            lru_touch(&strips, node);
+            return strip;
+        }
+    }
+
+    stats.misses++;
+    // the text is kept right after the struct, both come from the pool like the image so misses don't hit the heap
+    size_t text_size = strlen(text) + 1;
+    struct text_strip* strip = canvas_pool_alloc(sizeof(*strip) + text_size);
+    if(strip == NULL) {
+        fprintf(stderr, "text_cache: failed to allocate a strip for \"%s\"\n", text);
+        return NULL;
+    }
+    strip->image = render(text, colour);
+    if(strip->image == NULL) {
+        canvas_pool_free(strip);
+        return NULL;
+    }
+    strip->hash = hash;
+    strip->text = (char*)(strip + 1);
+    memcpy(strip->text, text, text_size);
+    strip->font = font;
+    strip->colour = colour;
+    strip->refs = 1;
+    lru_push_newest(&strips, &strip->lru);
+    stats.entries++;
+    stats.bytes += strip_bytes(strip);
+    evict();
+    return strip;
+}
+
+void text_cache_release(struct text_strip* strip)
+{
+    assert(initialized);
+    assert(strip->refs > 0);
+    strip->refs--;
+    if(strip->refs == 0) {
+        evict();
+    }
+}
+
+void text_cache_get_stats(struct text_cache_stats* result)
+{
+    assert(initialized);
+    *result = stats;
+}
+
+void text_cache_cleanup(void)
+{
+    assert(initialized);
+    while(strips.oldest != NULL) {
+        struct text_strip* strip = LRU_ENTRY(strips.oldest, struct text_strip, lru);
+        if(strip->refs != 0) {
+            fprintf(stderr, "text_cache_cleanup: \"%s\" still has %d references\n", strip->text, strip->refs);
+        }
+        lru_unlink(&strips, &strip->lru);
+        free_strip(strip);
+    }
+    initialized = false;
+}
@@ -0,0 +1,67 @@
+#include "ui/tween.h"
+
+#include <assert.h>
+
+float tween_ease(enum tween_ease ease, float t)
+{
+    if(t <= 0.0f) {
+        return 0.0f;
+    }
+    if(t >= 1.0f) {
+        return 1.0f;
+    }
+    switch(ease) {
+    case TWEEN_LINEAR:
+        return t;
+    case TWEEN_EASE_IN:
+        return t * t * t;
+    case TWEEN_EASE_OUT: {
+        float u = 1.0f - t;
+        return 1.0f - u * u * u;
+    }
+    case TWEEN_EASE_IN_OUT:
+        if(t < 0.5f) {
+            return 4.0f * t * t * t;
+        } else {
+            float u = 2.0f - 2.0f * t;
+            return 1.0f - u * u * u / 2.0f;
+        }
+    }
+    return t;
+}
+
+void tween_start(struct tween* tween, float from, float to, long now_ms, long duration_ms, enum tween_ease ease)
+{
+    assert(duration_ms >= 0);
+    tween->from = from;
+    tween->to = to;
+    tween->start_ms = now_ms;
+    tween->duration_ms = duration_ms;
+    tween->ease = ease;
+    tween->value = from;
+    tween->running = true;
+}
+
+void tween_set(struct tween* tween, float value)
+{
+    tween->from = value;
+    tween->to = value;
+    tween->value = value;
+    tween->running = false;
+}
+
+bool tween_update(struct tween* tween, long now_ms)
+{
+    if(!tween->running) {
+        return false;
+    }
+    long elapsed = now_ms - tween->start_ms;
+    if(elapsed >= tween->duration_ms) {
+        tween->value = tween->to;
+        tween->running = false;
+        return true;
+    }
+    float t = elapsed < 0 ? 0.0f : (float)elapsed / tween->duration_ms;
+    tween->value = tween->from + (tween->to - tween->from) * tween_ease(tween->ease, t);
+    return true;
+}
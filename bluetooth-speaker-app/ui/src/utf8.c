@@ -0,0 +1,61 @@
+#include "ui/utf8.h"
+
+#include <stddef.h>
+
+uint32_t utf8_next(const char** str)
+{
+    const unsigned char* p = (const unsigned char*)*str;
+    if(p[0] == 0) {
+        return 0;
+    }
+    if(p[0] < 0x80) {
+        *str += 1;
+        return p[0];
+    }
+
+    int length;
+    uint32_t code_point;
+    uint32_t min;
+    if((p[0] & 0xE0) == 0xC0) {
+        length = 2;
+        code_point = p[0] & 0x1F;
+        min = 0x80;
+    } else if((p[0] & 0xF0) == 0xE0) {
+        length = 3;
+        code_point = p[0] & 0x0F;
+        min = 0x800;
+    } else if((p[0] & 0xF8) == 0xF0) {
+        length = 4;
+        code_point = p[0] & 0x07;
+        min = 0x10000;
+    } else {
+        *str += 1;
+        return UTF8_REPLACEMENT;
+    }
+
+    for(int i = 1; i < length; i++) {
+        // also stops at the terminator, so a sequence cut off by truncation never reads past the string
+        if((p[i] & 0xC0) != 0x80) {
+            *str += 1;
+            return UTF8_REPLACEMENT;
+        }
+        code_point = (code_point << 6) | (p[i] & 0x3F);
+    }
+    *str += length;
+    // overlong forms, surrogates and values past the last code point
+    if(code_point < min || (code_point >= 0xD800 && code_point <= 0xDFFF) || code_point > 0x10FFFF) {
+        return UTF8_REPLACEMENT;
+    }
+    return code_point;
+}
+
+void utf8_truncate(char* str, int max_chars)
+{
+    const char* p = str;
+    for(int i = 0; i < max_chars; i++) {
+        if(utf8_next(&p) == 0) {
+            return;
+        }
+    }
+    str[p - str] = '\0';
+}
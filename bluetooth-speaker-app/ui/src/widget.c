@@ -0,0 +1,588 @@
+#include "ui/widget.h"
+#include "ui/glyph_atlas.h"
+#include "ui/marquee.h"
+#include "hal/image_loader.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_WIDGETS 32
+#define MAX_TWEENS 8
+#define MAX_LAYERS 4
+
+#define LABEL_COLOUR OLIVEC_RGBA(0, 0, 0, 255)
+
+struct widget_layer {
+    bool cached;
+    uint8_t opacity;
+    int offset_x;
+    int offset_y;
+    // opacity or offset changed since the last render, everything on the layer needs redrawing
+    bool changed;
+};
+
+struct widget_tween {
+    struct tween tween;
+    struct widget* target;
+    void (*apply)(struct widget* target, float value);
+};
+
+struct widget_tree {
+    Olivec_Canvas16* screen;
+    uint32_t background;
+    // the background with every cached layer on it, damaged areas start as a copy of this instead of a fill and blends
+    Olivec_Canvas16* base;
+    bool base_valid;
+    // what's under a layer drawn with less than full opacity, created the first time one is drawn
+    Olivec_Canvas16* scratch;
+    struct widget_layer layers[MAX_LAYERS];
+    int num_layers;
+    struct widget* widgets[MAX_WIDGETS];
+    int num_widgets;
+    struct widget_tween tweens[MAX_TWEENS];
+    int num_tweens;
+    // nothing has been drawn yet, the background needs filling everywhere
+    bool full_redraw;
+};
+
+static const struct draw_stuff_rect EMPTY_RECT = {0, 0, 0, 0};
+
+static bool rect_empty(const struct draw_stuff_rect* r)
+{
+    return r->x2 <= r->x1 || r->y2 <= r->y1;
+}
+
+static bool rects_overlap(const struct draw_stuff_rect* a, const struct draw_stuff_rect* b)
+{
+    return a->x1 < b->x2 && b->x1 < a->x2 && a->y1 < b->y2 && b->y1 < a->y2;
+}
+
+static int rect_area(const struct draw_stuff_rect* r)
+{
+    return (r->x2 - r->x1) * (r->y2 - r->y1);
+}
+
+static struct draw_stuff_rect rect_union(const struct draw_stuff_rect* a, const struct draw_stuff_rect* b)
+{
+    struct draw_stuff_rect r = {
+        .x1 = a->x1 < b->x1 ? a->x1 : b->x1,
+        .y1 = a->y1 < b->y1 ? a->y1 : b->y1,
+        .x2 = a->x2 > b->x2 ? a->x2 : b->x2,
+        .y2 = a->y2 > b->y2 ? a->y2 : b->y2,
+    };
+    return r;
+}
+
+struct widget_tree* widget_tree_create(int width, int height, uint32_t background)
+{
+    struct widget_tree* tree = malloc(sizeof(*tree));
+    if(tree == NULL) {
+        return NULL;
+    }
+    tree->screen = image_loader_image16_create(width, height, false);
+    tree->base = image_loader_image16_create(width, height, false);
+    if(tree->screen == NULL || tree->base == NULL) {
+        // image_loader says which one, the pool takes NULL
+        image_loader_image16_free(&tree->screen);
+        image_loader_image16_free(&tree->base);
+        free(tree);
+        return NULL;
+    }
+    tree->background = background;
+    tree->base_valid = false;
+    tree->scratch = NULL;
+    tree->num_layers = 0;
+    tree->num_widgets = 0;
+    tree->num_tweens = 0;
+    tree->full_redraw = true;
+    return tree;
+}
+
+static void widget_free(struct widget* widget)
+{
+    switch(widget->type) {
+    case WIDGET_LABEL:
+        if(widget->label.strip != NULL) {
+            text_cache_release(widget->label.strip);
+        }
+        break;
+    case WIDGET_MARQUEE:
+        marquee_free(&widget->marquee.marquee);
+        break;
+    default:
+        break;
+    }
+    free(widget);
+}
+
+void widget_tree_free(struct widget_tree** tree)
+{
+    for(int i = 0; i < (*tree)->num_widgets; i++) {
+        widget_free((*tree)->widgets[i]);
+    }
+    image_loader_image16_free(&(*tree)->screen);
+    image_loader_image16_free(&(*tree)->base);
+    if((*tree)->scratch != NULL) {
+        image_loader_image16_free(&(*tree)->scratch);
+    }
+    free(*tree);
+    *tree = NULL;
+}
+
+struct widget_layer* widget_tree_add_layer(struct widget_tree* tree, bool cached)
+{
+    assert(tree->num_layers < MAX_LAYERS);
+    // the base canvas holds the cached layers, so nothing dynamic can be under them
+    assert(!cached || tree->num_layers == 0 || tree->layers[tree->num_layers - 1].cached);
+    struct widget_layer* layer = &tree->layers[tree->num_layers++];
+    layer->cached = cached;
+    layer->opacity = 255;
+    layer->offset_x = 0;
+    layer->offset_y = 0;
+    layer->changed = false;
+    return layer;
+}
+
+void widget_layer_set_opacity(struct widget_layer* layer, uint8_t opacity)
+{
+    if(layer->opacity != opacity) {
+        layer->opacity = opacity;
+        layer->changed = true;
+    }
+}
+
+void widget_layer_set_offset(struct widget_layer* layer, int x, int y)
+{
+    if(layer->offset_x != x || layer->offset_y != y) {
+        layer->offset_x = x;
+        layer->offset_y = y;
+        layer->changed = true;
+    }
+}
+
+static struct widget* add_widget(struct widget_tree* tree, enum widget_type type, int x, int y)
+{
+    assert(tree->num_widgets < MAX_WIDGETS);
+    if(tree->num_layers == 0) {
+        widget_tree_add_layer(tree, false);
+    }
+    struct widget* widget = calloc(1, sizeof(*widget));
+    widget->type = type;
+    widget->layer = &tree->layers[tree->num_layers - 1];
+    widget->x = x;
+    widget->y = y;
+    widget->visible = true;
+    widget->dirty = true;
+    widget->drawn = EMPTY_RECT;
+    tree->widgets[tree->num_widgets++] = widget;
+    return widget;
+}
+
+struct widget* widget_tree_add_label(struct widget_tree* tree, int x, int y)
+{
+    struct widget* widget = add_widget(tree, WIDGET_LABEL, x, y);
+    widget->label.strip = NULL;
+    return widget;
+}
+
+struct widget* widget_tree_add_marquee(struct widget_tree* tree, int y, int width)
+{
+    struct widget* widget = add_widget(tree, WIDGET_MARQUEE, WIDGET_CENTER_X, y);
+    widget->marquee.marquee = marquee_create(width);
+    widget->marquee.width = width;
+    widget->marquee.height = glyph_atlas_line_height();
+    return widget;
+}
+
+struct widget* widget_tree_add_icon(struct widget_tree* tree, int x, int y, const struct rle_sprite* icon)
+{
+    struct widget* widget = add_widget(tree, WIDGET_ICON, x, y);
+    widget->icon.image = icon;
+    return widget;
+}
+
+struct widget* widget_tree_add_progress_bar(struct widget_tree* tree, int x, int y, int width, int height, uint32_t colour)
+{
+    struct widget* widget = add_widget(tree, WIDGET_PROGRESS_BAR, x, y);
+    widget->bar.width = width;
+    widget->bar.height = height;
+    widget->bar.colour = colour;
+    widget->bar.filled = 0;
+    return widget;
+}
+
+struct widget* widget_tree_add_overlay(struct widget_tree* tree, int x, int y, int width, int height,
+                                       void (*draw)(Olivec_Canvas16 canvas, int x, int y, void* data), void* data)
+{
+    struct widget* widget = add_widget(tree, WIDGET_OVERLAY, x, y);
+    widget->overlay.width = width;
+    widget->overlay.height = height;
+    widget->overlay.draw = draw;
+    widget->overlay.data = data;
+    return widget;
+}
+
+struct tween* widget_tree_add_tween(struct widget_tree* tree, struct widget* target,
+                                    void (*apply)(struct widget* target, float value))
+{
+    assert(tree->num_tweens < MAX_TWEENS);
+    struct widget_tween* t = &tree->tweens[tree->num_tweens++];
+    tween_set(&t->tween, 0.0f);
+    t->target = target;
+    t->apply = apply;
+    return &t->tween;
+}
+
+void widget_label_set_text(struct widget* widget, const char* text)
+{
+    if(widget->type == WIDGET_MARQUEE) {
+        // the marquee keeps its own copy and only renders again if the text changed
+        struct marquee* marquee = widget->marquee.marquee;
+        if(marquee->strip == NULL || strcmp(marquee->strip->text, text) != 0) {
+            marquee_set_text(marquee, text);
+            widget->dirty = true;
+        }
+        return;
+    }
+
+    assert(widget->type == WIDGET_LABEL);
+    const char* old_text = widget->label.strip != NULL ? widget->label.strip->text : "";
+    if(strcmp(old_text, text) == 0) {
+        return;
+    }
+    if(widget->label.strip != NULL) {
+        text_cache_release(widget->label.strip);
+        widget->label.strip = NULL;
+    }
+    if(text[0] != '\0') {
+        widget->label.strip = text_cache_get(text, TEXT_FONT_DEFAULT, LABEL_COLOUR);
+    }
+    widget->dirty = true;
+}
+
+void widget_icon_set(struct widget* widget, const struct rle_sprite* icon)
+{
+    assert(widget->type == WIDGET_ICON);
+    if(widget->icon.image != icon) {
+        widget->icon.image = icon;
+        widget->dirty = true;
+    }
+}
+
+void widget_progress_bar_set(struct widget* widget, float progress)
+{
+    assert(widget->type == WIDGET_PROGRESS_BAR);
+    if(!(progress >= 0.0f)) {
+        // also catches NaN from 0 / 0 when nothing is playing
+        progress = 0.0f;
+    } else if(progress > 1.0f) {
+        progress = 1.0f;
+    }
+    int filled = round(progress * widget->bar.width);
+    if(filled != widget->bar.filled) {
+        widget->bar.filled = filled;
+        widget->dirty = true;
+    }
+}
+
+void widget_set_visible(struct widget* widget, bool visible)
+{
+    if(widget->visible != visible) {
+        widget->visible = visible;
+        widget->dirty = true;
+    }
+}
+
+void widget_mark_dirty(struct widget* widget)
+{
+    widget->dirty = true;
+}
+
+static void widget_size(const struct widget* widget, int* width, int* height)
+{
+    *width = 0;
+    *height = 0;
+    switch(widget->type) {
+    case WIDGET_LABEL:
+        if(widget->label.strip != NULL) {
+            *width = widget->label.strip->image->width;
+            *height = widget->label.strip->image->height;
+        }
+        break;
+    case WIDGET_MARQUEE:
+        *width = widget->marquee.width;
+        *height = widget->marquee.height;
+        break;
+    case WIDGET_ICON:
+        if(widget->icon.image != NULL) {
+            *width = widget->icon.image->width;
+            *height = widget->icon.image->height;
+        }
+        break;
+    case WIDGET_PROGRESS_BAR:
+        *width = widget->bar.width;
+        *height = widget->bar.height;
+        break;
+    case WIDGET_OVERLAY:
+        *width = widget->overlay.width;
+        *height = widget->overlay.height;
+        break;
+    }
+}
+
+static struct draw_stuff_rect widget_bounds(const struct widget_tree* tree, const struct widget* widget)
+{
+    if(!widget->visible) {
+        return EMPTY_RECT;
+    }
+    int width, height;
+    widget_size(widget, &width, &height);
+    int x = widget->x == WIDGET_CENTER_X ? ((int)tree->screen->width - width) / 2 : widget->x;
+    x += widget->layer->offset_x;
+    int y = widget->y + widget->layer->offset_y;
+    struct draw_stuff_rect bounds = {x, y, x + width, y + height};
+    return bounds;
+}
+
+// draw widget into canvas, which starts at (ox, oy) on the screen
+static void draw_widget(const struct widget* widget, const struct draw_stuff_rect* bounds, Olivec_Canvas16 canvas, int ox, int oy, long now_ms)
+{
+    int x = bounds->x1 - ox;
+    int y = bounds->y1 - oy;
+    int width = bounds->x2 - bounds->x1;
+    int height = bounds->y2 - bounds->y1;
+    switch(widget->type) {
+    case WIDGET_LABEL:
+        // no strip for empty text, or if it couldn't be rendered
+        if(widget->label.strip != NULL) {
+            olivec16_sprite_blend(canvas, x, y, width, height, *widget->label.strip->image);
+        }
+        break;
+    case WIDGET_MARQUEE:
+        marquee_draw_at(widget->marquee.marquee, canvas, x, y, now_ms);
+        break;
+    case WIDGET_ICON:
+        rle_sprite_blit(canvas, x, y, widget->icon.image);
+        break;
+    case WIDGET_PROGRESS_BAR:
+        olivec16_rect(canvas, x, y, width, height, OLIVEC_RGBA(0xD3, 0xD3, 0xD3, 0xFF));
+        olivec16_rect(canvas, x, y, widget->bar.filled, height, widget->bar.colour);
+        break;
+    case WIDGET_OVERLAY:
+        widget->overlay.draw(canvas, x, y, widget->overlay.data);
+        break;
+    }
+}
+
+static int add_damage(struct draw_stuff_rect damage[MAX_WIDGETS * 2], int num_damage, const struct draw_stuff_rect* rect)
+{
+    if(!rect_empty(rect)) {
+        damage[num_damage++] = *rect;
+    }
+    return num_damage;
+}
+
+// merge overlapping rects, then the pairs that waste the least area until there are at most WIDGET_MAX_DAMAGE
+static int merge_damage(struct draw_stuff_rect damage[], int num_damage)
+{
+    bool merged = true;
+    while(merged) {
+        merged = false;
+        for(int a = 0; a < num_damage && !merged; a++) {
+            for(int b = a + 1; b < num_damage; b++) {
+                if(rects_overlap(&damage[a], &damage[b])) {
+                    damage[a] = rect_union(&damage[a], &damage[b]);
+                    damage[b] = damage[--num_damage];
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    while(num_damage > WIDGET_MAX_DAMAGE) {
+        int best_a = 0;
+        int best_b = 1;
+        int best_waste = -1;
+        for(int a = 0; a < num_damage; a++) {
+            for(int b = a + 1; b < num_damage; b++) {
+                struct draw_stuff_rect u = rect_union(&damage[a], &damage[b]);
+                int waste = rect_area(&u) - rect_area(&damage[a]) - rect_area(&damage[b]);
+                if(best_waste < 0 || waste < best_waste) {
+                    best_waste = waste;
+                    best_a = a;
+                    best_b = b;
+                }
+            }
+        }
+        damage[best_a] = rect_union(&damage[best_a], &damage[best_b]);
+        damage[best_b] = damage[--num_damage];
+    }
+    return num_damage;
+}
+
+// draw the widgets on layer that overlap r into area, which covers r on the screen
+static void draw_layer(struct widget_tree* tree, const struct widget_layer* layer, const struct draw_stuff_rect* r,
+                       Olivec_Canvas16 area, long now_ms)
+{
+    if(layer->opacity == 0) {
+        return;
+    }
+    int w = r->x2 - r->x1;
+    int h = r->y2 - r->y1;
+    // a see through layer is drawn over a copy of what's under it, then the copy is mixed back in, so overlapping
+    // widgets on the layer fade together instead of showing each other through
+    Olivec_Canvas16 target = area;
+    bool translucent = layer->opacity < 255;
+    if(translucent && tree->scratch == NULL) {
+        tree->scratch = image_loader_image16_create(tree->screen->width, tree->screen->height, false);
+        if(tree->scratch == NULL) {
+            // image_loader already said why, still show the layer, just without fading it
+            translucent = false;
+        }
+    }
+    if(translucent) {
+        target = olivec16_subcanvas(*tree->scratch, r->x1, r->y1, w, h);
+        olivec16_sprite_copy(target, 0, 0, w, h, area);
+    }
+    for(int i = 0; i < tree->num_widgets; i++) {
+        struct widget* widget = tree->widgets[i];
+        if(widget->layer != layer || rect_empty(&widget->drawn) || !rects_overlap(&widget->drawn, r)) {
+            continue;
+        }
+        draw_widget(widget, &widget->drawn, target, r->x1, r->y1, now_ms);
+    }
+    if(translucent) {
+        for(int y = 0; y < h; y++) {
+            for(int x = 0; x < w; x++) {
+                uint16_t* p = &OLIVEC_PIXEL16(area, x, y);
+                *p = olivec16_mix(*p, OLIVEC_PIXEL16(target, x, y), layer->opacity);
+            }
+        }
+    }
+}
+
+// background plus every cached layer, only done when something on a cached layer changed
+static void render_base(struct widget_tree* tree, long now_ms)
+{
+    Olivec_Canvas16 base = *tree->base;
+    struct draw_stuff_rect all = {0, 0, base.width, base.height};
+    olivec16_fill(base, tree->background);
+    for(int l = 0; l < tree->num_layers && tree->layers[l].cached; l++) {
+        draw_layer(tree, &tree->layers[l], &all, base, now_ms);
+    }
+    tree->base_valid = true;
+}
+
+int widget_tree_render(struct widget_tree* tree, long now_ms, struct draw_stuff_rect out[WIDGET_MAX_DAMAGE])
+{
+    Olivec_Canvas16 screen = *tree->screen;
+    struct draw_stuff_rect damage[MAX_WIDGETS * 2];
+    int num_damage = 0;
+
+    if(tree->full_redraw) {
+        struct draw_stuff_rect all = {0, 0, screen.width, screen.height};
+        num_damage = add_damage(damage, num_damage, &all);
+        tree->full_redraw = false;
+    }
+
+    for(int i = 0; i < tree->num_tweens; i++) {
+        struct widget_tween* t = &tree->tweens[i];
+        if(!tween_update(&t->tween, now_ms)) {
+            continue;
+        }
+        if(t->apply != NULL) {
+            t->apply(t->target, t->tween.value);
+        } else {
+            t->target->dirty = true;
+        }
+    }
+
+    // the old and the new area of every widget that changed need redrawing
+    for(int i = 0; i < tree->num_widgets; i++) {
+        struct widget* widget = tree->widgets[i];
+        if(widget->type == WIDGET_MARQUEE && widget->visible && marquee_needs_redraw(widget->marquee.marquee, now_ms)) {
+            widget->dirty = true;
+        }
+        if(widget->layer->changed) {
+            widget->dirty = true;
+        }
+        if(!widget->dirty) {
+            continue;
+        }
+        if(widget->layer->cached) {
+            tree->base_valid = false;
+        }
+        struct draw_stuff_rect bounds = widget_bounds(tree, widget);
+        num_damage = add_damage(damage, num_damage, &widget->drawn);
+        num_damage = add_damage(damage, num_damage, &bounds);
+        widget->drawn = bounds;
+        widget->dirty = false;
+    }
+
+    // clip to the screen
+    struct draw_stuff_rect all = {0, 0, screen.width, screen.height};
+    int n = 0;
+    for(int i = 0; i < num_damage; i++) {
+        if(rects_overlap(&damage[i], &all)) {
+            struct draw_stuff_rect r = damage[i];
+            r.x1 = r.x1 < 0 ? 0 : r.x1;
+            r.y1 = r.y1 < 0 ? 0 : r.y1;
+            r.x2 = r.x2 > (int)screen.width ? (int)screen.width : r.x2;
+            r.y2 = r.y2 > (int)screen.height ? (int)screen.height : r.y2;
+            damage[n++] = r;
+        }
+    }
+    num_damage = merge_damage(damage, n);
+    for(int l = 0; l < tree->num_layers; l++) {
+        tree->layers[l].changed = false;
+    }
+
+    if(num_damage > 0 && !tree->base_valid) {
+        render_base(tree, now_ms);
+    }
+
+    // repaint each damaged area from the base up, drawing into a subcanvas clips everything to it
+    for(int d = 0; d < num_damage; d++) {
+        struct draw_stuff_rect* r = &damage[d];
+        int w = r->x2 - r->x1;
+        int h = r->y2 - r->y1;
+        Olivec_Canvas16 area = olivec16_subcanvas(screen, r->x1, r->y1, w, h);
+        olivec16_sprite_copy(area, 0, 0, w, h, olivec16_subcanvas(*tree->base, r->x1, r->y1, w, h));
+        for(int l = 0; l < tree->num_layers; l++) {
+            if(!tree->layers[l].cached) {
+                draw_layer(tree, &tree->layers[l], r, area, now_ms);
+            }
+        }
+        out[d] = *r;
+    }
+    return num_damage;
+}
+
+long widget_tree_ms_until_change(const struct widget_tree* tree, long now_ms)
+{
+    for(int i = 0; i < tree->num_tweens; i++) {
+        if(tree->tweens[i].tween.running) {
+            return 0;
+        }
+    }
+    long soonest = -1;
+    for(int i = 0; i < tree->num_widgets; i++) {
+        const struct widget* widget = tree->widgets[i];
+        if(widget->type != WIDGET_MARQUEE || !widget->visible) {
+            continue;
+        }
+        long ms = marquee_ms_until_change(widget->marquee.marquee, now_ms);
+        if(ms >= 0 && (soonest < 0 || ms < soonest)) {
+            soonest = ms;
+        }
+    }
+    return soonest;
+}
+
+Olivec_Canvas16* widget_tree_screen(struct widget_tree* tree)
+{
+    return tree->screen;
+}